@@ -1,8 +1,20 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <memory>
+#include <algorithm>
+#include <omp.h>
+#include <sstream>
+#include <vector>
 #include <Eigen/Core>
 #include <particle.hpp>
+#include <fixed_solar_system.hpp>
+#include <ensemble.hpp>
+#include <barnes_hut.hpp>
+#include <fmm.hpp>
+#include <pm.hpp>
+#include <p3m.hpp>
+#include <distributed.hpp>
 
 
 static void show_usage()
@@ -10,19 +22,56 @@ static void show_usage()
   // help message
 
   std::cout << "\nUsage: ./build/solarSystemSimulator [-h] [--help] [-t --len <len_time> <timesteps> <epsilon>] [-t --num <num_timesteps> <timesteps> <epsilon>]"
-            << "\n\t\t\t\t    [-tel <len_time> <timesteps> <epsilon> <num_diff_times>] [-gel <len_time> <timesteps> <epsilon> <num_planets>]\n\n"
+            << "\n\t\t\t\t    [-tel <len_time> <timesteps> <epsilon> <num_diff_times>] [-gel <len_time> <timesteps> <epsilon> <num_planets> [<solver> [<integrator>]]]"
+            << "\n\t\t\t\t    [-fc <num_planets> <epsilon> <solver>] [-int <len_time> <max_timestep> <epsilon> <num_diff_times> [engine]]"
+            << "\n\t\t\t\t    [-scale <num_timesteps> <epsilon> <num_planets> <max_threads> [<schedule>]] [-dist <num_timesteps> <epsilon> <num_planets> <max_ranks>]"
+            << "\n\t\t\t\t    [-rec <len_time> <timesteps> <epsilon> <interval> <filename> [float]] [-mp <len_time> <timesteps> <epsilon> <num_planets>] [--checkpoint <filename> <interval>] [--restart <filename>]"
+            << "\n\t\t\t\t    [--telemetry <filename>] [-ens <len_time> <timesteps> <epsilon> <num_systems> <max_planets> [<num_threads>]] [-adapt <len_time> <tolerance> <epsilon>]\n\n"
             << "Options:\n\n"
             << "Commands and Description\n\n"
             << "-h | --help \nShows this help message.\n\n"
             << "-t --len <len_time> <timesteps> <epsilon> \nControlling the timestep dt and the total length of time, with softening factor epsilon.\n\n"
-            << "-t --num <num_timesteps> <timesteps> <epsilon> \nControlling the timestep dt and the total number of timesteps to simulate, with softening factor epsilon.\n\n"
+            << "-t --num <num_timesteps> <timesteps> <epsilon> \nControlling the timestep dt and the total number of timesteps to simulate, with softening factor epsilon.\n"
+            << "Both -t modes run the 9 bodies on FixedSolarSystem<9>, whose force calculation is unrolled at compile time.\n\n"
             << "-tel <len_time> <max_timestep> <epsilon> <num_diff_times>\nShowing the energy before and after, as well as the energy loss for different timesteps, for the"
             << " evolution of controlling the timestep dt and the total number of timesteps to simulate, with softening factor epsilon."
             << " The maximum timestep is the maximum value of the timestep dt, and there will be "
             << "num_diff_times of such dt, each with decreasing orders of 10 starting from the maximum dt. "
             << "The time taken for the loop to run will also be printed in a summary table.\n\n"
-            << "-gel <len_time> <timesteps> <epsilon> <num_planets>\nShowing the total energy loss for the simulation of a general solar system with num_planets many planets with softening factor epsilon."
+            << "-gel <len_time> <timesteps> <epsilon> <num_planets> [<solver> [<integrator>]]\nShowing the total energy loss for the simulation of a general solar system with num_planets many planets with softening factor epsilon."
             << " The general solar system will run for total time of len_time with timesteps dt. Positions and masses of bodies inside the syetem are always randomised. The time taken for the application to run will be printed on a summary table."
+            << " The force solver used for the evolution can optionally be chosen with <solver>, and after it the integrator with <integrator>.\n\n"
+            << "--checkpoint <filename> <interval>\nAdded to -gel: writing a snapshot of the whole run into filename every interval timesteps, in the background.\n\n"
+            << "--restart <filename>\nContinuing the -gel run of the snapshot in filename exactly where it stopped, with the same results as an uninterrupted run."
+            << " The run continues on the same number of OpenMP threads as the run of the snapshot."
+            << " Add --checkpoint to keep writing snapshots.\n\n"
+            << "--telemetry <filename>\nAdded to -tel or -gel: writing the energy, momentum and angular momentum drift, the largest acceleration and the time spent in the"
+            << " force calculation and in the rest of every timestep into filename while the run goes on, as CSV if filename ends in .csv and binary otherwise."
+            << " For -tel, the number of each timestep is added to the filename. The times in the summary tables always come from these measurements.\n\n"
+            << "-fc <num_planets> <epsilon> <solver>\nComparing the accelerations of a force solver against the direct summation for a general solar system with num_planets many planets,"
+            << " showing the time taken by both and the relative error of the solver's accelerations.\n\n"
+            << "-int <len_time> <max_timestep> <epsilon> <num_diff_times> [engine]\nComparing the integrators (euler, leapfrog, verlet, yoshida, block, wh and hermite) on the solar system, in the same way as -tel:"
+            << " for each of the num_diff_times timesteps, the relative energy error, the time taken and the time taken per simulated year are printed in a summary table."
+            << " With engine, the table also has the leapfrog with the direct summation run on an ExecutionEngine, which keeps one thread team for the whole run"
+            << " and runs systems below its serial threshold without any.\n\n"
+            << "-scale <num_timesteps> <epsilon> <num_planets> <max_threads> [<schedule>]\nStrong scaling benchmark: evolving the same general solar system with num_planets many planets for num_timesteps timesteps"
+            << " with 1, 2, 4, ... up to max_threads threads, and printing the time taken, the speedup and the parallel efficiency for each number of threads in a summary table."
+            << " The timesteps are Euler steps with the direct summation, whose OpenMP schedule can optionally be chosen with <schedule>.\n\n"
+            << "-dist <num_timesteps> <epsilon> <num_planets> <max_ranks>\nDistributed scaling report: evolving the same general solar system with num_planets many planets for num_timesteps timesteps"
+            << " split over 1, 2, 4, ... up to max_ranks local processes, which exchange the positions of their bodies every timestep over Unix sockets."
+            << " The time taken, the speedup, the parallel efficiency and the largest difference to the single-process positions are printed in a summary table.\n\n"
+            << "-rec <len_time> <timesteps> <epsilon> <interval> <filename> [float]\nRecording the trajectory of the solar system into the binary file filename, with a frame of all positions and velocities every interval timesteps."
+            << " The frames are written by a background thread, and stored as 32-bit floats if float is given. The file is read back at the end to show the final position of the Earth.\n\n"
+            << "-mp <len_time> <timesteps> <epsilon> <num_planets>\nMixed precision report: evolving the same general solar system with num_planets many planets with the double precision"
+            << " direct summation and with the mixed precision solver, which evaluates the pair forces in single precision. The relative energy error, the time taken and"
+            << " the largest distance from the double precision positions are printed for both in a summary table.\n\n"
+            << "-ens <len_time> <timesteps> <epsilon> <num_systems> <max_planets> [<num_threads>]\nEnsemble run: evolving num_systems independent general solar systems, each with 1 to max_planets"
+            << " planets, at the same time on num_threads threads (default: all), one system per thread with work stealing between the threads."
+            << " The statistics of the relative energy loss of the systems and the time taken are printed, next to the time of running the same systems one after the other"
+            << " with parallel force loops.\n\n"
+            << "-adapt <len_time> <tolerance> <epsilon>\nEvolving the solar system for a total time of len_time with the adaptive Bulirsch-Stoer integrator, which chooses its own timesteps"
+            << " so that every step keeps the error of the positions and velocities y below tolerance (1 + |y|). Instead of trying several dt as with -tel, a single run"
+            << " shows the final position of the Earth, the relative energy error, the number of steps taken and rejected, the force evaluations and the time taken."
             << "\n\nArguments are separated by a single whitespace.\n\n"
             << std::endl;
 
@@ -35,6 +84,17 @@ static void show_usage()
             << "\t<epsilon> \t\t Softening factor when calculating the acceleration. (type: float)\n"
             << "\t<num_diff_times> \t Number of different timesteps to calculate and compare the solar system energies for each of these timesteps. (type: int)\n"
             << "\t<num_planets> \t\t Number of planets in the general solar system. (type: int)\n"
+            << "\t<max_threads> \t\t Largest number of OpenMP threads to benchmark. (type: int)\n"
+            << "\t<interval> \t\t Number of timesteps between two frames of the trajectory. (type: int)\n"
+            << "\t<filename> \t\t Name of the binary trajectory file. (type: string)\n"
+            << "\t<max_ranks> \t\t Largest number of processes to split the run over. (type: int)\n"
+            << "\t<num_systems> \t\t Number of independent general solar systems in an ensemble. (type: int)\n"
+            << "\t<max_planets> \t\t Largest number of planets of a system of the ensemble. (type: int)\n"
+            << "\t<num_threads> \t\t Number of threads to run the ensemble on. (type: int)\n"
+            << "\t<schedule> \t\t OpenMP schedule of the force loop: static (default), dynamic or guided, with an optional chunk size as static:<chunk>. (type: string)\n"
+            << "\t<solver> \t\t Force solver: direct, pairwise (default), simd, mixed[:<block_size>] for single precision pair forces summed in double over blocks of block_size bodies (default 256), bh[:<theta>] for Barnes-Hut with opening angle theta from 0 to 1 (default 0.5), fmm[:<order>] for the fast multipole method with expansion order 1-10 (default 4), pm[:<grid_size>] for the particle-mesh solver with grid_size cells along the longest side, a power of 2 (default 64), or p3m[:<grid_size>[:<split_cells>]] for the particle-mesh solver with the close pairs summed directly, split at split_cells cells (default 1.25). (type: string)\n"
+            << "\t<integrator> \t\t Integrator: euler (default), leapfrog, verlet, yoshida, hermite for the fourth order Hermite scheme, block for Hermite with block timesteps, wh for Wisdom-Holman or bs[:<tolerance>] for the adaptive Bulirsch-Stoer integrator (default 1e-10), which takes as many steps as it needs for each timestep. The hermite, block and bs integrators use their own direct summation instead of the force solver, so they only run with the direct or pairwise solver. (type: string)\n"
+            << "\t<tolerance> \t\t Largest error of the positions and velocities y in one step of the adaptive integrator, over 1 + |y|. (type: float)\n"
             // << "\t<set_rand_seed> \t Toggling random conditions on or off. (type: bool: true / false)"
             << "\t\t\t\t\t\t\n\n"
             << "**NOTE**: Usage of π=3.14159265... , please input <constant>*PI or <constant>*pi, where <constant> is any number of type float or integer.\n\n "
@@ -51,6 +111,22 @@ static void show_usage()
             << "-gel 200.0*PI 0.001 0.1 64 \nShowing the total energy loss for the evolution of a general solar system with "
             << "a total time of 200π with timestep dt=0.001, with softening factor of epsilon = 0.1. There are 64 planets in this general solar system, "
             << "where their masses, distance from sun and orientation from the sun are randomised.\n\n"
+            << "-gel 2.0*PI 0.001 0.1 20000 bh:0.7 \nSame as above for 20000 planets, using the Barnes-Hut solver with opening angle theta = 0.7 for the evolution.\n\n"
+            << "-gel 200.0*PI 0.01 0.1 64 pairwise hermite \nSame as the first -gel example with the fourth order Hermite integrator, which reaches a smaller energy loss with 10 times fewer timesteps.\n\n"
+            << "-gel 200.0*PI 0.001 0.1 2048 --checkpoint run.ckpt 1000 \nWriting a snapshot of the run into run.ckpt every 1000 timesteps.\n\n"
+            << "--restart run.ckpt --checkpoint run.ckpt 1000 \nContinuing that run from its last snapshot, and writing new snapshots.\n\n"
+            << "-gel 200.0*PI 0.001 0.1 2048 --telemetry run.csv \nWriting the conservation and timing telemetry of every timestep of the run into run.csv.\n\n"
+            << "-int 20.0*PI 0.1 0.0 3 \nComparing the energy errors and run times of all integrators for 10 years of the solar system with timesteps dt = 0.1, 0.01, 0.001.\n\n"
+            << "-scale 100 0.01 4096 64 dynamic:8 \nStrong scaling benchmark of 100 timesteps of a general solar system with 4096 planets on 1, 2, 4, ..., 64 threads, with a dynamic schedule in chunks of 8 bodies.\n\n"
+            << "-dist 100 0.01 4096 8 \nDistributed scaling report of 100 timesteps of a general solar system with 4096 planets on 1, 2, 4 and 8 processes.\n\n"
+            << "-rec 200.0*PI 0.001 0.0 100 solar_system.traj \nRecording 100 years of the solar system with timestep dt = 0.001 into solar_system.traj, with a frame every 100 timesteps.\n\n"
+            << "-mp 2.0*PI 0.001 0.1 4096 \nComparing the energy error and run time of the mixed precision solver with the double precision direct summation for one year of a general solar system with 4096 planets.\n\n"
+            << "-ens 20.0*PI 0.001 0.01 200 50 \nEvolving 200 general solar systems with 1 to 50 planets for 10 years on all threads, and showing the statistics of their energy loss.\n\n"
+            << "-adapt 20.0*PI 1e-10 0.0 \nEvolving the solar system for 10 years with steps chosen for a relative error of at most 1e-10 per step.\n\n"
+            << "-fc 100000 0.01 fmm:6 \nComparing the fast multipole method with expansion order 6 against the direct summation for a general solar system with 100000 planets.\n\n"
+            << "-fc 100000 0.5 pm:256 \nComparing the particle-mesh solver with 256 cells along the longest side against the direct summation for a general solar system with 100000 planets.\n\n"
+            << "-fc 20000 0.01 p3m:256:2 \nComparing the P3M solver with 256 cells along the longest side and a split radius of 2 cells against the direct summation for a general solar system with 20000 planets.\n\n"
+            << "-fc 10000 0.01 bh:0.5 \nComparing the Barnes-Hut solver with opening angle theta = 0.5 against the direct summation for a general solar system with 10000 planets.\n\n"
             << std::endl;
   
   // scaling disclaimer
@@ -60,6 +136,154 @@ static void show_usage()
             << std::endl;
 }
 
+// building a force solver from its command-line name, with an optional parameter after a colon (e.g. bh:0.7)
+static std::shared_ptr<ForceSolver> MakeForceSolver(const std::string& solver_input)
+{
+  std::string name = solver_input.substr(0, solver_input.find(':'));
+  bool has_parameter = solver_input.find(':') != std::string::npos;
+  std::string parameter = has_parameter ? solver_input.substr(solver_input.find(':') + 1) : "";
+
+  if(name == "direct")
+  {
+    return std::make_shared<DirectSumSolver>();
+  }
+  else if(name == "pairwise")
+  {
+    return std::make_shared<PairwiseSolver>();
+  }
+  else if(name == "simd")
+  {
+    return std::make_shared<SimdSolver>();
+  }
+  else if(name == "mixed")
+  {
+    int block_size = has_parameter ? std::stoi(parameter) : 256;
+    return std::make_shared<MixedPrecisionSolver>(block_size);
+  }
+  else if(name == "bh")
+  {
+    double theta = has_parameter ? std::stod(parameter) : 0.5;
+    return std::make_shared<BarnesHutSolver>(theta);
+  }
+  else if(name == "fmm")
+  {
+    int expansion_order = has_parameter ? std::stoi(parameter) : 4;
+    return std::make_shared<FmmSolver>(expansion_order);
+  }
+  else if(name == "pm")
+  {
+    int grid_size = has_parameter ? std::stoi(parameter) : 64;
+    return std::make_shared<PmSolver>(grid_size);
+  }
+  else if(name == "p3m")
+  {
+    // p3m:<grid_size>:<split_cells>
+    bool has_split = has_parameter && parameter.find(':') != std::string::npos;
+    int grid_size = has_parameter ? std::stoi(parameter.substr(0, parameter.find(':'))) : 64;
+    double split_cells = has_split ? std::stod(parameter.substr(parameter.find(':') + 1)) : 1.25;
+    return std::make_shared<P3mSolver>(grid_size, split_cells);
+  }
+  throw std::invalid_argument("Unknown force solver " + solver_input);
+}
+
+// building an integrator from its command-line name, with an optional parameter after a colon (e.g. bs:1e-12),
+// for a run with the force solver solver_input
+static std::shared_ptr<Integrator> MakeIntegrator(const std::string& integrator_input, const std::string& solver_input)
+{
+  std::string name = integrator_input.substr(0, integrator_input.find(':'));
+  bool has_parameter = integrator_input.find(':') != std::string::npos;
+  std::string parameter = has_parameter ? integrator_input.substr(integrator_input.find(':') + 1) : "";
+
+  // these integrators evaluate their forces with their own direct summation, so any other solver would be silently ignored
+  std::string solver_name = solver_input.substr(0, solver_input.find(':'));
+  if((name == "hermite" || name == "block" || name == "bs") && solver_name != "direct" && solver_name != "pairwise")
+  {
+    throw std::invalid_argument("The " + name + " integrator uses its own direct summation and cannot run with the " + solver_input + " solver");
+  }
+
+  if(name == "euler")
+  {
+    return std::make_shared<EulerIntegrator>();
+  }
+  else if(name == "leapfrog")
+  {
+    return std::make_shared<LeapfrogIntegrator>();
+  }
+  else if(name == "verlet")
+  {
+    return std::make_shared<VelocityVerletIntegrator>();
+  }
+  else if(name == "yoshida")
+  {
+    return std::make_shared<YoshidaIntegrator>();
+  }
+  else if(name == "hermite")
+  {
+    return std::make_shared<HermiteIntegrator>();
+  }
+  else if(name == "block")
+  {
+    return std::make_shared<BlockTimestepIntegrator>();
+  }
+  else if(name == "wh")
+  {
+    return std::make_shared<WisdomHolmanIntegrator>();
+  }
+  else if(name == "bs")
+  {
+    double tolerance = has_parameter ? std::stod(parameter) : 1e-10;
+    return std::make_shared<BulirschStoerIntegrator>(tolerance);
+  }
+  throw std::invalid_argument("Unknown integrator " + integrator_input);
+}
+
+// setting the OpenMP schedule of a SolarSystem from its command-line name, with an optional chunk size after a colon (e.g. dynamic:4)
+static void SetScheduleFromInput(SolarSystem& solar_system, const std::string& schedule_input)
+{
+  std::string name = schedule_input.substr(0, schedule_input.find(':'));
+  bool has_parameter = schedule_input.find(':') != std::string::npos;
+  int chunk_size = has_parameter ? std::stoi(schedule_input.substr(schedule_input.find(':') + 1)) : 0;
+
+  if(name == "static")
+  {
+    solar_system.SetSchedule(omp_sched_static, chunk_size);
+  }
+  else if(name == "dynamic")
+  {
+    solar_system.SetSchedule(omp_sched_dynamic, chunk_size);
+  }
+  else if(name == "guided")
+  {
+    solar_system.SetSchedule(omp_sched_guided, chunk_size);
+  }
+  else
+  {
+    throw std::invalid_argument("Unknown schedule " + schedule_input);
+  }
+}
+
+// telemetry of run number run out of num_runs, written into telemetry_file with the run number added before the extension
+// when there are several runs; without a file only the summary is kept
+static std::shared_ptr<TelemetryMonitor> MakeTelemetryMonitor(const std::string& telemetry_file, int run, int num_runs)
+{
+  if(telemetry_file.empty())
+  {
+    return std::make_shared<TelemetryMonitor>();
+  }
+
+  std::string filename = telemetry_file;
+  if(num_runs > 1)
+  {
+    std::size_t extension = filename.find_last_of('.');
+    if(extension == std::string::npos || extension < filename.find_last_of('/') + 1)
+    {
+      extension = filename.size();
+    }
+    filename.insert(extension, "_" + std::to_string(run));
+  }
+  return std::make_shared<TelemetryMonitor>(filename, TelemetryMonitor::FormatFromFilename(filename));
+}
+
 static void AddDelimiter()
 {
   std::cout << "\n======================================================================\n" << std::endl;
@@ -75,6 +299,78 @@ int main(int argc, char* argv[])
     input = input + argv[i] + " ";
   }
 
+  // options of long general solar system runs, taken out of the arguments before the mode is read:
+  // --checkpoint <file> <interval> writes snapshots of a -gel run, --restart <file> continues the -gel run of a snapshot,
+  // --telemetry <file> writes the telemetry of -tel and -gel runs
+  std::vector<std::string> arguments(argv, argv + argc);
+  std::string telemetry_file;
+  std::string checkpoint_file;
+  int checkpoint_interval = 0;
+  std::string restart_file;
+  Checkpoint restart_checkpoint;
+  try
+  {
+    for(std::size_t i = 1; i < arguments.size(); )
+    {
+      if(arguments[i] == "--checkpoint" && i + 2 < arguments.size())
+      {
+        checkpoint_file = arguments[i + 1];
+        checkpoint_interval = std::stoi(arguments[i + 2]);
+        if( checkpoint_interval < 1 )
+        {
+          throw std::invalid_argument( "The checkpoint interval should be at least 1" );
+        }
+        arguments.erase(arguments.begin() + i, arguments.begin() + i + 3);
+      }
+      else if(arguments[i] == "--telemetry" && i + 1 < arguments.size())
+      {
+        telemetry_file = arguments[i + 1];
+        arguments.erase(arguments.begin() + i, arguments.begin() + i + 2);
+      }
+      else if(arguments[i] == "--restart" && i + 1 < arguments.size())
+      {
+        restart_file = arguments[i + 1];
+        arguments.erase(arguments.begin() + i, arguments.begin() + i + 2);
+      }
+      else
+      {
+        i++;
+      }
+    }
+
+    // a restart repeats the -gel run stored in the snapshot
+    if(!restart_file.empty())
+    {
+      restart_checkpoint = CheckpointWriter::ReadFile(restart_file);
+
+      // the same number of threads as the run of the snapshot, which the last bits of the forces depend on
+      omp_set_num_threads(restart_checkpoint.num_threads);
+      std::istringstream run_info(restart_checkpoint.run_info);
+      arguments = {arguments[0], "-gel"};
+      std::string argument;
+      while(run_info >> argument)
+      {
+        arguments.push_back(argument);
+      }
+    }
+  }
+
+  // catching exception if the interval is invalid or the snapshot cannot be read
+  catch(const std::exception& err)
+  {
+    std::cerr << "Caught an exception. " << err.what() << std::endl;
+    show_usage();
+    return 0;
+  }
+
+  std::vector<char*> argument_pointers;
+  for(std::string& argument : arguments)
+  {
+    argument_pointers.push_back(&argument[0]);
+  }
+  argc = argument_pointers.size();
+  argv = argument_pointers.data();
+
   // shows help message when there are no arguments (just the argument for executing: ./build/solarSystemSimulator)
   if(argc == 0 || argc == 1)
   {
@@ -289,17 +585,20 @@ int main(int argc, char* argv[])
             // solar_system.PrintEarthDetails();
             solar_system.PrintPositions();
             
-            auto init_earth = solar_system.system[3].GetPosition();
+            auto init_earth = solar_system.GetParticle(3).GetPosition();
             AddDelimiter();
             std::cout << "Earth's starting position:\n" << init_earth << std::endl;
             AddDelimiter();
             
             // evolve system
+            // the 9 bodies of the solar system are few enough for the compile-time kernels of FixedSolarSystem
             std::cout<< "STARTING EVOLUTION" << std::endl;
-            solar_system.TimeEvolve(final_time, dt, eps);
+            FixedSolarSystem<9> fixed_system(system_gen);
+            fixed_system.TimeEvolve(final_time, dt, eps);
             // solar_system.EarthSunEvol(final_time, dt, eps);
+            SolarSystem evolved_system(fixed_system.ToParticles());
             AddDelimiter();
-            auto final_earth = solar_system.system[3].GetPosition();
+            auto final_earth = evolved_system.GetParticle(3).GetPosition();
             std::cout << "Earth's final position:\n" << final_earth << std::endl;
             
             // positions after
@@ -307,7 +606,7 @@ int main(int argc, char* argv[])
             AddDelimiter();
 
             // solar_system.PrintEarthDetails();
-            solar_system.PrintPositions();
+            evolved_system.PrintPositions();
 
             return 0;
           }
@@ -403,25 +702,28 @@ int main(int argc, char* argv[])
             solar_system.PrintEarthDetails();
             solar_system.PrintPositions();
             
-            auto init_earth = solar_system.system[3].GetPosition();
+            auto init_earth = solar_system.GetParticle(3).GetPosition();
             AddDelimiter();
             std::cout << "Earth's starting position:\n" << init_earth << std::endl;
             AddDelimiter();
             
             // evolve system
+            // the 9 bodies of the solar system are few enough for the compile-time kernels of FixedSolarSystem
             std::cout<< "STARTING EVOLUTION" << std::endl;
-            solar_system.StepEvolve(num_times, dt, eps);
+            FixedSolarSystem<9> fixed_system(system_gen);
+            fixed_system.StepEvolve(num_times, dt, eps);
+            SolarSystem evolved_system(fixed_system.ToParticles());
 
             AddDelimiter();
-            auto final_earth = solar_system.system[3].GetPosition();
+            auto final_earth = evolved_system.GetParticle(3).GetPosition();
             std::cout << "Earth's final position:\n" << final_earth << std::endl;
             
             // positions after
             std::cout<< "\nEnd positions: " << std::endl;
             AddDelimiter();
 
-            solar_system.PrintEarthDetails();
-            solar_system.PrintPositions();
+            evolved_system.PrintEarthDetails();
+            evolved_system.PrintPositions();
 
             return 0;
           }
@@ -623,9 +925,10 @@ int main(int argc, char* argv[])
 
           for(int n = 0; n < diff_times; n++)
           {
-          
-          // Marking the start time
-          auto start_time = std::chrono::high_resolution_clock::now();
+
+          // timing and conservation telemetry of every timestep
+          auto telemetry = MakeTelemetryMonitor(telemetry_file, n, diff_times);
+          solar_system.SetTelemetry(telemetry);
 
           std::cout << "Timestep dt: " << dt << std::endl;
           // Initial energies
@@ -655,11 +958,13 @@ int main(int argc, char* argv[])
           double total_energy_loss = final_energy - init_energy;
           std::cout << "The total energy loss for dt=" << dt << " is " << total_energy_loss << std::endl;
 
-          // Marking the end time
-          auto end_time = std::chrono::high_resolution_clock::now();
-
-          // Calculating the time taken for the program to run in milliseconds
-          auto time_taken = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+          // time taken by the timesteps in microseconds, split into the force calculation and the rest
+          telemetry->Close();
+          solar_system.SetTelemetry(nullptr);
+          TelemetrySummary telemetry_summary = telemetry->GetSummary();
+          double time_taken = telemetry_summary.step_seconds * 1e6;
+          std::cout << "Force calculation: " << telemetry_summary.force_seconds * 1e6 << " microseconds, updates: "
+                    << telemetry_summary.update_seconds * 1e6 << " microseconds" << std::endl;
 
           
           // adding total_energy_loss and dt to respective lists for summary message at the end
@@ -742,6 +1047,8 @@ int main(int argc, char* argv[])
 
         // do evolution in this case
         case 6:
+        case 7:
+        case 8:
         { 
           // input of mode
           std::string mode_input = argv[2];
@@ -863,18 +1170,84 @@ int main(int argc, char* argv[])
 
           // doing simulation here
           RandomInitialGenerator randgen;
+
+          // a restart regenerates the same bodies from the state of the random engine in the snapshot
+          if(!restart_file.empty())
+          {
+            randgen.SetState(restart_checkpoint.generator_state);
+          }
+          std::string generator_state = randgen.GetState();
           auto general_system_gen = randgen.GenerateInitialConditions(num_bodies);
           SolarSystem general_system(general_system_gen);
-          
-          
-          // Marking the start time
-          auto start_time = std::chrono::high_resolution_clock::now();
 
+          // variable solver
+          std::string solver_input = argc >= 7 ? std::string(argv[6]) : "pairwise";
+          try
+          {
+            general_system.SetForceSolver(MakeForceSolver(solver_input));
+          }
+
+          // catching exception if <solver> is not a known solver or its parameter is invalid
+          catch(const std::exception& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            std::cerr << "Input a valid solver and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // variable integrator
+          std::string integrator_input = argc == 8 ? std::string(argv[7]) : "euler";
+          try
+          {
+            general_system.SetIntegrator(MakeIntegrator(integrator_input, solver_input));
+          }
+
+          // catching exception if <integrator> is not a known integrator
+          catch(const std::exception& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            std::cerr << "Input a valid integrator and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+          
           double init_energy = general_system.TotalSystemEnergy();
+
+          // timing and conservation telemetry of every timestep
+          auto telemetry = MakeTelemetryMonitor(telemetry_file, 0, 1);
+          general_system.SetTelemetry(telemetry);
+
+          // snapshots store the arguments of the run, so --restart can repeat them
+          std::shared_ptr<CheckpointWriter> checkpoint_writer;
+          if(!checkpoint_file.empty())
+          {
+            std::string run_info;
+            for(int i = 2; i < argc; i++)
+            {
+              run_info = run_info + argv[i] + " ";
+            }
+            checkpoint_writer = std::make_shared<CheckpointWriter>(checkpoint_file, run_info, generator_state);
+            general_system.SetCheckpointWriter(checkpoint_writer, checkpoint_interval);
+          }
           
           // evolve system
-          std::cout<< "STARTING EVOLUTION" << std::endl;
-          general_system.TimeEvolve(final_time, dt, eps);
+          if(!restart_file.empty())
+          {
+            std::cout<< "RESUMING EVOLUTION FROM STEP " << restart_checkpoint.step << std::endl;
+            general_system.ResumeTimeEvolve(restart_checkpoint);
+          }
+          else
+          {
+            std::cout<< "STARTING EVOLUTION" << std::endl;
+            general_system.TimeEvolve(final_time, dt, eps);
+          }
+          if(checkpoint_writer)
+          {
+            checkpoint_writer->Close();
+          }
+          telemetry->Close();
+          TelemetrySummary telemetry_summary = telemetry->GetSummary();
 
           AddDelimiter();
 
@@ -883,19 +1256,15 @@ int main(int argc, char* argv[])
           // total energy loss in solar system due to numerical errors
           double total_energy_loss = final_energy - init_energy;
 
-          // Marking the end time
-          auto end_time = std::chrono::high_resolution_clock::now();
-
-          // Calculating the time taken for the program to run in minutes
-          auto time_taken = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time).count();
-
-          
-          // adding total_energy_loss and dt to respective lists for summary message at the end
-          
+          // time taken by the timesteps of this run, a restarted run only counts the steps after the restart
           std::cout << "Number of planets\t" << num_bodies << "\n"
+                    << "Force solver\t\t" << solver_input << "\n"
+                    << "Integrator\t\t" << integrator_input << "\n"
                     << "Timestep\t\t" << dt << "\n"
                     << "Total energy loss\t" << total_energy_loss << "\n"
-                    << "Time (minutes)\t\t" << time_taken/60. << "\n"
+                    << "Largest energy drift\t" << telemetry_summary.max_energy_drift << "\n"
+                    << "Time (minutes)\t\t" << telemetry_summary.step_seconds/60. << "\n"
+                    << "Force time (minutes)\t" << telemetry_summary.force_seconds/60. << "\n"
                     << std::endl;
           return 0;
         }
@@ -911,6 +1280,990 @@ int main(int argc, char* argv[])
         }
       }
     }
+    else if(mode == "-int")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        {
+          std::cout << "Please input the total length of time to simulate the evolution of the solar system, the maximum timestep dt, the softening factor epsilon and the number of different timesteps.\n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the comparison of the integrators in this case
+        case 6:
+        case 7:
+        {
+          // the optional flag adding the leapfrog on the execution engine
+          bool use_engine = argc == 7;
+          if (use_engine && std::string(argv[6]) != "engine")
+          {
+            std::cerr << "Unknown option " << argv[6] << ", check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // input of len_time
+          auto len_time = std::string(argv[2]);
+
+          // processing and validating inputs
+
+          // variable len_time
+          double final_time;
+
+          try 
+          {
+            // if the user uses π
+            if (len_time.find("PI") != std::string::npos || len_time.find("pi") != std::string::npos)
+            {
+              std::string delimiter = "*";
+              std::string constant = len_time.substr(0, len_time.find(delimiter)); // token is <constant>
+              final_time = std::stod(constant) * M_PI;
+            }
+            else
+            {
+              final_time = std::stod(len_time);
+            }
+          } 
+
+          // catching exception if <len_time> is of invalid data type when converting from string to double
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          // variables max_dt, epsilon and num_diff_times
+          double max_dt;
+          float eps;
+          int diff_times;
+          try
+          {
+            max_dt = std::stod(std::string(argv[3]));
+            eps = std::stof(std::string(argv[4]));
+            diff_times = std::stoi(std::string(argv[5]));
+
+            // ensuring num_diff_times input is of type int
+            if( (diff_times-std::stod(std::string(argv[5])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+          }
+
+          // catching exception if any input is of invalid data type
+          catch(const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // every integrator starts from the same initial conditions
+          SolarSystemGenerator ssgen;
+          auto initial_conditions = ssgen.GenerateInitialConditions();
+
+          std::vector<std::shared_ptr<Integrator>> integrators = {std::make_shared<EulerIntegrator>(), std::make_shared<LeapfrogIntegrator>(),
+                                                                  std::make_shared<VelocityVerletIntegrator>(), std::make_shared<YoshidaIntegrator>(),
+                                                                  std::make_shared<BlockTimestepIntegrator>(), std::make_shared<WisdomHolmanIntegrator>(),
+                                                                  std::make_shared<HermiteIntegrator>()};
+
+          AddDelimiter();
+          std::cout << "Integrator\t" << "Timestep\t" << "Relative energy error\t" << "Time (microseconds)\t" << "Time per simulated year (microseconds)" << std::endl;
+
+          for(auto integrator : integrators)
+          {
+            double dt = max_dt;
+            for(int n = 0; n < diff_times; n++)
+            {
+              SolarSystem solar_system(initial_conditions);
+              solar_system.SetIntegrator(integrator);
+              double init_energy = solar_system.TotalSystemEnergy();
+              auto block = std::dynamic_pointer_cast<BlockTimestepIntegrator>(integrator);
+              long long init_evaluations = block ? block->GetBodyForceEvaluations() : 0;
+
+              // Marking the start time
+              auto start_time = std::chrono::high_resolution_clock::now();
+
+              solar_system.TimeEvolve(final_time, dt, eps);
+
+              // Marking the end time
+              auto end_time = std::chrono::high_resolution_clock::now();
+              auto time_taken = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+
+              double energy_error = std::abs((solar_system.TotalSystemEnergy() - init_energy) / init_energy);
+
+              // one year corresponds to a time of 2π
+              std::cout << integrator->GetName() << "\t\t" << dt << "\t\t" << energy_error << "\t\t" << time_taken << "\t\t\t" << time_taken * 2 * M_PI / final_time << std::endl;
+
+              // the block timestep integrator evaluates forces on single bodies only when they are due,
+              // compared here with a shared timestep as small as the finest level it used
+              if (block)
+              {
+                int finest_level = *std::max_element(block->GetLevels().begin(), block->GetLevels().end());
+                double shared_evaluations = (solar_system.NumParticles() - 1) * std::ceil(final_time / dt) * std::pow(2, finest_level);
+                std::cout << "\t(" << block->GetBodyForceEvaluations() - init_evaluations << " body force evaluations, "
+                          << shared_evaluations << " with a shared timestep of dt / 2^" << finest_level << ")" << std::endl;
+              }
+
+              // restarting the loop with new dt value
+              dt = dt/10.0;
+            }
+          }
+
+          // the leapfrog with the direct summation on one thread team kept alive for the whole run,
+          // for as many steps as TimeEvolve makes; the 9 bodies are below the serial threshold and run without any team
+          if (use_engine)
+          {
+            ExecutionEngine engine;
+            double dt = max_dt;
+            for(int n = 0; n < diff_times; n++)
+            {
+              int num_steps = 0;
+              for(double t = 0; t <= final_time; t += dt)
+              {
+                num_steps++;
+              }
+
+              SolarSystem solar_system(initial_conditions);
+              double init_energy = solar_system.TotalSystemEnergy();
+
+              auto start_time = std::chrono::high_resolution_clock::now();
+              solar_system.EngineEvolve(engine, num_steps, dt, eps);
+              auto end_time = std::chrono::high_resolution_clock::now();
+              auto time_taken = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+
+              double energy_error = std::abs((solar_system.TotalSystemEnergy() - init_energy) / init_energy);
+              std::cout << "engine" << "\t\t" << dt << "\t\t" << energy_error << "\t\t" << time_taken << "\t\t\t" << time_taken * 2 * M_PI / final_time << std::endl;
+
+              dt = dt/10.0;
+            }
+          }
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-mp")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        {
+          std::cout << "Please input the total length of time to simulate the evolution of the general solar system, the timestep dt, the softening factor epsilon and the number of planets.\n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the mixed precision report in this case
+        case 6:
+        {
+          // input of len_time
+          auto len_time = std::string(argv[2]);
+
+          // processing and validating inputs
+          double final_time;
+          double dt;
+          float eps;
+          int num_bodies;
+          try 
+          {
+            // if the user uses π
+            if (len_time.find("PI") != std::string::npos || len_time.find("pi") != std::string::npos)
+            {
+              std::string delimiter = "*";
+              std::string constant = len_time.substr(0, len_time.find(delimiter)); // token is <constant>
+              final_time = std::stod(constant) * M_PI;
+            }
+            else
+            {
+              final_time = std::stod(len_time);
+            }
+            dt = std::stod(std::string(argv[3]));
+            eps = std::stof(std::string(argv[4]));
+            num_bodies = std::stoi(std::string(argv[5]));
+
+            // ensuring num_planets input is of type int
+            if( (num_bodies-std::stod(std::string(argv[5])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+          } 
+
+          // catching exception if any input is of invalid data type
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          // both runs start from the same bodies
+          RandomInitialGenerator randgen;
+          auto initial_conditions = randgen.GenerateInitialConditions(num_bodies);
+
+          std::vector<std::string> solver_names = {"direct", "mixed"};
+          std::vector<ParticleStore> final_states;
+
+          AddDelimiter();
+          std::cout << "Solver\t\t" << "Relative energy error\t" << "Time (seconds)\t" << "Largest distance to double precision positions" << std::endl;
+
+          for(const std::string& solver_name : solver_names)
+          {
+            SolarSystem general_system(initial_conditions);
+            general_system.SetForceSolver(MakeForceSolver(solver_name));
+
+            // the softened energy, which the softened dynamics conserve
+            double init_energy = general_system.GetDiagnostics(eps).total_energy;
+
+            auto start_time = std::chrono::high_resolution_clock::now();
+            general_system.TimeEvolve(final_time, dt, eps);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            double time_taken = std::chrono::duration<double>(end_time - start_time).count();
+
+            double energy_error = std::abs((general_system.GetDiagnostics(eps).total_energy - init_energy) / init_energy);
+            final_states.push_back(general_system.GetParticleStore());
+
+            double max_distance = 0.0;
+            for(int i = 0; i < final_states.back().Size(); i++)
+            {
+              max_distance = std::max(max_distance, (final_states.back().GetPosition(i) - final_states.front().GetPosition(i)).norm());
+            }
+            std::cout << solver_name << "\t\t" << energy_error << "\t\t" << time_taken << "\t\t" << max_distance << std::endl;
+          }
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-adapt")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        {
+          std::cout << "Please input the total length of time to simulate the evolution of the solar system, the tolerance and the softening factor epsilon.\n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the adaptive run in this case
+        case 5:
+        {
+          // input of len_time
+          auto len_time = std::string(argv[2]);
+
+          // processing and validating inputs
+          double final_time;
+          double tolerance;
+          float eps;
+          try 
+          {
+            // if the user uses π
+            if (len_time.find("PI") != std::string::npos || len_time.find("pi") != std::string::npos)
+            {
+              std::string delimiter = "*";
+              std::string constant = len_time.substr(0, len_time.find(delimiter)); // token is <constant>
+              final_time = std::stod(constant) * M_PI;
+            }
+            else
+            {
+              final_time = std::stod(len_time);
+            }
+            tolerance = std::stod(std::string(argv[3]));
+            eps = std::stof(std::string(argv[4]));
+          } 
+
+          // catching exception if any input is of invalid data type
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          std::shared_ptr<BulirschStoerIntegrator> integrator;
+          try
+          {
+            integrator = std::make_shared<BulirschStoerIntegrator>(tolerance);
+          }
+
+          // catching exception if the tolerance is not positive
+          catch(const std::logic_error& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            show_usage();
+            break;
+          }
+
+          SolarSystemGenerator ssgen;
+          SolarSystem solar_system(ssgen.GenerateInitialConditions());
+          solar_system.SetIntegrator(integrator);
+          double init_energy = solar_system.GetDiagnostics(eps).total_energy;
+
+          AddDelimiter();
+          std::cout << "Earth's starting position:\n" << solar_system.GetParticle(3).GetPosition() << std::endl;
+
+          // one step of the integrator covers the whole run, with as many internal steps as the tolerance needs
+          std::cout<< "STARTING EVOLUTION" << std::endl;
+          auto start_time = std::chrono::high_resolution_clock::now();
+          solar_system.Step(final_time, eps);
+          auto end_time = std::chrono::high_resolution_clock::now();
+          double time_taken = std::chrono::duration<double>(end_time - start_time).count();
+
+          double energy_error = std::abs((solar_system.GetDiagnostics(eps).total_energy - init_energy) / init_energy);
+
+          AddDelimiter();
+          std::cout << "Earth's final position:\n" << solar_system.GetParticle(3).GetPosition() << std::endl;
+          AddDelimiter();
+          std::cout << "Tolerance\t\t" << tolerance << "\n"
+                    << "Relative energy error\t" << energy_error << "\n"
+                    << "Steps taken\t\t" << integrator->GetStepsTaken() << "\n"
+                    << "Steps rejected\t\t" << integrator->GetStepsRejected() << "\n"
+                    << "Average timestep\t" << final_time / integrator->GetStepsTaken() << "\n"
+                    << "Force evaluations\t" << integrator->GetForceEvaluations() << "\n"
+                    << "Time (seconds)\t\t" << time_taken << "\n"
+                    << std::endl;
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-ens")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        {
+          std::cout << "Please input the total length of time to simulate the evolution of the general solar systems, the timestep dt, the softening factor epsilon, the number of systems and the largest number of planets of a system.\n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the ensemble run in this case
+        case 7:
+        case 8:
+        {
+          // input of len_time
+          auto len_time = std::string(argv[2]);
+
+          // processing and validating inputs
+          double final_time;
+          double dt;
+          float eps;
+          int num_systems;
+          int max_planets;
+          int num_threads;
+          try 
+          {
+            // if the user uses π
+            if (len_time.find("PI") != std::string::npos || len_time.find("pi") != std::string::npos)
+            {
+              std::string delimiter = "*";
+              std::string constant = len_time.substr(0, len_time.find(delimiter)); // token is <constant>
+              final_time = std::stod(constant) * M_PI;
+            }
+            else
+            {
+              final_time = std::stod(len_time);
+            }
+            dt = std::stod(std::string(argv[3]));
+            eps = std::stof(std::string(argv[4]));
+            num_systems = std::stoi(std::string(argv[5]));
+            max_planets = std::stoi(std::string(argv[6]));
+            num_threads = argc == 8 ? std::stoi(std::string(argv[7])) : omp_get_max_threads();
+
+            // ensuring the counts are of type int and positive
+            for(int k = 5; k < argc; k++)
+            {
+              if( (std::stoi(std::string(argv[k]))-std::stod(std::string(argv[k])))!=0 )
+              {
+                throw std::invalid_argument( "Input is of type float or double" );
+              }
+            }
+            if(num_systems < 1 || max_planets < 1 || num_threads < 1)
+            {
+              throw std::invalid_argument( "The number of systems, planets and threads should be at least 1" );
+            }
+          } 
+
+          // catching exception if any input is of invalid data type
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          // systems of different sizes, to be balanced over the threads
+          RandomInitialGenerator randgen;
+          std::mt19937 size_engine(std::random_device{}());
+          std::uniform_int_distribution<int> size_distribution(1, max_planets);
+          std::vector<std::vector<Particle>> initial_conditions;
+          for(int k = 0; k < num_systems; k++)
+          {
+            initial_conditions.push_back(randgen.GenerateInitialConditions(size_distribution(size_engine)));
+          }
+
+          std::cout<< "STARTING ENSEMBLE" << std::endl;
+          EnsembleRunner runner(num_threads);
+          EnsembleReport report = runner.Run(initial_conditions, final_time, dt, eps);
+
+          // the same systems one after the other, each with its force loops parallel over num_threads threads
+          std::cout<< "STARTING SEQUENTIAL RUN" << std::endl;
+          omp_set_num_threads(num_threads);
+          auto start_time = std::chrono::high_resolution_clock::now();
+          for(const auto& system_gen : initial_conditions)
+          {
+            SolarSystem general_system(system_gen);
+            general_system.TimeEvolve(final_time, dt, eps);
+          }
+          auto end_time = std::chrono::high_resolution_clock::now();
+          double sequential_time = std::chrono::duration<double>(end_time - start_time).count();
+
+          AddDelimiter();
+
+          const EnsembleStatistics& statistics = report.statistics;
+          std::cout << "Number of systems\t\t" << statistics.num_systems << "\n"
+                    << "Number of threads\t\t" << report.num_threads << "\n"
+                    << "Systems stolen\t\t\t" << report.num_stolen << "\n"
+                    << "Timestep\t\t\t" << dt << "\n"
+                    << "Mean relative energy loss\t" << statistics.mean_energy_loss << "\n"
+                    << "Standard deviation\t\t" << statistics.std_energy_loss << "\n"
+                    << "Smallest relative energy loss\t" << statistics.min_energy_loss << "\n"
+                    << "Median relative energy loss\t" << statistics.median_energy_loss << "\n"
+                    << "Largest relative energy loss\t" << statistics.max_energy_loss << "\n"
+                    << "Ensemble time (seconds)\t\t" << report.wall_seconds << "\n"
+                    << "Sum of system times (seconds)\t" << report.system_seconds << "\n"
+                    << "Sequential time (seconds)\t" << sequential_time << "\n"
+                    << std::endl;
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-fc")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        {
+          std::cout << "Please input the number of planets in the general solar system, the softening factor epsilon and the force solver to compare. \n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the comparison in this case
+        case 5:
+        {
+          // processing and validating inputs
+          int num_bodies;
+          float eps;
+          try 
+          {
+            num_bodies = std::stoi(std::string(argv[2]));
+
+            // ensuring num_planets input is of type int
+            if( (num_bodies-std::stod(std::string(argv[2])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+            eps = std::stof(std::string(argv[3]));
+          } 
+
+          // catching exception if any input is of invalid data type
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          // variable solver
+          std::string solver_input = argv[4];
+          std::shared_ptr<ForceSolver> solver;
+          try
+          {
+            solver = MakeForceSolver(solver_input);
+          }
+
+          // catching exception if <solver> is not a known solver or its parameter is invalid
+          catch(const std::exception& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            std::cerr << "Input a valid solver and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          RandomInitialGenerator randgen;
+          ParticleStore particles(randgen.GenerateInitialConditions(num_bodies));
+
+          // measuring the error on at most 1000 bodies to keep the direct summation affordable
+          auto comparison = ForceSolver::CompareWithDirectSum(*solver, particles, eps, 1000);
+
+          AddDelimiter();
+          std::cout << "Number of bodies\t\t" << particles.Size() << "\n"
+                    << "Force solver\t\t\t" << solver_input << "\n"
+                    << "Solver time (seconds)\t\t" << comparison.solver_seconds << "\n"
+                    << "Direct sum time (seconds)\t" << comparison.direct_seconds << " (estimated from " << comparison.sample_size << " bodies)\n"
+                    << "Speedup\t\t\t\t" << comparison.direct_seconds / comparison.solver_seconds << "\n"
+                    << "Max relative error\t\t" << comparison.max_relative_error << "\n"
+                    << "RMS relative error\t\t" << comparison.rms_relative_error << "\n"
+                    << std::endl;
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-scale")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        {
+          std::cout << "Please input the number of timesteps, the softening factor epsilon, the number of planets in the general solar system and the largest number of threads. \n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the strong scaling benchmark in these cases
+        case 6:
+        case 7:
+        {
+          int num_timesteps;
+          float eps;
+          int num_bodies;
+          int max_threads;
+          try
+          {
+            num_timesteps = std::stoi(std::string(argv[2]));
+            eps = std::stof(std::string(argv[3]));
+            num_bodies = std::stoi(std::string(argv[4]));
+            max_threads = std::stoi(std::string(argv[5]));
+
+            // ensuring the integer inputs are of type int
+            if( (num_timesteps-std::stod(std::string(argv[2])))!=0 || (num_bodies-std::stod(std::string(argv[4])))!=0 || (max_threads-std::stod(std::string(argv[5])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+            if( max_threads < 1 )
+            {
+              throw std::invalid_argument( "The largest number of threads should be at least 1" );
+            }
+          }
+
+          // catching exception if any input is of invalid data type
+          catch(const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // every run starts from the same initial conditions
+          RandomInitialGenerator randgen;
+          auto initial_conditions = randgen.GenerateInitialConditions(num_bodies);
+
+          std::string schedule_input = argc == 7 ? std::string(argv[6]) : "static";
+          try
+          {
+            SolarSystem solar_system(initial_conditions);
+            SetScheduleFromInput(solar_system, schedule_input);
+          }
+
+          // catching exception if <schedule> is not a known schedule or its chunk size is invalid
+          catch(const std::exception& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            std::cerr << "Input a valid schedule and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // numbers of threads 1, 2, 4, ... and finally max_threads
+          std::vector<int> thread_counts;
+          for(int num_threads = 1; num_threads < max_threads; num_threads *= 2)
+          {
+            thread_counts.push_back(num_threads);
+          }
+          thread_counts.push_back(max_threads);
+
+          AddDelimiter();
+          std::cout << "Number of bodies\t" << num_bodies + 1 << "\n"
+                    << "Number of timesteps\t" << num_timesteps << "\n"
+                    << "Schedule\t\t" << schedule_input << "\n"
+                    << "Available processors\t" << omp_get_num_procs() << "\n" << std::endl;
+          std::cout << "Threads\t\t" << "Time (seconds)\t" << "Speedup\t\t" << "Efficiency" << std::endl;
+
+          const int default_threads = omp_get_max_threads();
+          double serial_time = 0.0;
+          for(int num_threads : thread_counts)
+          {
+            omp_set_num_threads(num_threads);
+
+            // Euler steps with the direct summation, whose force loop runs with the chosen schedule
+            SolarSystem solar_system(initial_conditions);
+            solar_system.SetForceSolver(std::make_shared<DirectSumSolver>());
+            SetScheduleFromInput(solar_system, schedule_input);
+
+            // Marking the start time
+            auto start_time = std::chrono::high_resolution_clock::now();
+
+            for(int step = 0; step < num_timesteps; step++)
+            {
+              solar_system.Step(0.001, eps);
+            }
+
+            // Marking the end time
+            auto end_time = std::chrono::high_resolution_clock::now();
+            double time_taken = std::chrono::duration<double>(end_time - start_time).count();
+
+            if(num_threads == 1)
+            {
+              serial_time = time_taken;
+            }
+            double speedup = serial_time / time_taken;
+            std::cout << num_threads << "\t\t" << time_taken << "\t" << speedup << "\t\t" << speedup / num_threads << std::endl;
+          }
+          omp_set_num_threads(default_threads);
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-dist")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        {
+          std::cout << "Please input the number of timesteps, the softening factor epsilon, the number of planets in the general solar system and the largest number of processes. \n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // do the distributed scaling report in this case
+        case 6:
+        {
+          int num_timesteps;
+          float eps;
+          int num_bodies;
+          int max_ranks;
+          try
+          {
+            num_timesteps = std::stoi(std::string(argv[2]));
+            eps = std::stof(std::string(argv[3]));
+            num_bodies = std::stoi(std::string(argv[4]));
+            max_ranks = std::stoi(std::string(argv[5]));
+
+            // ensuring the integer inputs are of type int
+            if( (num_timesteps-std::stod(std::string(argv[2])))!=0 || (num_bodies-std::stod(std::string(argv[4])))!=0 || (max_ranks-std::stod(std::string(argv[5])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+            if( max_ranks < 1 )
+            {
+              throw std::invalid_argument( "The largest number of processes should be at least 1" );
+            }
+          }
+
+          // catching exception if any input is of invalid data type
+          catch(const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          }
+
+          // the initial conditions are generated once before any process is forked, so every rank sees the same bodies
+          RandomInitialGenerator randgen;
+          auto initial_conditions = randgen.GenerateInitialConditions(num_bodies);
+
+          // numbers of processes 1, 2, 4, ... and finally max_ranks
+          std::vector<int> rank_counts;
+          for(int num_ranks = 1; num_ranks < max_ranks; num_ranks *= 2)
+          {
+            rank_counts.push_back(num_ranks);
+          }
+          rank_counts.push_back(max_ranks);
+
+          AddDelimiter();
+          std::cout << "Number of bodies\t" << num_bodies + 1 << "\n"
+                    << "Number of timesteps\t" << num_timesteps << "\n"
+                    << "Available processors\t" << omp_get_num_procs() << "\n" << std::endl;
+          std::cout << "Processes\t" << "Time (seconds)\t" << "Speedup\t\t" << "Efficiency\t" << "Max position difference" << std::endl;
+
+          double serial_time = 0.0;
+          std::vector<double> serial_x;
+          for(int num_ranks : rank_counts)
+          {
+            auto transport = num_ranks == 1 ? std::shared_ptr<Transport>(std::make_shared<SerialTransport>())
+                                            : std::shared_ptr<Transport>(SocketTransport::Fork(num_ranks));
+            DistributedSolarSystem solar_system(initial_conditions, transport);
+
+            // Marking the start time
+            auto start_time = std::chrono::high_resolution_clock::now();
+
+            solar_system.Evolve(num_timesteps, 0.001, eps);
+
+            // Marking the end time
+            auto end_time = std::chrono::high_resolution_clock::now();
+            double time_taken = std::chrono::duration<double>(end_time - start_time).count();
+
+            const ParticleStore& particles = solar_system.Gather();
+
+            // the child processes exit here
+            auto socket_transport = std::dynamic_pointer_cast<SocketTransport>(transport);
+            if (socket_transport)
+            {
+              socket_transport->Finish();
+            }
+
+            if(num_ranks == 1)
+            {
+              serial_time = time_taken;
+              serial_x = particles.x;
+            }
+            double max_difference = 0.0;
+            for(int i = 0; i < particles.Size(); i++)
+            {
+              max_difference = std::max(max_difference, std::abs(particles.x[i] - serial_x[i]));
+            }
+            double speedup = serial_time / time_taken;
+            std::cout << num_ranks << "\t\t" << time_taken << "\t" << speedup << "\t\t" << speedup / num_ranks << "\t\t" << max_difference << std::endl;
+          }
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
+    else if(mode == "-rec")
+    {
+      switch (argc) 
+      {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        {
+          std::cout << "Please input the total length of time, the timestep dt, the softening factor epsilon, the interval between frames and the name of the trajectory file.\n" 
+                    << "Check the help message below for more detail:\n"
+                    << std::endl;
+          show_usage();
+          break;
+        }
+
+        // record the trajectory in these cases
+        case 7:
+        case 8:
+        {
+          // input of len_time
+          auto len_time = std::string(argv[2]);
+
+          double final_time;
+          double dt;
+          float eps;
+          int interval;
+          try 
+          {
+            // if the user uses π
+            if (len_time.find("PI") != std::string::npos || len_time.find("pi") != std::string::npos)
+            {
+              std::string delimiter = "*";
+              std::string constant = len_time.substr(0, len_time.find(delimiter)); // token is <constant>
+              final_time = std::stod(constant) * M_PI;
+            }
+            else
+            {
+              final_time = std::stod(len_time);
+            }
+            dt = std::stod(std::string(argv[3]));
+            eps = std::stof(std::string(argv[4]));
+            interval = std::stoi(std::string(argv[5]));
+
+            // ensuring interval input is of type int
+            if( (interval-std::stod(std::string(argv[5])))!=0 )
+            {
+              throw std::invalid_argument( "Input is of type float or double" );
+            }
+            if( argc == 8 && std::string(argv[7]) != "float" )
+            {
+              throw std::invalid_argument( "The last argument can only be float" );
+            }
+          } 
+
+          // catching exception if any input is of invalid data type
+          catch (const std::invalid_argument& err) 
+          {
+            std::cerr << "Caught an invalid_argument exception. " << err.what() << std::endl;
+            std::cerr << "Input valid data type and check the help message below" << std::endl;
+            show_usage();
+            break;
+          } 
+
+          std::string filename = argv[6];
+          auto precision = argc == 8 ? TrajectoryWriter::Precision::Float : TrajectoryWriter::Precision::Double;
+
+          SolarSystemGenerator ssgen;
+          SolarSystem solar_system(ssgen.GenerateInitialConditions());
+          std::shared_ptr<TrajectoryWriter> writer;
+          try
+          {
+            writer = std::make_shared<TrajectoryWriter>(filename, solar_system.GetMasses(), precision);
+            solar_system.SetTrajectoryWriter(writer, interval);
+          }
+
+          // catching exception if the file cannot be written or the interval is invalid
+          catch(const std::exception& err)
+          {
+            std::cerr << "Caught an exception. " << err.what() << std::endl;
+            show_usage();
+            break;
+          }
+
+          // Marking the start time
+          auto start_time = std::chrono::high_resolution_clock::now();
+
+          solar_system.TimeEvolve(final_time, dt, eps);
+          writer->Close();
+
+          // Marking the end time
+          auto end_time = std::chrono::high_resolution_clock::now();
+          auto time_taken = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+
+          TrajectoryReader reader(filename);
+          auto last_frame = reader.NumFrames() - 1;
+
+          AddDelimiter();
+          std::cout << "Trajectory file\t\t\t" << filename << "\n"
+                    << "Frames written\t\t\t" << reader.NumFrames() << "\n"
+                    << "Bytes per frame\t\t\t" << TrajectoryWriter::FrameBytes(reader.NumParticles(), precision) << "\n"
+                    << "Time taken (microseconds)\t" << time_taken << "\n"
+                    << "Last frame: step " << reader.GetStep(last_frame) << " at time " << reader.GetTime(last_frame) << "\n"
+                    << "Earth position in the last frame:\n" << reader.GetPosition(last_frame, 3) << "\n"
+                    << std::endl;
+          return 0;
+        }
+
+        default:
+        {
+          std::cout << "Too much arguments\n"
+                    << "Invalid input: "
+                    << input
+                    << std::endl;
+          show_usage();
+          break;
+        }
+      }
+    }
     else
     {
       std::cout << "Invalid input: "
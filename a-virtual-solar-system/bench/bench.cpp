@@ -0,0 +1,200 @@
+#include <benchmark/benchmark.h>
+#include <omp.h>
+#include <vector>
+#include <particle.hpp>
+#include <fixed_solar_system.hpp>
+#include <solar_system_batch.hpp>
+
+// microbenchmarks of the force calculation, the evolution, the energy and the initial conditions
+// sizes go from the 9 bodies of the solar system up to 100000, and the parallel parts run on 1, 2, 4, ... threads
+// up to the OpenMP maximum; the results can be written as JSON with --benchmark_out=<file> --benchmark_out_format=json
+
+// floating point operations of one softened pair interaction (3 subtractions, 3 multiply-adds for r^2 + eps^2, the square
+// root and division for 1/r^3, and 3 multiply-adds into the sum), the usual count for direct N-body codes
+static const double flops_per_pair = 20.0;
+
+static const float epsilon = 0.01;
+
+// pair interactions per second and GFLOP/s from the number of pairs evaluated by all iterations
+static void SetPairCounters(benchmark::State& state, double pairs_per_iteration)
+{
+  double pairs = pairs_per_iteration * state.iterations();
+  state.counters["pairs/s"] = benchmark::Counter(pairs, benchmark::Counter::kIsRate);
+  state.counters["GFLOP/s"] = benchmark::Counter(pairs * flops_per_pair / 1e9, benchmark::Counter::kIsRate);
+}
+
+// running the OpenMP parts of a benchmark on the given number of threads, and restoring the previous number afterwards
+class ThreadCount
+{
+  public:
+  ThreadCount(int num_threads) : previous_threads(omp_get_max_threads())
+  {
+    omp_set_num_threads(num_threads);
+  }
+
+  ~ThreadCount()
+  {
+    omp_set_num_threads(previous_threads);
+  }
+
+  private:
+  int previous_threads;
+};
+
+// the bodies of a general solar system with num_particles bodies in total, the same for every run
+static std::vector<Particle> MakeParticles(int num_particles)
+{
+  RandomInitialGenerator randgen(42);
+  return randgen.GenerateInitialConditions(num_particles - 1);
+}
+
+// N = 9, 100, 1000, 10000 and 100000
+static void Sizes(benchmark::internal::Benchmark* bench)
+{
+  for(int num_particles : {9, 100, 1000, 10000, 100000})
+  {
+    bench->Arg(num_particles);
+  }
+}
+
+// every size on 1, 2, 4, ... threads, and on the largest number of threads if that is not a power of 2
+static void SizesAndThreads(benchmark::internal::Benchmark* bench)
+{
+  const int max_threads = omp_get_max_threads();
+  for(int num_particles : {9, 100, 1000, 10000, 100000})
+  {
+    for(int threads = 1; threads < max_threads; threads *= 2)
+    {
+      bench->Args({num_particles, threads});
+    }
+    bench->Args({num_particles, max_threads});
+  }
+}
+
+// one pair of bodies
+static void BM_CalcAcceleration(benchmark::State& state)
+{
+  auto particles = MakeParticles(9);
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(particles[3].CalcAcceleration(particles[3], particles[5], epsilon));
+  }
+  SetPairCounters(state, 1);
+}
+BENCHMARK(BM_CalcAcceleration);
+
+// one body pulled by all others, through the std::vector<Particle> interface
+static void BM_CalculateTotalAcceleration(benchmark::State& state)
+{
+  const int num_particles = state.range(0);
+  ThreadCount threads(state.range(1));
+  auto particles = MakeParticles(num_particles);
+  Particle target = particles[1];
+
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(target.CalculateTotalAcceleration(particles, 1, epsilon));
+  }
+  SetPairCounters(state, num_particles - 1);
+}
+BENCHMARK(BM_CalculateTotalAcceleration)->Apply(SizesAndThreads);
+
+// a full Euler step of TimeEvolve with the default PairwiseSolver, which visits every pair once
+static void BM_Step(benchmark::State& state)
+{
+  const int num_particles = state.range(0);
+  ThreadCount threads(state.range(1));
+  SolarSystem system(MakeParticles(num_particles));
+
+  for(auto _ : state)
+  {
+    system.Step(1e-6, epsilon);
+  }
+  SetPairCounters(state, 0.5 * num_particles * (num_particles - 1.0));
+}
+BENCHMARK(BM_Step)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond);
+
+// the Euler step of the 9 bodies of the solar system with the compile-time kernels of FixedSolarSystem, to compare with
+// BM_Step/9/1; only the 8 planets are pulled, each by the 8 other bodies
+static void BM_FixedSolarSystemStep(benchmark::State& state)
+{
+  SolarSystemGenerator ssgen;
+  FixedSolarSystem<9> system(ssgen.GenerateInitialConditions());
+
+  for(auto _ : state)
+  {
+    system.Step(1e-6, epsilon);
+  }
+  SetPairCounters(state, 8 * 8);
+}
+BENCHMARK(BM_FixedSolarSystemStep);
+
+// an Euler step of many 9 body solar systems with one system in every SIMD lane, reported in system steps per second
+static void BM_SolarSystemBatchStep(benchmark::State& state)
+{
+  const int num_systems = state.range(0);
+  ThreadCount threads(state.range(1));
+  SolarSystemGenerator ssgen;
+  std::vector<std::vector<Particle>> systems;
+  for(int s = 0; s < num_systems; s++)
+  {
+    systems.push_back(ssgen.GenerateInitialConditions());
+  }
+  SolarSystemBatch batch(systems);
+
+  for(auto _ : state)
+  {
+    batch.Step(1e-6, epsilon);
+  }
+  SetPairCounters(state, 8 * 8 * num_systems);
+  state.counters["system steps/s"] = benchmark::Counter(double(num_systems) * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SolarSystemBatchStep)->ArgsProduct({{8, 64, 1024, 16384}, {1}});
+
+// kinetic plus potential energy, with a separate pass over the pairs
+static void BM_TotalSystemEnergy(benchmark::State& state)
+{
+  const int num_particles = state.range(0);
+  ThreadCount threads(state.range(1));
+  SolarSystem system(MakeParticles(num_particles));
+
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(system.TotalSystemEnergy());
+  }
+  SetPairCounters(state, 0.5 * num_particles * (num_particles - 1.0));
+}
+BENCHMARK(BM_TotalSystemEnergy)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond);
+
+// an Euler step followed by the diagnostics, whose potential energy comes out of the force pass of the step
+static void BM_StepWithDiagnostics(benchmark::State& state)
+{
+  const int num_particles = state.range(0);
+  ThreadCount threads(state.range(1));
+  SolarSystem system(MakeParticles(num_particles));
+  system.SetDiagnosticsInterval(1);
+
+  for(auto _ : state)
+  {
+    system.Step(1e-6, epsilon);
+    benchmark::DoNotOptimize(system.GetDiagnostics(epsilon));
+  }
+  SetPairCounters(state, 0.5 * num_particles * (num_particles - 1.0));
+}
+BENCHMARK(BM_StepWithDiagnostics)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond);
+
+// the initial conditions of a general solar system, reported in bodies per second
+static void BM_GenerateInitialConditions(benchmark::State& state)
+{
+  const int num_particles = state.range(0);
+  RandomInitialGenerator randgen(42);
+
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(randgen.GenerateInitialConditions(num_particles - 1));
+  }
+  state.counters["bodies/s"] = benchmark::Counter(double(num_particles) * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_GenerateInitialConditions)->Apply(Sizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,47 @@
+#ifndef barnes_hut_h
+#define barnes_hut_h
+
+#include <vector>
+#include "force_solver.hpp"
+#include "octree.hpp"
+
+// Barnes-Hut octree force solver, O(N log N) per evaluation
+// a cell of size s whose centre of mass is at distance d from a body is replaced by its total mass when
+// d > s / theta + delta, where delta is the offset between the centre of mass and the centre of the cell
+class BarnesHutSolver : public ForceSolver
+{
+    public:
+    // theta is the opening angle from 0 to 1, theta = 0 reduces to the direct sum;
+    // the tree is rebuilt every rebuild_interval evaluations and only refitted to the new positions in between
+    BarnesHutSolver(double theta = 0.5, int rebuild_interval = 1, int leaf_size = 8);
+
+    double GetTheta() const;
+
+    int NumNodes() const;
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    private:
+    // monopole and bounding box of an octree cell
+    struct Cell
+    {
+        double mass;
+        double com[3];
+
+        double min[3];
+        double max[3];
+
+        // opening distance size / theta + delta
+        double open_distance;
+    };
+
+    void Refit(const ParticleStore& particles);
+
+    double theta;
+    int rebuild_interval;
+    int evaluations_since_build;
+
+    Octree tree;
+    std::vector<Cell> cells;
+};
+#endif
@@ -0,0 +1,90 @@
+#ifndef checkpoint_h
+#define checkpoint_h
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "particle_store.hpp"
+
+// full state of a SolarSystem::TimeEvolve run at the end of a step, enough to continue it bit for bit
+struct Checkpoint
+{
+    // positions, velocities, accelerations and masses of all bodies
+    ParticleStore particles;
+
+    // number of steps taken and value of the time loop variable for the next step
+    std::int64_t step;
+    double time;
+
+    // parameters of the TimeEvolve run
+    double final_time;
+    double dt;
+    float epsilon;
+
+    // number of OpenMP threads of the run; the pairwise solvers give results that differ in the last bits with
+    // different numbers of threads, so a restart needs the same number to continue bit for bit
+    std::int32_t num_threads;
+
+    // name and internal state of the integrator, and whether the stored accelerations belong to the positions
+    std::string integrator;
+    std::vector<double> integrator_state;
+    bool accelerations_current;
+
+    // description of the run from the application (e.g. its arguments) and state of the random engine of the
+    // initial condition generator before the bodies were generated
+    std::string run_info;
+    std::string generator_state;
+};
+
+// writes checkpoints to a compact binary snapshot file without adding to the step time
+// the snapshot is copied on the calling thread and written by a background thread; every snapshot first goes to
+// filename.tmp and is then renamed over filename, so a run killed while writing keeps the previous snapshot
+class CheckpointWriter
+{
+    public:
+    // run_info and generator_state are stored with every snapshot
+    CheckpointWriter(const std::string& filename, const std::string& run_info = "", const std::string& generator_state = "");
+
+    // waiting for the last snapshot to be written
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // queuing a snapshot, the caller only waits if the previous one is still being written
+    void Write(const Checkpoint& checkpoint);
+
+    // waiting for all queued snapshots to be written; throws if any write failed
+    void Close();
+
+    std::int64_t NumWritten() const;
+
+    // writing a snapshot on the calling thread
+    static void WriteFile(const std::string& filename, const Checkpoint& checkpoint);
+
+    // reading a snapshot, throws if the file is not a checkpoint
+    static Checkpoint ReadFile(const std::string& filename);
+
+    private:
+    // body of the background I/O thread
+    void WriteLoop();
+
+    std::string filename;
+    std::string run_info;
+    std::string generator_state;
+    std::int64_t num_written;
+
+    // snapshot waiting for the I/O thread
+    Checkpoint pending;
+    bool has_pending;
+    bool closing;
+    bool write_failed;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::thread io_thread;
+};
+#endif
@@ -0,0 +1,46 @@
+#ifndef distributed_h
+#define distributed_h
+
+#include <memory>
+#include <vector>
+#include "particle_store.hpp"
+#include "transport.hpp"
+
+class Particle;
+
+// a SolarSystem split over the ranks of a Transport by particle decomposition
+// every rank holds the positions of all bodies but only advances its own contiguous block of them;
+// after every step the new positions are exchanged with a ring all-gather
+// the blocks follow from the number of bodies and ranks alone, so for the same initial conditions the run matches
+// SolarSystem with the DirectSumSolver and the EulerIntegrator on a single process to the last bit
+class DistributedSolarSystem
+{
+    public:
+    DistributedSolarSystem(const std::vector<Particle>& particles, std::shared_ptr<Transport> transport);
+
+    // one Euler step with the direct summation, leaving the central star fixed
+    void Step(double dt, float epsilon);
+
+    void Evolve(int num_steps, double dt, float epsilon);
+
+    // bodies [OwnedBegin(), OwnedEnd()) are advanced by this rank
+    int OwnedBegin() const;
+
+    int OwnedEnd() const;
+
+    // collecting the velocities and accelerations of all bodies on every rank, the positions are always complete
+    // every rank has to call it
+    const ParticleStore& Gather();
+
+    // total energy of all bodies, calling Gather
+    double TotalSystemEnergy();
+
+    private:
+    ParticleStore system;
+
+    std::shared_ptr<Transport> transport;
+
+    // block of bodies of every rank
+    std::vector<int> offsets;
+};
+#endif
@@ -0,0 +1,82 @@
+#ifndef ensemble_h
+#define ensemble_h
+
+#include <functional>
+#include <vector>
+#include "particle.hpp"
+
+// outcome of one system of an ensemble
+struct EnsembleResult
+{
+    int num_bodies;
+
+    // softened total energies before and after the evolution, see Diagnostics
+    double initial_energy;
+    double final_energy;
+
+    // (E_final - E_initial) / |E_initial|
+    double relative_energy_loss;
+
+    // wall time of the evolution of this system
+    double seconds;
+
+    // thread that evolved the system, and whether it took the system from the queue of another thread
+    int thread;
+    bool stolen;
+};
+
+// statistics of the relative energy loss over all systems of an ensemble
+struct EnsembleStatistics
+{
+    int num_systems;
+    double mean_energy_loss;
+    double std_energy_loss;
+    double min_energy_loss;
+    double median_energy_loss;
+    double max_energy_loss;
+};
+
+struct EnsembleReport
+{
+    // one result for each system, in the order of the initial conditions
+    std::vector<EnsembleResult> results;
+
+    EnsembleStatistics statistics;
+
+    int num_threads;
+    int num_stolen;
+
+    // wall time of the whole ensemble, and the sum of the times of the systems
+    double wall_seconds;
+    double system_seconds;
+};
+
+// evolves many independent solar systems at once, parallel across the systems instead of within each of them
+// every system runs on a single thread, so systems of a few bodies avoid the overhead of the parallel force loops
+// the systems are sorted by their number of pair interactions and dealt out to one queue per thread, largest first;
+// a thread takes the largest systems from the front of its own queue, and when that is empty it steals the smallest
+// ones from the back of the queue of another thread, so systems of different sizes balance over the threads
+class EnsembleRunner
+{
+    public:
+    // called for every system before its evolution, e.g. to choose the force solver or the integrator
+    typedef std::function<void(SolarSystem& system, int index)> Setup;
+
+    // a num_threads of 0 uses omp_get_max_threads() at the time of each run
+    EnsembleRunner(int num_threads = 0);
+
+    void SetSetup(Setup new_setup);
+
+    // evolving every system as SolarSystem::TimeEvolve does; exceptions of a system are thrown again after the run
+    EnsembleReport Run(const std::vector<std::vector<Particle>>& initial_conditions, double final_time, double dt, float epsilon) const;
+
+    // number of threads a run over num_systems systems will use
+    int NumThreads(int num_systems) const;
+
+    static EnsembleStatistics Statistics(const std::vector<EnsembleResult>& results);
+
+    private:
+    int num_threads;
+    Setup setup;
+};
+#endif
@@ -0,0 +1,78 @@
+#ifndef execution_engine_h
+#define execution_engine_h
+
+#include <functional>
+#include <vector>
+
+// runs a whole simulation on one team of threads that stays alive for all timesteps
+// a step is split into phases over the bodies; each thread works on its own fixed block of bodies in every phase,
+// and the phases are separated by barriers, so a phase only starts once the previous one is finished everywhere
+// systems with fewer bodies than the serial threshold are run on the calling thread without any team at all
+class ExecutionEngine
+{
+    public:
+    // a phase of a step, working on the items [begin, end)
+    typedef std::function<void(int begin, int end)> Phase;
+
+    // below this many bodies the fork, join and barriers of a team cost more than the work they share
+    // the loops of SolarSystem::Step and of the force solvers it calls use the same threshold through ParallelFor
+    static constexpr int default_serial_threshold = 128;
+
+    // a num_threads of 0 uses omp_get_max_threads() at the time of each run
+    ExecutionEngine(int num_threads = 0, int serial_threshold = default_serial_threshold);
+
+    // running the phases one after the other for num_steps steps over num_items items
+    void Run(int num_steps, int num_items, const std::vector<Phase>& phases) const;
+
+    // number of threads a run over num_items items will use
+    int NumThreads(int num_items) const;
+
+    int GetSerialThreshold() const;
+
+    private:
+    int num_threads;
+    int serial_threshold;
+};
+
+// body(i) for every i in [begin, end) of a system of num_particles bodies, as a static OpenMP loop
+// below the serial threshold the loop runs on the calling thread without entering the OpenMP runtime at all:
+// even an if(false) parallel region sets up a team of one, which costs more than a step of the solar system
+template<typename Body>
+void ParallelFor(int num_particles, int begin, int end, const Body& body)
+{
+    if (num_particles < ExecutionEngine::default_serial_threshold)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(int i = begin; i < end; i++)
+    {
+        body(i);
+    }
+}
+
+// the same with schedule(runtime), for loops whose schedule is chosen with omp_set_schedule, as in SolarSystem::SetSchedule
+template<typename Body>
+void RuntimeScheduledFor(int num_particles, int begin, int end, const Body& body)
+{
+    if (num_particles < ExecutionEngine::default_serial_threshold)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    #pragma omp parallel for schedule(runtime)
+    for(int i = begin; i < end; i++)
+    {
+        body(i);
+    }
+}
+#endif
@@ -0,0 +1,29 @@
+#ifndef fft_h
+#define fft_h
+
+#include <complex>
+#include <vector>
+
+// iterative radix-2 fast Fourier transform of a fixed power-of-two length, with the twiddle factors and the
+// bit-reversed order worked out once in the constructor
+// the forward transform is sum_k x_k exp(-2 pi i j k / n); the inverse uses the opposite sign and is not divided by n
+class Fft
+{
+    public:
+    Fft(int n);
+
+    int Size() const;
+
+    // in place, on n values spaced stride apart
+    void Transform(std::complex<double>* data, bool inverse, int stride = 1) const;
+
+    private:
+    int n;
+    std::vector<std::complex<double>> twiddles;
+    std::vector<int> bit_reverse;
+};
+
+// in-place 3D transform of a grid of size_x * size_y * size_z values stored with z running fastest,
+// one 1D transform along every line of every axis, with the lines of an axis spread over the OpenMP threads
+void Fft3d(std::vector<std::complex<double>>& grid, const Fft& fft_x, const Fft& fft_y, const Fft& fft_z, bool inverse);
+#endif
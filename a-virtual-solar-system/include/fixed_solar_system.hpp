@@ -0,0 +1,224 @@
+#ifndef fixed_solar_system_h
+#define fixed_solar_system_h
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "particle.hpp"
+
+// the Sun and its first N - 1 bodies from SolarSystemGenerator, with the number of bodies fixed at compile time
+// positions, velocities and accelerations are kept in std::arrays, the masses are the constants of solar_system_masses,
+// and the pair loops are unrolled completely by expanding index sequences, so a step has no loop bounds, no mass loads
+// and no calls left; this is for long runs of a few bodies, where the latency of one step is all that matters
+// a step is the explicit Euler step of a SolarSystem with the DirectSumSolver, with the same operations in the same
+// order, so that both give the same trajectory bit for bit
+template<int N>
+class FixedSolarSystem
+{
+    static_assert(N >= 2 && N <= int(solar_system_masses.size()), "A FixedSolarSystem holds the Sun and 1 to 8 of its bodies.");
+
+    public:
+    // the particles should be the first N bodies of SolarSystemGenerator, with their masses
+    FixedSolarSystem(const std::vector<Particle>& particles);
+
+    void Step(double dt, float epsilon);
+
+    // the same loops as SolarSystem::TimeEvolve and SolarSystem::StepEvolve
+    void TimeEvolve(double final_time, double dt, float epsilon);
+
+    void StepEvolve(int num_steps, double dt, float epsilon);
+
+    Particle GetParticle(int index) const;
+
+    std::vector<Particle> ToParticles() const;
+
+    // kinetic plus potential energy, summed as in SolarSystem::TotalSystemEnergy
+    double TotalSystemEnergy(float epsilon = 0.0) const;
+
+    static constexpr int Size() { return N; }
+
+    private:
+    template<int... i>
+    void UpdateAccelerations(double eps_squared, std::integer_sequence<int, i...>);
+
+    template<int i, int... j>
+    void AccelerationOf(double eps_squared, std::integer_sequence<int, j...>);
+
+    // adding the pull of body j on body i to the sums
+    template<int i, int j>
+    void AddPull(double eps_squared, double& sum_x, double& sum_y, double& sum_z) const;
+
+    std::array<double, N> x, y, z;
+    std::array<double, N> vx, vy, vz;
+    std::array<double, N> ax, ay, az;
+};
+
+template<int N>
+FixedSolarSystem<N>::FixedSolarSystem(const std::vector<Particle>& particles)
+{
+    if (particles.size() != std::size_t(N))
+    {
+        throw std::logic_error("A FixedSolarSystem<" + std::to_string(N) + "> needs exactly " + std::to_string(N) + " bodies.");
+    }
+
+    for(int i = 0; i < N; i++)
+    {
+        if (particles[i].GetMass() != solar_system_masses[i])
+        {
+            throw std::logic_error("The masses of a FixedSolarSystem are those of SolarSystemGenerator, in the same order.");
+        }
+
+        Eigen::Vector3d position = particles[i].GetPosition();
+        Eigen::Vector3d velocity = particles[i].GetVelocity();
+        Eigen::Vector3d acceleration = particles[i].GetAcceleration();
+        x[i] = position(0);
+        y[i] = position(1);
+        z[i] = position(2);
+        vx[i] = velocity(0);
+        vy[i] = velocity(1);
+        vz[i] = velocity(2);
+        ax[i] = acceleration(0);
+        ay[i] = acceleration(1);
+        az[i] = acceleration(2);
+    }
+}
+
+template<int N>
+template<int i, int j>
+inline void FixedSolarSystem<N>::AddPull(double eps_squared, double& sum_x, double& sum_y, double& sum_z) const
+{
+    if constexpr (i != j)
+    {
+        double dx = x[j] - x[i];
+        double dy = y[j] - y[i];
+        double dz = z[j] - z[i];
+        double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+        double factor = solar_system_masses[j] / (dist_squared * std::sqrt(dist_squared));
+
+        sum_x += factor * dx;
+        sum_y += factor * dy;
+        sum_z += factor * dz;
+    }
+}
+
+// the pulls are added in the order of j, as in the direct sum of SolarSystem
+template<int N>
+template<int i, int... j>
+inline void FixedSolarSystem<N>::AccelerationOf(double eps_squared, std::integer_sequence<int, j...>)
+{
+    // the central star does not move, so its acceleration is never needed
+    if constexpr (i > 0)
+    {
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        double sum_z = 0.0;
+
+        (AddPull<i, j>(eps_squared, sum_x, sum_y, sum_z), ...);
+
+        ax[i] = sum_x;
+        ay[i] = sum_y;
+        az[i] = sum_z;
+    }
+}
+
+template<int N>
+template<int... i>
+inline void FixedSolarSystem<N>::UpdateAccelerations(double eps_squared, std::integer_sequence<int, i...>)
+{
+    (AccelerationOf<i>(eps_squared, std::make_integer_sequence<int, N>()), ...);
+}
+
+// acceleration at the old positions, then the drift and the kick of every body except the central star
+template<int N>
+void FixedSolarSystem<N>::Step(double dt, float epsilon)
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+    UpdateAccelerations(eps_squared, std::make_integer_sequence<int, N>());
+
+    for(int i = 1; i < N; i++)
+    {
+        x[i] += dt * vx[i];
+        y[i] += dt * vy[i];
+        z[i] += dt * vz[i];
+    }
+    for(int i = 1; i < N; i++)
+    {
+        vx[i] += dt * ax[i];
+        vy[i] += dt * ay[i];
+        vz[i] += dt * az[i];
+    }
+}
+
+template<int N>
+void FixedSolarSystem<N>::TimeEvolve(double final_time, double dt, float epsilon)
+{
+    for(double t = 0.0; t <= final_time; t+=dt)
+    {
+        Step(dt, epsilon);
+    }
+}
+
+template<int N>
+void FixedSolarSystem<N>::StepEvolve(int num_steps, double dt, float epsilon)
+{
+    int steps = 0;
+    while (steps <= num_steps)
+    {
+        Step(dt, epsilon);
+        steps++;
+    }
+}
+
+template<int N>
+Particle FixedSolarSystem<N>::GetParticle(int index) const
+{
+    if (index < 0 || index >= N)
+    {
+        throw std::logic_error("Index of a body should be between 0 and " + std::to_string(N - 1) + ".");
+    }
+    Particle particle{solar_system_masses[index]};
+    particle.SetPosition(Eigen::Vector3d{x[index], y[index], z[index]});
+    particle.SetVelocity(Eigen::Vector3d{vx[index], vy[index], vz[index]});
+    particle.SetAcceleration(Eigen::Vector3d{ax[index], ay[index], az[index]});
+    return particle;
+}
+
+template<int N>
+std::vector<Particle> FixedSolarSystem<N>::ToParticles() const
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i < N; i++)
+    {
+        particles.push_back(GetParticle(i));
+    }
+    return particles;
+}
+
+template<int N>
+double FixedSolarSystem<N>::TotalSystemEnergy(float epsilon) const
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    double total_ke = 0.;
+    for(int i = 0; i < N; i++)
+    {
+        double v_squared = vx[i]*vx[i] + vy[i]*vy[i] + vz[i]*vz[i];
+        total_ke += solar_system_masses[i] * v_squared / 2;
+    }
+
+    double total_pe = 0.;
+    for(int i = 0; i < N; i++)
+    {
+        for(int j = i + 1; j < N; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            total_pe -= solar_system_masses[i] * solar_system_masses[j] / std::sqrt(dx*dx + dy*dy + dz*dz + eps_squared);
+        }
+    }
+    return total_ke + total_pe;
+}
+#endif
@@ -0,0 +1,88 @@
+#ifndef fmm_h
+#define fmm_h
+
+#include <vector>
+#include "force_solver.hpp"
+#include "octree.hpp"
+
+// fast multipole method with Cartesian Taylor expansions, O(N) per evaluation
+// every cell carries a multipole expansion of its bodies about its centre of mass and a local expansion of the
+// field of distant cells; a dual tree walk lets two cells A and B interact through their expansions when
+// r_A + r_B < theta * |z_A - z_B|, and falls back to direct summation between nearby leaves.
+// the force error falls off roughly as theta^(order + 1)
+class FmmSolver : public ForceSolver
+{
+    public:
+    // order is the highest order of the multipole and local expansions (1 to max_order),
+    // theta the opening angle of the cell-cell interactions (0 <= theta < 1, theta = 0 reduces to the direct sum)
+    FmmSolver(int order = 4, double theta = 0.5, int leaf_size = 16);
+
+    int GetOrder() const;
+
+    void SetOrder(int order);
+
+    double GetTheta() const;
+
+    // raising the expansion order until the RMS relative error of the accelerations, measured against the direct sum
+    // on sample_size bodies, is below tolerance; returns the error reached
+    double TuneOrder(const ParticleStore& particles, float epsilon, double tolerance, int sample_size = 200);
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    static const int max_order = 10;
+
+    private:
+    // a term out[target] += in[source] * factor[factor_index] of the expansion translations
+    struct Term
+    {
+        int target;
+        int source;
+        int factor_index;
+    };
+
+    void SetUpMultiIndices();
+
+    int Index(int a, int b, int c) const;
+
+    // s^k / k! for every multi-index k
+    void Monomials(double s_x, double s_y, double s_z, double* out) const;
+
+    // derivatives d^k G of the softened kernel G = 1 / sqrt(r^2 + epsilon^2) for every multi-index k
+    void Derivatives(double dx, double dy, double dz, double* out, double* workspace) const;
+
+    void Upward(const ParticleStore& particles);
+
+    void Interact(int target, int source);
+
+    void Downward();
+
+    int order;
+    double theta;
+    Octree tree;
+
+    // multi-indices k = (a, b, c) with a + b + c <= order, sorted by degree
+    int num_coefficients;
+    std::vector<int> multi_a, multi_b, multi_c;
+    std::vector<int> index_table;
+
+    // recurrence for the derivative tensor: d^k uses k - e_d and k - 2 e_d along its first non-zero direction d
+    std::vector<int> recurrence_direction, recurrence_minus_one, recurrence_minus_two;
+
+    // terms of the multipole-to-multipole and local-to-local shifts, and of the multipole-to-local translation
+    std::vector<Term> shift_terms;
+    std::vector<Term> m2l_terms;
+    std::vector<double> m2l_signs;
+
+    // per cell data, indexed like the octree nodes
+    std::vector<double> centres;
+    std::vector<double> radii;
+    std::vector<double> multipoles;
+    std::vector<double> locals;
+    std::vector<int> parents;
+    std::vector<std::vector<int>> levels;
+    std::vector<std::vector<int>> m2l_lists;
+    std::vector<std::vector<int>> p2p_lists;
+
+    double eps_squared;
+};
+#endif
@@ -0,0 +1,146 @@
+#ifndef force_solver_h
+#define force_solver_h
+
+#include <vector>
+#include "particle_store.hpp"
+
+// accuracy and cost of a force solver measured against the direct summation
+struct ForceComparison
+{
+    // number of bodies the errors were measured on
+    int sample_size;
+
+    // wall time of one full evaluation by the solver
+    double solver_seconds;
+
+    // wall time of one full direct summation, extrapolated from the sampled bodies
+    double direct_seconds;
+
+    // relative error |a - a_direct| / |a_direct| over the sampled bodies
+    double max_relative_error;
+    double rms_relative_error;
+};
+
+// abstract class for the force calculation backends used by SolarSystem
+class ForceSolver
+{
+    public:
+    virtual ~ForceSolver() = default;
+
+    // writes the acceleration of every body into acc_x, acc_y and acc_z, which must each hold particles.Size() values
+    virtual void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z) = 0;
+
+    // the same, also returning the potential energy -sum_{i<j} m_i m_j / sqrt(r^2 + epsilon^2) of the bodies;
+    // by default a second pass over the pairs, the direct solvers accumulate it inside their force loop
+    virtual double ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    // comparing a solver against the direct summation on sample_size bodies spread evenly through the store
+    static ForceComparison CompareWithDirectSum(ForceSolver& solver, const ParticleStore& particles, float epsilon, int sample_size);
+};
+
+// direct summation over all ordered pairs (i, j), as in SolarSystem::ComputeAccelerations
+class DirectSumSolver : public ForceSolver
+{
+    public:
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    double ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+};
+
+// accumulation buffers of the symmetric pair loops, which visit every pair (i, j > i) once and scatter to both bodies
+// the rows i are split into static blocks of about the same number of pairs, one per thread; every block accumulates into
+// its own buffer and the buffers are summed in block order, so a pass gives the same bits however the threads are scheduled
+// the number of blocks is the number of OpenMP threads, so results differ in the last bits between thread counts;
+// systems below ExecutionEngine::default_serial_threshold have a single block whatever the number of threads
+class PairBuffers
+{
+    public:
+    // omp_get_max_threads() blocks, or one below the serial threshold, each with num_arrays zeroed arrays of num_particles values
+    void Reset(int num_particles, int num_arrays);
+
+    int NumBlocks() const;
+
+    // the rows of a block are [RowBegin(block), RowBegin(block + 1))
+    int RowBegin(int block) const;
+
+    double* Buffer(int block, int array);
+
+    // summing every array over the blocks, in block order, into outputs[array]; to be called by all threads
+    // of the parallel region of the pair loop, which it waits for, or outside any region when there is a single block
+    void Reduce(double* const* outputs);
+
+    private:
+    int num_particles = 0;
+    int num_arrays = 0;
+    std::vector<int> row_begin;
+
+    // laid out as [block][array][particle]
+    std::vector<double> buffers;
+};
+
+// symmetric direct summation using Newton's third law
+// every pair (i, j) is visited once and scatters equal and opposite contributions to both bodies
+// through PairBuffers, so the results are reproducible for a given number of threads
+class PairwiseSolver : public ForceSolver
+{
+    private:
+    // accumulation buffers, with the arrays x, y and z
+    PairBuffers buffers;
+
+    // the force loop, with the potential energy of every pair accumulated alongside when with_potential is set
+    template<bool with_potential>
+    double Accumulate(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    public:
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    double ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+};
+// direct summation vectorised over the bodies j with SSE2, AVX2 or AVX-512 intrinsics
+// the instruction set is picked at runtime from what the CPU supports; 1/r^3 comes from
+// the hardware reciprocal square root estimate refined with Newton-Raphson iterations
+class SimdSolver : public ForceSolver
+{
+    public:
+    enum class InstructionSet { Scalar, SSE2, AVX2, AVX512 };
+
+    // picking the widest instruction set supported by the CPU
+    SimdSolver();
+
+    // forcing an instruction set, throws if the CPU does not support it
+    SimdSolver(InstructionSet instruction_set);
+
+    InstructionSet GetInstructionSet() const;
+
+    static InstructionSet BestInstructionSet();
+
+    static bool IsSupported(InstructionSet instruction_set);
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    private:
+    InstructionSet instruction_set;
+};
+
+// direct summation with the pair forces in single precision, while positions, velocities and the sum over all bodies stay double
+// the separations are subtracted in double and then rounded to float, so their relative error does not grow with the distance
+// from the origin; the masses are downcast once per evaluation, and the pair forces are evaluated in float over blocks of
+// bodies j, which the compiler vectorises; every block sum is then added to a double accumulator, so rounding errors do not
+// grow with the number of bodies. relative errors of the accelerations are around 1e-6
+class MixedPrecisionSolver : public ForceSolver
+{
+    public:
+    // number of bodies j summed in float before the partial sum is added in double
+    MixedPrecisionSolver(int block_size = 256);
+
+    int GetBlockSize() const;
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    private:
+    int block_size;
+
+    // single precision copy of the masses
+    std::vector<float> float_mass;
+};
+#endif
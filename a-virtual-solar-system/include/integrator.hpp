@@ -0,0 +1,286 @@
+#ifndef integrator_h
+#define integrator_h
+
+#include <string>
+#include <vector>
+#include "particle_store.hpp"
+#include "force_solver.hpp"
+
+class SolarSystem;
+
+// abstract class for the time integration schemes used by SolarSystem
+class Integrator
+{
+    public:
+    virtual ~Integrator() = default;
+
+    // advancing every body except the central star by one timestep dt
+    virtual void Step(SolarSystem& system, double dt, float epsilon) = 0;
+
+    virtual std::string GetName() const = 0;
+
+    // number of force evaluations needed for one step
+    virtual int ForceEvaluationsPerStep() const = 0;
+
+    // internal state carried from one step to the next, saved in checkpoints; empty for integrators without any
+    virtual std::vector<double> GetState() const;
+
+    // restoring a state from GetState for the given bodies
+    virtual void SetState(const std::vector<double>& state, const ParticleStore& particles);
+
+    // dropping the state carried over from earlier steps; called by SolarSystem::SetIntegrator
+    virtual void Reset();
+
+    // the version of the system (SolarSystem::GetVersion) that the carried state belongs to, for a restored state
+    void SetStateVersion(unsigned long long version);
+
+    protected:
+    // integrators that carry a state from one step to the next only reuse it while the system still has this version
+    unsigned long long state_version = 0;
+};
+
+// first order explicit Euler, as in Particle::Update: the position moves with the old velocity,
+// then the velocity with the acceleration at the old position
+class EulerIntegrator : public Integrator
+{
+    public:
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+};
+
+// second order symplectic kick-drift-kick leapfrog
+// the acceleration at the end of a step is reused for the first kick of the next one
+class LeapfrogIntegrator : public Integrator
+{
+    public:
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+};
+
+// second order symplectic velocity Verlet in its textbook form
+// x += v dt + a dt^2 / 2, then v += (a_old + a_new) dt / 2; the same trajectory as the leapfrog up to rounding
+class VelocityVerletIntegrator : public Integrator
+{
+    public:
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+
+    private:
+    std::vector<double> old_ax, old_ay, old_az;
+};
+
+// fourth order symplectic integrator of Forest and Ruth (Yoshida's triple jump of the leapfrog)
+// drifts and kicks with weights w1 = 1 / (2 - 2^(1/3)) and w0 = -2^(1/3) w1
+class YoshidaIntegrator : public Integrator
+{
+    public:
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+};
+
+// fourth order Hermite scheme with hierarchical power-of-two block timesteps (Aarseth)
+// each body moves with its own step dt / 2^level, chosen from eta |a| / |jerk|, and only the bodies due at a
+// given time get their forces recomputed; all other bodies are predicted to that time from their Taylor series
+// a step of dt brings every body back to the same time, so dt is the largest timestep a body can take
+class BlockTimestepIntegrator : public Integrator
+{
+    public:
+    BlockTimestepIntegrator(double eta = 0.01, int max_level = 20);
+
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    // upper bound, reached when every body is on the finest level
+    int ForceEvaluationsPerStep() const;
+
+    double GetEta() const;
+
+    int GetMaxLevel() const;
+
+    // timestep level of every body, body i moves with steps of dt / 2^levels[i]
+    const std::vector<int>& GetLevels() const;
+
+    // number of forces on single bodies evaluated so far; a shared timestep scheme needs
+    // (number of bodies - 1) of them per step
+    long long GetBodyForceEvaluations() const;
+
+    // the levels, jerks and counters, together with the dt and epsilon they belong to
+    std::vector<double> GetState() const;
+
+    void SetState(const std::vector<double>& state, const ParticleStore& particles);
+
+    // forgetting the levels, times and jerks; the counter of force evaluations is kept
+    void Reset();
+
+    private:
+    // finest level needed for the criterion eta |a| / |jerk| on a block of length dt
+    int TimestepLevel(double acc, double jerk, double dt) const;
+
+    // forces, jerks and levels of all bodies at the start of a block
+    void Initialise(SolarSystem& system, float epsilon);
+
+    double eta;
+    int max_level;
+    double last_dt;
+    float last_epsilon;
+    long long body_evaluations;
+
+    std::vector<int> levels;
+
+    // time of every body in units of dt / 2^max_level since the start of the block
+    std::vector<long long> times;
+
+    std::vector<double> jerk_x, jerk_y, jerk_z;
+    std::vector<double> new_ax, new_ay, new_az, new_jx, new_jy, new_jz;
+
+    // all bodies predicted to the time of the next force evaluation
+    ParticleStore predicted;
+
+    std::vector<int> active;
+};
+
+// fourth order Hermite predictor-corrector with a shared timestep (Makino and Aarseth)
+// every body is predicted to the end of the step from its Taylor series, the accelerations and jerks are evaluated there,
+// and the corrector v1 = v0 + (a0 + a1) h / 2 + (j0 - j1) h^2 / 12, x1 = x0 + (v0 + v1) h / 2 + (a0 - a1) h^2 / 12 is applied
+// the accelerations and jerks come from one fused pass that visits every pair once, SolarSystem::ComputeAccelerationsAndJerks
+// with PairBuffers, and those at the end of a step are reused at the start of the next one, so a step costs half the pairs
+// of one direct summation; the force solver of the system is not used
+class HermiteIntegrator : public Integrator
+{
+    public:
+    HermiteIntegrator();
+
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+
+    // the jerks of the last step, together with the epsilon they belong to
+    std::vector<double> GetState() const;
+
+    void SetState(const std::vector<double>& state, const ParticleStore& particles);
+
+    // forgetting the jerks
+    void Reset();
+
+    private:
+    float last_epsilon;
+
+    std::vector<double> jerk_x, jerk_y, jerk_z;
+
+    // the state at the start of the step
+    std::vector<double> old_x, old_y, old_z, old_vx, old_vy, old_vz, old_ax, old_ay, old_az, old_jx, old_jy, old_jz;
+
+    // accumulation buffers of the pair pass, with the arrays ax, ay, az, jx, jy and jz
+    PairBuffers buffers;
+};
+
+// second order Wisdom-Holman mixed-variable symplectic integrator for systems dominated by the central star
+// the star stays fixed, so the positions and velocities relative to it are canonical, and the Hamiltonian splits into the
+// Kepler orbit of every body around the star, solved exactly, and the interaction, which holds the pulls between the
+// bodies and the difference between the softened and the Kepler pull of the star
+// kick-Kepler drift-kick with the interaction, whose accelerations at the end of a step are reused at the start of the
+// next one; the energy error is that of the leapfrog scaled down by the mass ratio of the bodies to the star, so steps of
+// about 1/20 of the innermost orbit are enough
+class WisdomHolmanIntegrator : public Integrator
+{
+    public:
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    int ForceEvaluationsPerStep() const;
+
+    // moving a body on its Kepler orbit around a fixed mass mu at the origin for a time dt, for any type of orbit
+    // the universal Kepler equation r0 s + eta0 G2 + mu G3 = dt in the universal anomaly s is solved with Laguerre-Conway
+    // iterations, which converge from any starting point, and the positions and velocities follow from the f and g functions
+    static void KeplerDrift(double mu, double dt, double& x, double& y, double& z, double& vx, double& vy, double& vz);
+
+    private:
+    // kicking every body with the interaction for a time dt, from the full accelerations in the store
+    static void InteractionKick(SolarSystem& system, double dt);
+};
+
+// adaptive Bulirsch-Stoer integrator: Gragg's modified midpoint rule with n = 2, 4, 6, ... substeps, extrapolated to
+// zero substep length with Richardson's polynomial extrapolation in h^2 (Aitken-Neville)
+// the difference between the last two extrapolations estimates the error, which is kept below tolerance (1 + |y|) for
+// the position and the velocity y of every body, absolute for small and relative for large ones; a step whose
+// extrapolations do not converge is rejected and retried with a shorter one, and the length and the number of columns
+// of the next step are chosen for the least work per unit of time (Hairer, Norsett and Wanner)
+// Step covers dt exactly with as many internal steps as needed, so dt is only the output interval
+// the forces come from the direct summation on a copy of the bodies, not from the force solver of the system
+class BulirschStoerIntegrator : public Integrator
+{
+    public:
+    // at most max_columns substep counts 2, 4, ..., 2 max_columns per step (2 to 16)
+    BulirschStoerIntegrator(double tolerance = 1e-10, int max_columns = 8);
+
+    void Step(SolarSystem& system, double dt, float epsilon);
+
+    std::string GetName() const;
+
+    // upper bound, for an internal step that uses every column
+    int ForceEvaluationsPerStep() const;
+
+    double GetTolerance() const;
+
+    // internal steps that were accepted and rejected, and force evaluations of all bodies, so far
+    long long GetStepsTaken() const;
+    long long GetStepsRejected() const;
+    long long GetForceEvaluations() const;
+
+    // length of the next internal step, 0 before the first one
+    double GetNextStep() const;
+
+    // the next step length and number of columns, and the counters
+    std::vector<double> GetState() const;
+
+    void SetState(const std::vector<double>& state, const ParticleStore& particles);
+
+    private:
+    // modified midpoint over a step h with num_substeps substeps from the positions and velocities in start, whose
+    // accelerations are in start_acc; the result goes into the positions and velocities of work
+    void ModifiedMidpoint(double h, int num_substeps, float epsilon);
+
+    // accelerations of the positions in work into the acceleration arrays of work
+    void UpdateWorkAccelerations(float epsilon);
+
+    // largest difference between the two best extrapolations, in the first two rows of the table, over tolerance (1 + |y|)
+    double ErrorNorm() const;
+
+    double tolerance;
+    int max_columns;
+    double next_step;
+    int target_column;
+    long long steps_taken;
+    long long steps_rejected;
+    long long force_evaluations;
+
+    // the bodies at the start of the internal step, and a copy whose positions and velocities the substeps move
+    ParticleStore start;
+    ParticleStore work;
+    std::vector<double> start_ax, start_ay, start_az;
+
+    // extrapolation table of the positions and velocities of all bodies, laid out as [x|y|z|vx|vy|vz][body]; after
+    // the midpoint result with the substeps of column k is put into row k, rows k - 1 to 0 hold the extrapolations of
+    // increasing order, so row 0 is the best and row 1 the one before
+    std::vector<std::vector<double>> table;
+
+    // midpoint values two substeps back
+    std::vector<double> previous;
+};
+#endif
@@ -0,0 +1,55 @@
+#ifndef octree_h
+#define octree_h
+
+#include <vector>
+#include "particle_store.hpp"
+
+// octree over the bodies of a ParticleStore, shared by the tree force solvers
+// the cells only record which bodies they hold; the solvers keep their own per-cell data indexed like the nodes
+class Octree
+{
+    public:
+    struct Node
+    {
+        // children are stored contiguously from first_child and always come after their parent, a leaf has none
+        int first_child;
+        int num_children;
+
+        // bodies of the cell are GetOrder()[begin, end)
+        int begin;
+        int end;
+
+        // level of the cell, 0 for the root
+        int depth;
+    };
+
+    // cells with at most leaf_size bodies are not split any further
+    Octree(int leaf_size = 8);
+
+    // building the tree from scratch around the bounding cube of all bodies
+    void Build(const ParticleStore& particles);
+
+    int NumNodes() const;
+
+    int NumParticles() const;
+
+    bool IsLeaf(int node_index) const;
+
+    const std::vector<Node>& GetNodes() const;
+
+    // indices of the bodies sorted so that every cell holds a contiguous range
+    const std::vector<int>& GetOrder() const;
+
+    // deepest level of the tree, guards against bodies sitting on top of each other
+    static const int max_depth = 48;
+
+    private:
+    void BuildNode(const ParticleStore& particles, int node_index, const double centre[3], double half_width);
+
+    int leaf_size;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    std::vector<int> scratch;
+};
+#endif
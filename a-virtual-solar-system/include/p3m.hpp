@@ -0,0 +1,57 @@
+#ifndef p3m_h
+#define p3m_h
+
+#include <vector>
+#include "pm.hpp"
+
+// particle-particle particle-mesh solver: the softened pull between two bodies a distance r apart is split with a
+// Gaussian of width split radius r_s into a smooth long-range share S(r) = erf(r / 2r_s) - r / (r_s sqrt(pi)) exp(-r^2 / 4r_s^2),
+// carried by the mesh of PmSolver, and a short-range share 1 - S(r), summed directly over the pairs closer than
+// cutoff_radii * r_s with the pair formula of Particle::CalcAcceleration
+// the close pairs are found through a chaining mesh: the bodies are sorted into cells at least as wide as the cutoff,
+// and every body only visits the 27 cells around its own
+// close neighbours are resolved exactly, so the error is that of the mesh on the long-range share
+class P3mSolver : public PmSolver
+{
+    public:
+    // split radius of split_cells mesh cells; a wider split leaves less of the force to the mesh and more pairs to the
+    // direct sum
+    P3mSolver(int grid_size = 64, double split_cells = 1.25);
+
+    double GetSplitCells() const;
+
+    void SetSplitCells(double split_cells);
+
+    // split radius and cutoff of the last evaluation
+    double GetSplitRadius() const;
+    double GetCutoff() const;
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    // the short-range share at the cutoff is 4e-4 of the pull, and is left out
+    static constexpr double cutoff_radii = 6.0;
+
+    protected:
+    double MeshFraction(double r) const;
+
+    private:
+    // sorting the bodies into the cells of the chaining mesh
+    void BuildChainingMesh(const ParticleStore& particles);
+
+    void AddShortRange(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z) const;
+
+    double split_cells;
+    double split_radius;
+
+    // chaining mesh: bodies of cell c are sorted[cell_start[c]] to sorted[cell_start[c + 1] - 1]
+    double chain_origin[3];
+    double chain_cell_size[3];
+    int chain_cells[3];
+    std::vector<int> cell_start;
+    std::vector<int> sorted;
+    std::vector<int> body_cell;
+
+    // 1 - S(r) at evenly spaced values of (r / 2r_s)^2 from 0 to the cutoff
+    std::vector<double> short_range_table;
+};
+#endif
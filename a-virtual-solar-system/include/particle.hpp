@@ -1,10 +1,20 @@
 #ifndef particle_h
 #define particle_h
 
+#include <array>
 #include <string>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <Eigen/Core>
+#include <omp.h>
+#include "particle_store.hpp"
+#include "force_solver.hpp"
+#include "integrator.hpp"
+#include "execution_engine.hpp"
+#include "trajectory.hpp"
+#include "checkpoint.hpp"
+#include "telemetry.hpp"
 
 class Particle {
 
@@ -23,7 +33,7 @@ class Particle {
 
         void TotalCircularUpdate(double final_t, double dt);
 
-        Eigen::Vector3d CalcAcceleration(Particle particle_i, Particle particle_j, float epsilon);
+        Eigen::Vector3d CalcAcceleration(const Particle& particle_i, const Particle& particle_j, float epsilon);
 
         void SetPosition(Eigen::Vector3d pos);
         
@@ -35,13 +45,13 @@ class Particle {
 
         bool IsAccelerating();
 
-        Eigen::Vector3d CalculateTotalAcceleration(std::vector<Particle> particles, int target_index, float epsilon); 
+        Eigen::Vector3d CalculateTotalAcceleration(const std::vector<Particle>& particles, int target_index, float epsilon); 
         
-        double KineticEnergy();
+        double KineticEnergy() const;
 
-        double PotentialEnergy(std::vector<Particle> particles, int target_index);
+        double PotentialEnergy(const std::vector<Particle>& particles, int target_index) const;
 
-        double TotalEnergy(std::vector<Particle> particles, int target_index);
+        double TotalEnergy(const std::vector<Particle>& particles, int target_index) const;
 
     private:
         
@@ -66,16 +76,33 @@ class RandomInitialGenerator : public InitialConditionGenerator
 {   
     public:
 
+    // seeding the random engine from std::random_device
+    RandomInitialGenerator();
+
+    // seeding the random engine with a fixed seed, for reproducible systems
+    RandomInitialGenerator(unsigned int seed);
+
     std::vector<Particle> system_vector;
     
     std::vector<Particle> GenerateInitialConditions(int num_planets);
+
+    // state of the random engine as text, so that a checkpoint can regenerate the same system
+    std::string GetState() const;
+
+    void SetState(const std::string& state);
+
+    private:
+    std::mt19937 engine;
 };
 
+// Masses in order Sun, Mercury, Venus, Earth, Mars, Jupiter, Saturn, Uranus, Pluto
+// known at compile time, so that FixedSolarSystem can fold them into its force calculation
+constexpr std::array<double, 9> solar_system_masses = {1., 1./6023600, 1./408524, 1./332946.038, 1./3098710, 1./1047.55, 1./3499, 1./22962, 1./19352};
+
 class SolarSystemGenerator : public InitialConditionGenerator
 {   
     private:
-    // Masses in order Sun, Mercury, Venus, Earth, Mars, Jupiter, Saturn, Uranus, Pluto
-    const std::vector<double> mass_list = {1., 1./6023600, 1./408524, 1./332946.038, 1./3098710, 1./1047.55, 1./3499, 1./22962, 1./19352};
+    const std::vector<double> mass_list = std::vector<double>(solar_system_masses.begin(), solar_system_masses.end());
 
     // Distances from Sun
     const std::vector<double> distance_list = {0.0, 0.4, 0.7, 1, 1.5, 5.2, 9.5, 19.2, 30.1};
@@ -91,6 +118,22 @@ class SolarSystemGenerator : public InitialConditionGenerator
     std::vector<Particle> GenerateInitialConditions(int num_planets = 8);
 };
 
+// energy and momenta of all bodies of a SolarSystem at one time
+struct Diagnostics
+{
+    double kinetic_energy;
+
+    // softened with the epsilon of the force pass, the energy that the softened dynamics conserve
+    double potential_energy;
+
+    double total_energy;
+
+    Eigen::Vector3d momentum;
+
+    // about the origin
+    Eigen::Vector3d angular_momentum;
+};
+
 class SolarSystem
 {
     private:
@@ -103,13 +146,76 @@ class SolarSystem
         // Names of solar system bodies in order (only used in Solar System simulation, but not for a general solar system)
         const std::vector<std::string> bodies_list = {"Sun", "Mercury", "Venus", "Earth", "Mars", "Jupiter", "Saturn", "Uranus", "Pluto"};
     
-    public:
+        // structure-of-arrays storage of the bodies in the system
+        ParticleStore system;
+
+        // backend used to calculate the accelerations during the evolution
+        std::shared_ptr<ForceSolver> force_solver;
+
+        // scheme used to advance the bodies in time
+        std::shared_ptr<Integrator> integrator;
 
-        // Global vector to store particles
-        std::vector<Particle> system;
+        // whether the stored accelerations belong to the current positions
+        bool accelerations_current;
+
+        // see GetVersion
+        unsigned long long version;
+
+        // giving the system a new version after its bodies or their accelerations changed
+        void NewVersion();
+
+        // trajectory output of TimeEvolve and StepEvolve, a frame every trajectory_interval steps
+        std::shared_ptr<TrajectoryWriter> trajectory_writer;
+        int trajectory_interval;
+
+        // writing a frame if step is a multiple of the trajectory interval
+        void RecordFrame(long long step, double time);
+
+        // snapshots of TimeEvolve, one every checkpoint_interval steps
+        std::shared_ptr<CheckpointWriter> checkpoint_writer;
+        int checkpoint_interval;
+
+        // the time loop of TimeEvolve, starting after step steps at the value time of the loop variable
+        void EvolveFrom(long long step, double time, double final_time, double dt, float epsilon);
+
+        // diagnostics of TimeEvolve and StepEvolve, one every diagnostics_interval steps
+        int diagnostics_interval;
+        std::vector<Diagnostics> diagnostics_history;
+
+        // potential energy from the last force pass that accumulated it, valid while potential_current is set
+        double potential_energy;
+        float potential_epsilon;
+        bool potential_current;
+
+        // sampling the diagnostics if step is a multiple of the diagnostics interval
+        void RecordDiagnostics(long long step, float epsilon);
+
+        // telemetry of TimeEvolve and StepEvolve, a record every telemetry_interval steps
+        std::shared_ptr<TelemetryMonitor> telemetry_monitor;
+        int telemetry_interval;
+
+        // energy and momenta of the first record, which the drifts are measured from
+        Diagnostics telemetry_reference;
+        bool telemetry_reference_set;
+
+        // wall time of the steps and of the force passes since the last record
+        double telemetry_step_seconds;
+        double telemetry_force_seconds;
+
+        // one step, timed while telemetry is on
+        void TimedStep(double dt, float epsilon);
+
+        // pushing a record if step is a multiple of the telemetry interval
+        void RecordTelemetry(long long step, double time, double dt, float epsilon);
+
+        // OpenMP schedule of the direct summation loops in Step
+        omp_sched_t schedule_kind;
+        int schedule_chunk;
+
+    public:
 
         // constructor for SolarSystem
-        SolarSystem(std::vector<Particle> particles);
+        SolarSystem(const std::vector<Particle>& particles);
 
         //constructor for a general SolarSystem with random masses and positions 
         // SolarSystem(std::vector<std::unique_ptr> particles, int num_planets);
@@ -123,10 +229,132 @@ class SolarSystem
         // getting the names
         std::vector<std::string> GetNames();
 
+        // choosing the force calculation backend (the symmetric PairwiseSolver by default)
+        void SetForceSolver(std::shared_ptr<ForceSolver> solver);
+
+        // choosing the time integration scheme (the EulerIntegrator by default); the integrator starts afresh, without
+        // anything carried over from the bodies it stepped before, and the stored accelerations are recalculated
+        void SetIntegrator(std::shared_ptr<Integrator> new_integrator);
+
+        // a number that changes whenever the bodies or their accelerations change, and that no two systems share unless
+        // one is a copy of the other in the same state, so an integrator can tell whether what it carried over from its
+        // last step (e.g. the jerks) still belongs to the system it is asked to step
+        unsigned long long GetVersion() const;
+
+        // number of bodies in the system, including the central star
+        int NumParticles() const;
+
+        // getting a copy of the body at the given index
+        Particle GetParticle(int index) const;
+
+        // evaluating the accelerations of all bodies in one pass over the read-only positions and masses
+        // results are written by index into acc_x, acc_y and acc_z, which must each hold particles.Size() values
+        static void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+        // the same for the bodies [begin, end) only, still pulled by all bodies, on the calling thread alone;
+        // for callers that split the bodies between threads or processes themselves
+        static void ComputeAccelerations(const ParticleStore& particles, float epsilon, int begin, int end, double* acc_x, double* acc_y, double* acc_z);
+
+        // the acceleration of the single body index of a list of particles, read in place without building a store
+        static Eigen::Vector3d ComputeAcceleration(const std::vector<Particle>& particles, float epsilon, int index);
+
+        // evaluating the accelerations and their time derivatives (jerks) of the bodies listed in active, in one fused pass
+        // over the positions, velocities and masses of all bodies; results are written by index into the output arrays,
+        // which must each hold particles.Size() values
+        static void ComputeAccelerationsAndJerks(const ParticleStore& particles, const std::vector<int>& active, float epsilon,
+                                                 double* acc_x, double* acc_y, double* acc_z, double* jerk_x, double* jerk_y, double* jerk_z);
+
+        // the same for all bodies, in one pass that visits every pair once and adds equal and opposite contributions to both
+        // bodies through the buffers, as the PairwiseSolver does; the central star is taken as being at rest, as it is never moved
+        static void ComputeAccelerationsAndJerks(const ParticleStore& particles, float epsilon, PairBuffers& buffers,
+                                                 double* acc_x, double* acc_y, double* acc_z, double* jerk_x, double* jerk_y, double* jerk_z);
+
+        // the accelerations together with the potential -sum_j m_j / sqrt(r^2 + epsilon^2) of every body, in the same pass
+        static void ComputeAccelerationsAndPotentials(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z, double* potential);
+
+        // total kinetic energy of all bodies
+        static double KineticEnergy(const ParticleStore& particles);
+
+        // total gravitational potential energy, summed once over every pair of bodies, optionally softened
+        static double PotentialEnergy(const ParticleStore& particles, float epsilon = 0.0);
+
+        // the share of the bodies [begin, end) in it, half of every pair they are in, on the calling thread alone
+        static double PotentialEnergy(const ParticleStore& particles, int begin, int end, float epsilon = 0.0);
+
+        // the share of the single body index of a list of particles, read in place without building a store
+        static double PotentialEnergy(const std::vector<Particle>& particles, int index, float epsilon = 0.0);
+
+        // building blocks of the integrators, all of which leave the central star fixed at the origin
+
+        // calculating the accelerations of the bodies into the store; while diagnostics are on,
+        // the force solver accumulates the potential energy in the same pass
+        void UpdateAccelerations(float epsilon);
+
+        bool AccelerationsAreCurrent() const;
+
+        // for integrators that write the accelerations into the store themselves
+        void MarkAccelerationsCurrent();
+
+        // moving every body with its current velocity for a time dt
+        void Drift(double dt);
+
+        // changing the velocity of every body with its current acceleration for a time dt
+        void Kick(double dt);
+
+        // direct access to the bodies, used by the integrators; the stored accelerations are assumed stale afterwards
+        ParticleStore& GetParticleStore();
+
+        const ParticleStore& GetParticleStore() const;
+
+        // advancing the system by one timestep with the chosen integrator
+        void Step(double dt, float epsilon);
+
+        // recording the positions and velocities every interval steps of TimeEvolve and StepEvolve, including the initial ones;
+        // a null writer stops the recording
+        void SetTrajectoryWriter(std::shared_ptr<TrajectoryWriter> writer, int interval = 1);
+
+        // queuing a snapshot of the whole run every interval steps of TimeEvolve; a null writer stops the snapshots
+        void SetCheckpointWriter(std::shared_ptr<CheckpointWriter> writer, int interval);
+
+        // sampling the diagnostics every interval steps of TimeEvolve and StepEvolve, including the initial state,
+        // and clearing earlier samples; 0 turns them off. the potential energy is then accumulated inside the force passes,
+        // so sampling costs one multiply-add per pair and an O(N) sum over the bodies
+        void SetDiagnosticsInterval(int interval);
+
+        const std::vector<Diagnostics>& GetDiagnosticsHistory() const;
+
+        // energy and momenta of the current state, reusing the potential energy of the last force pass when it belongs to
+        // the current positions and epsilon, otherwise evaluating the accelerations and potential energy together
+        Diagnostics GetDiagnostics(float epsilon);
+
+        // pushing a TelemetryRecord of the energy and momentum drifts, the largest acceleration and the time spent in the force
+        // passes and the rest of the steps to the monitor every interval steps of TimeEvolve and StepEvolve, including the
+        // initial state; a null monitor stops the telemetry. the energy comes from the force passes as with SetDiagnosticsInterval,
+        // and only force passes made through UpdateAccelerations count as force time
+        void SetTelemetry(std::shared_ptr<TelemetryMonitor> monitor, int interval = 1);
+
+        // the state of the system after step steps of TimeEvolve(final_time, dt, epsilon), with time the value of its loop variable
+        Checkpoint GetCheckpoint(long long step, double time, double final_time, double dt, float epsilon) const;
+
+        // restoring the bodies and integrator state of a checkpoint and running the rest of its TimeEvolve,
+        // which continues bit for bit as if the run had never stopped; the integrator must be the same as in the checkpoint
+        // and the force solver should be
+        void ResumeTimeEvolve(const Checkpoint& checkpoint);
+
         void TimeEvolve(double final_time, double dt, float epsilon);
         
         void StepEvolve(int num_steps, double dt, float epsilon);
 
+        // choosing the OpenMP schedule (omp_sched_static, omp_sched_dynamic or omp_sched_guided) of the direct summation loops,
+        // which Step, TimeEvolve and StepEvolve run with the DirectSumSolver and the BulirschStoerIntegrator; a chunk size
+        // of 0 uses the OpenMP default for that schedule. the pair loops keep their fixed blocks, which make them reproducible
+        void SetSchedule(omp_sched_t kind, int chunk_size = 0);
+
+        // num_steps kick-drift-kick leapfrog steps with the direct summation on the thread team of the engine,
+        // which stays alive for the whole run; small systems fall back to serial execution without any thread overhead
+        // accelerations already in the store are reused for the first kick, as in the LeapfrogIntegrator
+        void EngineEvolve(const ExecutionEngine& engine, int num_steps, double dt, float epsilon);
+
         void PrintPositions();
 
         void PrintEarthDetails();
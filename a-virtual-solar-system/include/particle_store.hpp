@@ -0,0 +1,58 @@
+#ifndef particle_store_h
+#define particle_store_h
+
+#include <vector>
+#include <Eigen/Core>
+
+class Particle;
+
+// structure-of-arrays storage for the bodies of a SolarSystem
+// every component lives in its own contiguous array, so the O(N^2) force loop streams
+// through x, y, z and mass instead of striding over whole Particle objects
+class ParticleStore
+{
+    public:
+        ParticleStore() = default;
+
+        // building the store from a list of particles
+        ParticleStore(const std::vector<Particle>& particles);
+
+        int Size() const;
+
+        void Resize(int num_particles);
+
+        void PushBack(const Particle& particle);
+
+        // materialising a Particle from the arrays at the given index
+        Particle GetParticle(int index) const;
+
+        void SetParticle(int index, const Particle& particle);
+
+        std::vector<Particle> ToParticles() const;
+
+        double GetMass(int index) const;
+
+        Eigen::Vector3d GetPosition(int index) const;
+
+        Eigen::Vector3d GetVelocity(int index) const;
+
+        Eigen::Vector3d GetAcceleration(int index) const;
+
+        void SetPosition(int index, const Eigen::Vector3d& pos);
+
+        void SetVelocity(int index, const Eigen::Vector3d& vel);
+
+        void SetAcceleration(int index, const Eigen::Vector3d& acc);
+
+        // positions
+        std::vector<double> x, y, z;
+
+        // velocities
+        std::vector<double> vx, vy, vz;
+
+        // accelerations
+        std::vector<double> ax, ay, az;
+
+        std::vector<double> mass;
+};
+#endif
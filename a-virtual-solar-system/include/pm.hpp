@@ -0,0 +1,66 @@
+#ifndef pm_h
+#define pm_h
+
+#include <complex>
+#include <memory>
+#include <vector>
+#include "force_solver.hpp"
+#include "fft.hpp"
+
+// particle-mesh solver, O(N + M log M) per evaluation for a grid of M cells
+// the masses are spread over a grid of cubic cells with cloud-in-cell weights, the grid is convolved with the softened
+// pull -u / (|u|^2 + epsilon^2)^(3/2) between cell centres by FFTs, and the accelerations are interpolated back to the
+// bodies with the same cloud-in-cell weights, so the pair forces are equal and opposite and the momentum is conserved
+// the grid is padded to twice its size along every axis, so the convolution sees no periodic images of the bodies
+// forces are smoothed over about one cell: accurate for bodies many cells apart, poor for close neighbours
+class PmSolver : public ForceSolver
+{
+    public:
+    // grid_size cells along the longest side of the bodies (a power of 2, at least 4); the other sides get the fewest
+    // cells that cover the bodies, so a flat disk needs only 2 layers of cells
+    PmSolver(int grid_size = 64);
+
+    int GetGridSize() const;
+
+    // side of a cell in the last evaluation
+    double GetCellSize() const;
+
+    void ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z);
+
+    protected:
+    // share of the softened pull between two points a distance r apart that the mesh carries: all of it here
+    virtual double MeshFraction(double r) const;
+
+    // the transformed kernels are rebuilt at the next evaluation
+    void InvalidateKernels();
+
+    private:
+    // cell size, origin and number of cells covering the bodies
+    void SetUpGrid(const ParticleStore& particles);
+
+    void BuildKernels(float epsilon);
+
+    // flat index of a cell of the padded grid
+    std::size_t Cell(int i, int j, int k) const;
+
+    int grid_size;
+
+    // the cell size is rounded up to a power of 2^(1/16), so that it stays the same over many steps of a run and the
+    // kernels do not have to be transformed again
+    double cell_size;
+    double origin[3];
+    int cells[3];
+    int padded[3];
+    std::unique_ptr<Fft> ffts[3];
+
+    std::vector<std::complex<double>> density;
+    std::vector<std::complex<double>> field;
+
+    // transforms of the x, y and z components of the kernel, and what they were built for
+    std::vector<std::complex<double>> kernels[3];
+    bool kernels_valid;
+    double kernel_cell_size;
+    float kernel_epsilon;
+    int kernel_padded[3];
+};
+#endif
@@ -0,0 +1,47 @@
+#ifndef solar_system_batch_h
+#define solar_system_batch_h
+
+#include <vector>
+#include "particle.hpp"
+
+// many independent solar systems with the same number of bodies, evolved together with one system in every SIMD lane
+// a value of body i of system s is stored at [i * num_systems + s], so the same body of consecutive systems is contiguous
+// and the force loop over the pairs of bodies runs over 2, 4 or 8 systems at once in its innermost loop
+// this gives full vectors even for the 9 bodies of the solar system, where the loop over the other bodies of one system
+// is far too short; the systems are split into blocks of lanes that fit in the cache, and the blocks run in parallel
+// a step is the explicit Euler step of a SolarSystem with the DirectSumSolver, with the same operations in the same
+// order in every lane, so every system follows the same trajectory bit for bit as when it is run on its own
+class SolarSystemBatch
+{
+    public:
+    // every system should have the same number of bodies, with the central star first
+    SolarSystemBatch(const std::vector<std::vector<Particle>>& systems);
+
+    void Step(double dt, float epsilon);
+
+    // the same loop as SolarSystem::TimeEvolve, for all systems
+    void TimeEvolve(double final_time, double dt, float epsilon);
+
+    int NumSystems() const;
+
+    int NumBodies() const;
+
+    Particle GetParticle(int system, int index) const;
+
+    std::vector<Particle> GetSystem(int system) const;
+
+    // kinetic plus potential energy of every system, summed as in SolarSystem::TotalSystemEnergy
+    std::vector<double> TotalSystemEnergies(float epsilon = 0.0) const;
+
+    private:
+    void UpdateAccelerations(double eps_squared);
+
+    int num_systems;
+    int num_bodies;
+
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> ax, ay, az;
+    std::vector<double> mass;
+};
+#endif
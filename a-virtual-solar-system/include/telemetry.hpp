@@ -0,0 +1,179 @@
+#ifndef telemetry_h
+#define telemetry_h
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one sample of the conservation and timing telemetry of a SolarSystem run
+struct TelemetryRecord
+{
+    std::int64_t step;
+    double time;
+    double dt;
+
+    // kinetic plus softened potential energy, see Diagnostics
+    double total_energy;
+
+    // drifts since the first record of the run: (E - E_0) / |E_0|, |P - P_0| and |L - L_0|
+    double energy_drift;
+    double momentum_drift;
+    double angular_momentum_drift;
+
+    // largest acceleration of the bodies that move
+    double max_acceleration;
+
+    // wall time of the steps since the previous record, split into the force passes and everything else
+    double step_seconds;
+    double force_seconds;
+    double update_seconds;
+};
+
+// bounded queue between exactly one producer thread and one consumer thread, without locks
+// the producer only advances head and the consumer only advances tail, each publishing its slot with release/acquire
+// ordering; the capacity is rounded up to a power of two so that indices wrap with a mask
+template<typename T>
+class RingBuffer
+{
+    public:
+    RingBuffer(std::size_t capacity);
+
+    // false if the buffer is full
+    bool TryPush(const T& value);
+
+    // false if the buffer is empty
+    bool TryPop(T& value);
+
+    std::size_t Capacity() const;
+
+    private:
+    std::vector<T> slots;
+    std::size_t mask;
+
+    // on separate cache lines, so the two threads do not keep invalidating each other's counter
+    alignas(64) std::atomic<std::size_t> head;
+    alignas(64) std::atomic<std::size_t> tail;
+};
+
+template<typename T>
+RingBuffer<T>::RingBuffer(std::size_t capacity) : head(0), tail(0)
+{
+    std::size_t size = 1;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template<typename T>
+bool RingBuffer<T>::TryPush(const T& value)
+{
+    const std::size_t current_head = head.load(std::memory_order_relaxed);
+    if (current_head - tail.load(std::memory_order_acquire) == slots.size())
+    {
+        return false;
+    }
+    slots[current_head & mask] = value;
+    head.store(current_head + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool RingBuffer<T>::TryPop(T& value)
+{
+    const std::size_t current_tail = tail.load(std::memory_order_relaxed);
+    if (current_tail == head.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    value = slots[current_tail & mask];
+    tail.store(current_tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+std::size_t RingBuffer<T>::Capacity() const
+{
+    return slots.size();
+}
+
+// totals over every record a TelemetryMonitor has drained so far
+struct TelemetrySummary
+{
+    std::int64_t num_records;
+
+    // largest |energy drift| and the drift of the last record
+    double max_energy_drift;
+    double final_energy_drift;
+
+    double max_acceleration;
+
+    double step_seconds;
+    double force_seconds;
+    double update_seconds;
+};
+
+// receives telemetry records from the simulation thread and writes them out on a consumer thread
+// pushing never blocks or allocates: when the consumer falls behind and the ring buffer is full, the record is dropped
+// and counted, so a slow disk can not stall the run
+// CSV files start with a header line; binary files start with the magic "NBTELE01", followed by one record after the
+// other as the step (int64) and the ten values (float64) in the order of TelemetryRecord
+class TelemetryMonitor
+{
+    public:
+    enum class Format { Csv, Binary };
+
+    // an empty filename keeps only the summary
+    TelemetryMonitor(const std::string& filename = "", Format format = Format::Csv, std::size_t capacity = 4096);
+
+    // draining the remaining records and closing the file
+    ~TelemetryMonitor();
+
+    TelemetryMonitor(const TelemetryMonitor&) = delete;
+    TelemetryMonitor& operator=(const TelemetryMonitor&) = delete;
+
+    // queuing a record from the simulation thread; false if it had to be dropped
+    bool Push(const TelemetryRecord& record);
+
+    // writing every queued record and closing the file; throws if any write failed
+    void Close();
+
+    std::int64_t NumDropped() const;
+
+    // safe to call while the run is going
+    TelemetrySummary GetSummary() const;
+
+    // CSV for names ending in .csv, binary for everything else
+    static Format FormatFromFilename(const std::string& filename);
+
+    // all records of a binary telemetry file
+    static std::vector<TelemetryRecord> ReadBinary(const std::string& filename);
+
+    private:
+    // body of the consumer thread
+    void DrainLoop();
+
+    // writing one record and adding it to the summary
+    void Consume(const TelemetryRecord& record);
+
+    RingBuffer<TelemetryRecord> ring;
+    std::FILE* file;
+    Format format;
+
+    std::atomic<bool> closing;
+    std::atomic<std::int64_t> num_dropped;
+    bool closed;
+    bool write_failed;
+
+    mutable std::mutex summary_mutex;
+    TelemetrySummary summary;
+
+    std::thread consumer;
+};
+#endif
@@ -0,0 +1,118 @@
+#ifndef trajectory_h
+#define trajectory_h
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Core>
+#include "particle_store.hpp"
+
+// binary trajectory files
+// a file header (magic "NBTRAJ01", bytes per value, number of bodies, masses as float64) is followed by fixed-size frames:
+// the step and time of the frame, then the SoA arrays x, y, z, vx, vy, vz, each stored as float64 or downcast to float32
+// frame k starts at HeaderBytes(num_particles) + k * FrameBytes(num_particles, bytes_per_value), so any frame can be read directly
+// appends frames to a trajectory file without stalling the integrator
+// a frame is copied into the front buffer on the calling thread, while a background I/O thread writes the back buffer
+// to disk; the caller only waits when the previous frame is still being written when the next one is ready
+class TrajectoryWriter
+{
+    public:
+    enum class Precision { Double, Float };
+
+    TrajectoryWriter(const std::string& filename, const std::vector<double>& masses, Precision precision = Precision::Double);
+
+    // flushing the last frame and closing the file
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // queuing a frame of the positions and velocities in particles, which must have as many bodies as the file
+    void Write(const ParticleStore& particles, std::int64_t step, double time);
+
+    // waiting for all queued frames to reach the file and closing it; throws if any write failed
+    void Close();
+
+    std::int64_t NumFrames() const;
+
+    static int BytesPerValue(Precision precision);
+
+    // size of the file header
+    static std::size_t HeaderBytes(int num_particles);
+
+    // size of every frame
+    static std::size_t FrameBytes(int num_particles, Precision precision);
+
+    private:
+    // body of the background I/O thread
+    void WriteLoop();
+
+    std::FILE* file;
+    int num_particles;
+    Precision precision;
+    std::int64_t num_frames;
+
+    // frame being filled by the caller, and frame being written by the I/O thread
+    std::vector<char> front_buffer;
+    std::vector<char> back_buffer;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    // whether the back buffer holds a frame that has not been written yet
+    bool back_pending;
+    bool closing;
+    bool write_failed;
+
+    std::thread io_thread;
+};
+
+// random access to the frames of a trajectory file through a read-only memory mapping
+class TrajectoryReader
+{
+    public:
+    // mapping the file, throws if it is not a trajectory file
+    TrajectoryReader(const std::string& filename);
+
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    int NumParticles() const;
+
+    // number of complete frames in the file
+    std::int64_t NumFrames() const;
+
+    TrajectoryWriter::Precision GetPrecision() const;
+
+    std::vector<double> GetMasses() const;
+
+    std::int64_t GetStep(std::int64_t frame) const;
+
+    double GetTime(std::int64_t frame) const;
+
+    Eigen::Vector3d GetPosition(std::int64_t frame, int index) const;
+
+    Eigen::Vector3d GetVelocity(std::int64_t frame, int index) const;
+
+    // the whole frame with the masses of the header and zero accelerations
+    ParticleStore GetFrame(std::int64_t frame) const;
+
+    private:
+    // value of component c (x, y, z, vx, vy, vz) of body index in frame
+    double Value(std::int64_t frame, int component, int index) const;
+
+    const char* FrameData(std::int64_t frame) const;
+
+    const char* data;
+    std::size_t size;
+    int num_particles;
+    TrajectoryWriter::Precision precision;
+    std::int64_t num_frames;
+};
+#endif
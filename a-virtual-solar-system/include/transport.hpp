@@ -0,0 +1,88 @@
+#ifndef transport_h
+#define transport_h
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+
+// abstract point-to-point message passing between the ranks 0 .. Size() - 1 of a distributed run, in the style of MPI
+class Transport
+{
+    public:
+    virtual ~Transport() = default;
+
+    virtual int Rank() const = 0;
+
+    virtual int Size() const = 0;
+
+    // blocking send of bytes to rank dest, which must post a matching Receive
+    virtual void Send(int dest, const void* data, std::size_t bytes) = 0;
+
+    // blocking receive of exactly bytes from rank source
+    virtual void Receive(int source, void* data, std::size_t bytes) = 0;
+
+    // sending to dest and receiving from source at the same time; even ranks send first and odd ranks receive first,
+    // so a ring of blocking transfers cannot deadlock
+    void SendReceive(int dest, const void* send_data, std::size_t send_bytes, int source, void* receive_data, std::size_t receive_bytes);
+
+    // ring all-gather: rank r owns the entries [offsets[r], offsets[r + 1]) of every full-length array in components,
+    // and after Size() - 1 systolic shifts around the ring every rank holds all entries
+    void AllGather(const std::vector<int>& offsets, const std::vector<double*>& components);
+
+    // the contiguous block [offsets[r], offsets[r + 1]) of num_items items owned by every rank r;
+    // depends only on num_items and num_ranks, so every rank computes the same partition
+    static std::vector<int> Partition(int num_items, int num_ranks);
+};
+
+// a run on a single process, for which all collectives are no-ops
+class SerialTransport : public Transport
+{
+    public:
+    int Rank() const;
+
+    int Size() const;
+
+    void Send(int dest, const void* data, std::size_t bytes);
+
+    void Receive(int source, void* data, std::size_t bytes);
+};
+
+// ranks running as separate local processes connected by Unix socket pairs, one for every pair of ranks
+class SocketTransport : public Transport
+{
+    public:
+    // forking num_ranks - 1 child processes; the calling process becomes rank 0 and every child returns from Fork with its own rank
+    // everything before the call is shared by all ranks, so initial conditions generated beforehand are identical everywhere
+    static std::shared_ptr<SocketTransport> Fork(int num_ranks);
+
+    // calls Finish if it has not been called, so a child process never returns into the code of rank 0
+    ~SocketTransport();
+
+    int Rank() const;
+
+    int Size() const;
+
+    void Send(int dest, const void* data, std::size_t bytes);
+
+    void Receive(int source, void* data, std::size_t bytes);
+
+    // ends the run on this rank: child processes exit here, rank 0 waits for them and returns,
+    // throwing if any of them failed
+    void Finish();
+
+    private:
+    SocketTransport(int rank, int num_ranks, const std::vector<int>& sockets, const std::vector<pid_t>& children);
+
+    int rank;
+    int num_ranks;
+
+    // socket connected to every other rank, -1 for this rank
+    std::vector<int> sockets;
+
+    // process ids of the ranks 1 .. num_ranks - 1, only known to rank 0
+    std::vector<pid_t> children;
+
+    bool finished;
+};
+#endif
@@ -0,0 +1,185 @@
+#include "barnes_hut.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+BarnesHutSolver::BarnesHutSolver(double theta, int rebuild_interval, int leaf_size)
+    : theta(theta), rebuild_interval(rebuild_interval), evaluations_since_build(0), tree(leaf_size)
+{
+    // a body lies within sqrt(3) / 2 size of the centre of its own cell, so up to theta = 1 no cell is ever accepted
+    // for a body inside it, which would then pull on itself through the mass of the cell
+    if (!(theta >= 0 && theta <= 1))
+    {
+        throw std::logic_error("Opening angle theta of the Barnes-Hut solver should be between 0 and 1.");
+    }
+    if (rebuild_interval < 1)
+    {
+        throw std::logic_error("Rebuild interval of the Barnes-Hut solver should be at least 1.");
+    }
+}
+
+double BarnesHutSolver::GetTheta() const
+{
+    return theta;
+}
+
+int BarnesHutSolver::NumNodes() const
+{
+    return tree.NumNodes();
+}
+
+// recomputing the monopoles and bounding boxes of the existing cells from the current positions
+void BarnesHutSolver::Refit(const ParticleStore& particles)
+{
+    const auto& nodes = tree.GetNodes();
+    const auto& order = tree.GetOrder();
+    cells.resize(nodes.size());
+
+    // children come after their parents, so a reverse sweep visits every cell after its children
+    for(int node_index = nodes.size() - 1; node_index >= 0; node_index--)
+    {
+        const Octree::Node& node = nodes[node_index];
+        Cell& cell = cells[node_index];
+        cell.mass = 0.0;
+        double weighted[3] = {0.0, 0.0, 0.0};
+        for(int k = 0; k < 3; k++)
+        {
+            cell.min[k] = INFINITY;
+            cell.max[k] = -INFINITY;
+        }
+
+        if (node.num_children == 0)
+        {
+            for(int n = node.begin; n < node.end; n++)
+            {
+                int i = order[n];
+                double pos[3] = {particles.x[i], particles.y[i], particles.z[i]};
+                cell.mass += particles.mass[i];
+                for(int k = 0; k < 3; k++)
+                {
+                    weighted[k] += particles.mass[i] * pos[k];
+                    cell.min[k] = std::min(cell.min[k], pos[k]);
+                    cell.max[k] = std::max(cell.max[k], pos[k]);
+                }
+            }
+        }
+        else
+        {
+            for(int c = node.first_child; c < node.first_child + node.num_children; c++)
+            {
+                const Cell& child = cells[c];
+                cell.mass += child.mass;
+                for(int k = 0; k < 3; k++)
+                {
+                    weighted[k] += child.mass * child.com[k];
+                    cell.min[k] = std::min(cell.min[k], child.min[k]);
+                    cell.max[k] = std::max(cell.max[k], child.max[k]);
+                }
+            }
+        }
+
+        double size = 0.0;
+        double offset_squared = 0.0;
+        for(int k = 0; k < 3; k++)
+        {
+            double box_centre = 0.5 * (cell.min[k] + cell.max[k]);
+            cell.com[k] = cell.mass > 0 ? weighted[k] / cell.mass : box_centre;
+            size = std::max(size, cell.max[k] - cell.min[k]);
+            offset_squared += (cell.com[k] - box_centre) * (cell.com[k] - box_centre);
+        }
+
+        // with theta = 0 no cell is ever accepted and the traversal reaches every body
+        cell.open_distance = theta > 0 ? size / theta + std::sqrt(offset_squared) : INFINITY;
+    }
+}
+
+void BarnesHutSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    if (num_particles == 0)
+    {
+        return;
+    }
+
+    // rebuilding when due, or when bodies have been added or removed since the last build
+    if (tree.NumNodes() == 0 || evaluations_since_build >= rebuild_interval || tree.NumParticles() != num_particles)
+    {
+        tree.Build(particles);
+        evaluations_since_build = 0;
+    }
+    Refit(particles);
+    evaluations_since_build++;
+
+    const double eps_squared = double(epsilon) * double(epsilon);
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+    const auto& nodes = tree.GetNodes();
+    const auto& order = tree.GetOrder();
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int i = 0; i < num_particles; i++)
+    {
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        double sum_z = 0.0;
+
+        // at most seven siblings are left waiting on each level of the walk
+        int stack[8 * Octree::max_depth + 8];
+        int stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0)
+        {
+            const int node_index = stack[--stack_size];
+            const Octree::Node& node = nodes[node_index];
+            const Cell& cell = cells[node_index];
+
+            double dx = cell.com[0] - x[i];
+            double dy = cell.com[1] - y[i];
+            double dz = cell.com[2] - z[i];
+            double dist_squared = dx*dx + dy*dy + dz*dz;
+
+            if (dist_squared > cell.open_distance * cell.open_distance)
+            {
+                // far enough away: the whole cell acts as a point mass at its centre of mass
+                dist_squared += eps_squared;
+                double factor = cell.mass / (dist_squared * std::sqrt(dist_squared));
+                sum_x += factor * dx;
+                sum_y += factor * dy;
+                sum_z += factor * dz;
+            }
+            else if (node.num_children == 0)
+            {
+                for(int n = node.begin; n < node.end; n++)
+                {
+                    int j = order[n];
+                    if (j != i)
+                    {
+                        double dx_j = x[j] - x[i];
+                        double dy_j = y[j] - y[i];
+                        double dz_j = z[j] - z[i];
+                        double dist_squared_j = dx_j*dx_j + dy_j*dy_j + dz_j*dz_j + eps_squared;
+                        double factor = mass[j] / (dist_squared_j * std::sqrt(dist_squared_j));
+                        sum_x += factor * dx_j;
+                        sum_y += factor * dy_j;
+                        sum_z += factor * dz_j;
+                    }
+                }
+            }
+            else
+            {
+                for(int c = node.first_child; c < node.first_child + node.num_children; c++)
+                {
+                    stack[stack_size++] = c;
+                }
+            }
+        }
+
+        acc_x[i] = sum_x;
+        acc_y[i] = sum_y;
+        acc_z[i] = sum_z;
+    }
+}
@@ -0,0 +1,257 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+static const char checkpoint_magic[8] = {'N', 'B', 'C', 'K', 'P', 'T', '0', '2'};
+
+// little helpers for the fields of the snapshot file
+template <typename T>
+static void WriteValue(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// throws on a short read, before the value could be used
+template <typename T>
+static T ReadValue(std::ifstream& file)
+{
+    T value;
+    if (!file.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    {
+        throw std::runtime_error("incomplete");
+    }
+    return value;
+}
+
+// the length of a string or array, checked against the bytes left in the file before anything is allocated for it
+static std::uint64_t ReadLength(std::ifstream& file, std::size_t element_size)
+{
+    std::uint64_t length = ReadValue<std::uint64_t>(file);
+    const std::streampos position = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streampos end = file.tellg();
+    file.seekg(position);
+    if (length > std::uint64_t(end - position) / element_size)
+    {
+        throw std::runtime_error("incomplete");
+    }
+    return length;
+}
+
+static void WriteString(std::ofstream& file, const std::string& text)
+{
+    WriteValue<std::uint64_t>(file, text.size());
+    file.write(text.data(), text.size());
+}
+
+static std::string ReadString(std::ifstream& file)
+{
+    std::string text(ReadLength(file, 1), '\0');
+    file.read(&text[0], text.size());
+    return text;
+}
+
+static void WriteArray(std::ofstream& file, const std::vector<double>& values)
+{
+    WriteValue<std::uint64_t>(file, values.size());
+    file.write(reinterpret_cast<const char*>(values.data()), sizeof(double) * values.size());
+}
+
+static std::vector<double> ReadArray(std::ifstream& file)
+{
+    std::vector<double> values(ReadLength(file, sizeof(double)));
+    file.read(reinterpret_cast<char*>(values.data()), sizeof(double) * values.size());
+    return values;
+}
+
+void CheckpointWriter::WriteFile(const std::string& filename, const Checkpoint& checkpoint)
+{
+    const std::string temporary = filename + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(checkpoint_magic, 8);
+        WriteValue(file, checkpoint.step);
+        WriteValue(file, checkpoint.time);
+        WriteValue(file, checkpoint.final_time);
+        WriteValue(file, checkpoint.dt);
+        WriteValue(file, checkpoint.epsilon);
+        WriteValue(file, checkpoint.num_threads);
+        WriteValue<std::uint8_t>(file, checkpoint.accelerations_current);
+        WriteString(file, checkpoint.integrator);
+        WriteArray(file, checkpoint.integrator_state);
+        WriteString(file, checkpoint.run_info);
+        WriteString(file, checkpoint.generator_state);
+
+        const ParticleStore& particles = checkpoint.particles;
+        for(auto component : {&particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz,
+                              &particles.ax, &particles.ay, &particles.az, &particles.mass})
+        {
+            WriteArray(file, *component);
+        }
+
+        file.flush();
+        if (!file)
+        {
+            throw std::runtime_error("Could not write the checkpoint file " + temporary);
+        }
+    }
+
+    // replacing the previous snapshot only once the new one is complete
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        throw std::runtime_error("Could not replace the checkpoint file " + filename);
+    }
+}
+
+Checkpoint CheckpointWriter::ReadFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8];
+    if (!file.read(magic, 8) || std::string(magic, 8) != std::string(checkpoint_magic, 8))
+    {
+        throw std::runtime_error(filename + " is not a checkpoint file");
+    }
+
+    Checkpoint checkpoint;
+    ParticleStore& particles = checkpoint.particles;
+    try
+    {
+        checkpoint.step = ReadValue<std::int64_t>(file);
+        checkpoint.time = ReadValue<double>(file);
+        checkpoint.final_time = ReadValue<double>(file);
+        checkpoint.dt = ReadValue<double>(file);
+        checkpoint.epsilon = ReadValue<float>(file);
+        checkpoint.num_threads = ReadValue<std::int32_t>(file);
+        checkpoint.accelerations_current = ReadValue<std::uint8_t>(file);
+        checkpoint.integrator = ReadString(file);
+        checkpoint.integrator_state = ReadArray(file);
+        checkpoint.run_info = ReadString(file);
+        checkpoint.generator_state = ReadString(file);
+
+        for(auto component : {&particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz,
+                              &particles.ax, &particles.ay, &particles.az, &particles.mass})
+        {
+            *component = ReadArray(file);
+        }
+    }
+    catch(const std::runtime_error&)
+    {
+        throw std::runtime_error("The checkpoint file " + filename + " is incomplete");
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("The checkpoint file " + filename + " is incomplete");
+    }
+    if (checkpoint.num_threads < 1)
+    {
+        throw std::runtime_error("The checkpoint file " + filename + " is inconsistent");
+    }
+    for(auto component : {&particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz, &particles.ax, &particles.ay, &particles.az})
+    {
+        if (component->size() != particles.mass.size())
+        {
+            throw std::runtime_error("The checkpoint file " + filename + " is inconsistent");
+        }
+    }
+    return checkpoint;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename, const std::string& run_info, const std::string& generator_state)
+    : filename(filename), run_info(run_info), generator_state(generator_state), num_written(0), has_pending(false), closing(false), write_failed(false)
+{
+    io_thread = std::thread(&CheckpointWriter::WriteLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    try
+    {
+        Close();
+    }
+    catch(const std::exception&)
+    {
+    }
+}
+
+void CheckpointWriter::Write(const Checkpoint& checkpoint)
+{
+    // copying before taking the lock, so the I/O thread keeps writing in the meantime
+    Checkpoint snapshot = checkpoint;
+    snapshot.run_info = run_info;
+    snapshot.generator_state = generator_state;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closing)
+    {
+        throw std::logic_error("The checkpoint writer has already been closed.");
+    }
+    condition.wait(lock, [this]{ return !has_pending; });
+    if (write_failed)
+    {
+        throw std::runtime_error("Writing the checkpoint file " + filename + " failed.");
+    }
+    std::swap(pending, snapshot);
+    has_pending = true;
+    condition.notify_all();
+}
+
+void CheckpointWriter::WriteLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        condition.wait(lock, [this]{ return has_pending || closing; });
+        if (!has_pending)
+        {
+            return;
+        }
+
+        // taking the snapshot out of the queue, so the next one can be queued while this one is written
+        Checkpoint snapshot;
+        std::swap(snapshot, pending);
+        has_pending = false;
+        condition.notify_all();
+        lock.unlock();
+
+        bool written = true;
+        try
+        {
+            WriteFile(filename, snapshot);
+        }
+        catch(const std::exception&)
+        {
+            written = false;
+        }
+
+        lock.lock();
+        write_failed = write_failed || !written;
+        num_written += written;
+    }
+}
+
+void CheckpointWriter::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing)
+        {
+            return;
+        }
+        closing = true;
+    }
+    condition.notify_all();
+    io_thread.join();
+
+    if (write_failed)
+    {
+        throw std::runtime_error("Writing the checkpoint file " + filename + " failed.");
+    }
+}
+
+std::int64_t CheckpointWriter::NumWritten() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_written;
+}
@@ -0,0 +1,72 @@
+#include "distributed.hpp"
+#include "particle.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+DistributedSolarSystem::DistributedSolarSystem(const std::vector<Particle>& particles, std::shared_ptr<Transport> transport)
+    : system(particles), transport(transport)
+{
+    if (!transport)
+    {
+        throw std::logic_error("A DistributedSolarSystem needs a transport.");
+    }
+    offsets = Transport::Partition(system.Size(), transport->Size());
+}
+
+int DistributedSolarSystem::OwnedBegin() const
+{
+    return offsets[transport->Rank()];
+}
+
+int DistributedSolarSystem::OwnedEnd() const
+{
+    return offsets[transport->Rank() + 1];
+}
+
+// Euler step on the own block, then the exchange of the positions
+void DistributedSolarSystem::Step(double dt, float epsilon)
+{
+    const int begin = OwnedBegin();
+    const int end = OwnedEnd();
+
+    SolarSystem::ComputeAccelerations(system, epsilon, begin, end, system.ax.data(), system.ay.data(), system.az.data());
+
+    // the central star stays fixed
+    for(int i = std::max(begin, 1); i < end; i++)
+    {
+        system.x[i] += dt * system.vx[i];
+        system.y[i] += dt * system.vy[i];
+        system.z[i] += dt * system.vz[i];
+        system.vx[i] += dt * system.ax[i];
+        system.vy[i] += dt * system.ay[i];
+        system.vz[i] += dt * system.az[i];
+    }
+
+    if (transport->Size() > 1)
+    {
+        transport->AllGather(offsets, {system.x.data(), system.y.data(), system.z.data()});
+    }
+}
+
+void DistributedSolarSystem::Evolve(int num_steps, double dt, float epsilon)
+{
+    for(int step = 0; step < num_steps; step++)
+    {
+        Step(dt, epsilon);
+    }
+}
+
+const ParticleStore& DistributedSolarSystem::Gather()
+{
+    if (transport->Size() > 1)
+    {
+        transport->AllGather(offsets, {system.vx.data(), system.vy.data(), system.vz.data(), system.ax.data(), system.ay.data(), system.az.data()});
+    }
+    return system;
+}
+
+double DistributedSolarSystem::TotalSystemEnergy()
+{
+    Gather();
+    return SolarSystem::KineticEnergy(system) + SolarSystem::PotentialEnergy(system);
+}
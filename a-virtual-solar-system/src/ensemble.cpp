@@ -0,0 +1,216 @@
+#include "ensemble.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <omp.h>
+#include <stdexcept>
+#include <thread>
+
+// indices of the systems still waiting for one thread
+// the queues hold a handful of items each and are only touched once per system, so a plain lock is enough
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<int> items;
+};
+
+// the owner takes the largest system left at the front
+static bool PopFront(WorkQueue& queue, int& index)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty())
+    {
+        return false;
+    }
+    index = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+// a thief takes the smallest system left at the back
+static bool PopBack(WorkQueue& queue, int& index)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty())
+    {
+        return false;
+    }
+    index = queue.items.back();
+    queue.items.pop_back();
+    return true;
+}
+
+EnsembleRunner::EnsembleRunner(int num_threads) : num_threads(num_threads)
+{
+    if (num_threads < 0)
+    {
+        throw std::logic_error("Number of threads of an EnsembleRunner should be equal or greater than 0.");
+    }
+}
+
+void EnsembleRunner::SetSetup(Setup new_setup)
+{
+    setup = new_setup;
+}
+
+int EnsembleRunner::NumThreads(int num_systems) const
+{
+    int team_size = num_threads > 0 ? num_threads : omp_get_max_threads();
+
+    // every thread starts with at least one system
+    return std::max(1, std::min(team_size, num_systems));
+}
+
+EnsembleReport EnsembleRunner::Run(const std::vector<std::vector<Particle>>& initial_conditions, double final_time, double dt, float epsilon) const
+{
+    const int num_systems = initial_conditions.size();
+    const int team_size = NumThreads(num_systems);
+
+    // largest systems first, by their number of pairs
+    std::vector<int> order(num_systems);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return initial_conditions[a].size() > initial_conditions[b].size();
+    });
+
+    std::vector<WorkQueue> queues(team_size);
+    for(int k = 0; k < num_systems; k++)
+    {
+        queues[k % team_size].items.push_back(order[k]);
+    }
+
+    EnsembleReport report;
+    report.results.resize(num_systems);
+    report.num_threads = team_size;
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // plain threads rather than an OpenMP team: the force loops of the systems would be nested parallel regions in a team,
+    // and a nested region sets up a new team of its own every time, which costs more than a whole step of a few bodies
+    auto worker = [&](int thread)
+    {
+        // the force loops of each system stay on this thread
+        omp_set_num_threads(1);
+
+        while (true)
+        {
+            int index;
+            bool stolen = false;
+            if (!PopFront(queues[thread], index))
+            {
+                // no system is ever added during a run, so once every queue is empty the thread is done
+                for(int k = 1; k < team_size && !stolen; k++)
+                {
+                    stolen = PopBack(queues[(thread + k) % team_size], index);
+                }
+                if (!stolen)
+                {
+                    break;
+                }
+            }
+
+            try
+            {
+                auto system_start = std::chrono::steady_clock::now();
+
+                SolarSystem system(initial_conditions[index]);
+                if (setup)
+                {
+                    setup(system, index);
+                }
+
+                EnsembleResult& result = report.results[index];
+                result.num_bodies = initial_conditions[index].size();
+                result.initial_energy = system.GetDiagnostics(epsilon).total_energy;
+                system.TimeEvolve(final_time, dt, epsilon);
+                result.final_energy = system.GetDiagnostics(epsilon).total_energy;
+                result.relative_energy_loss = (result.final_energy - result.initial_energy) / std::abs(result.initial_energy);
+
+                result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - system_start).count();
+                result.thread = thread;
+                result.stolen = stolen;
+            }
+
+            // the first exception is kept and thrown again once every thread has finished
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int thread = 0; thread < team_size; thread++)
+    {
+        threads.emplace_back(worker, thread);
+    }
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    report.num_stolen = 0;
+    report.system_seconds = 0.0;
+    for(const EnsembleResult& result : report.results)
+    {
+        report.num_stolen += result.stolen;
+        report.system_seconds += result.seconds;
+    }
+    report.statistics = Statistics(report.results);
+    return report;
+}
+
+EnsembleStatistics EnsembleRunner::Statistics(const std::vector<EnsembleResult>& results)
+{
+    EnsembleStatistics statistics{int(results.size()), 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (results.empty())
+    {
+        return statistics;
+    }
+
+    std::vector<double> losses;
+    for(const EnsembleResult& result : results)
+    {
+        losses.push_back(result.relative_energy_loss);
+    }
+    std::sort(losses.begin(), losses.end());
+
+    const int num_systems = losses.size();
+    double sum = std::accumulate(losses.begin(), losses.end(), 0.0);
+    statistics.mean_energy_loss = sum / num_systems;
+
+    // sample standard deviation
+    if (num_systems > 1)
+    {
+        double sum_squares = 0.0;
+        for(double loss : losses)
+        {
+            sum_squares += (loss - statistics.mean_energy_loss) * (loss - statistics.mean_energy_loss);
+        }
+        statistics.std_energy_loss = std::sqrt(sum_squares / (num_systems - 1));
+    }
+
+    statistics.min_energy_loss = losses.front();
+    statistics.max_energy_loss = losses.back();
+    statistics.median_energy_loss = num_systems % 2 == 1 ? losses[num_systems / 2] : 0.5 * (losses[num_systems / 2 - 1] + losses[num_systems / 2]);
+    return statistics;
+}
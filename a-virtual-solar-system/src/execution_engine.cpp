@@ -0,0 +1,70 @@
+#include "execution_engine.hpp"
+#include <algorithm>
+#include <omp.h>
+#include <stdexcept>
+
+ExecutionEngine::ExecutionEngine(int num_threads, int serial_threshold) : num_threads(num_threads), serial_threshold(serial_threshold)
+{
+    if (num_threads < 0)
+    {
+        throw std::logic_error("Number of threads of an ExecutionEngine should be equal or greater than 0.");
+    }
+    if (serial_threshold < 0)
+    {
+        throw std::logic_error("Serial threshold of an ExecutionEngine should be equal or greater than 0.");
+    }
+}
+
+int ExecutionEngine::NumThreads(int num_items) const
+{
+    if (num_items < serial_threshold)
+    {
+        return 1;
+    }
+    int team_size = num_threads > 0 ? num_threads : omp_get_max_threads();
+
+    // every thread gets at least one item
+    return std::max(1, std::min(team_size, num_items));
+}
+
+int ExecutionEngine::GetSerialThreshold() const
+{
+    return serial_threshold;
+}
+
+void ExecutionEngine::Run(int num_steps, int num_items, const std::vector<Phase>& phases) const
+{
+    const int team_size = NumThreads(num_items);
+
+    // small systems: no fork, join or barriers at all
+    if (team_size == 1)
+    {
+        for(int step = 0; step < num_steps; step++)
+        {
+            for(const Phase& phase : phases)
+            {
+                phase(0, num_items);
+            }
+        }
+        return;
+    }
+
+    #pragma omp parallel num_threads(team_size)
+    {
+        // fixed contiguous block of items for this thread, the same in every phase and step
+        const int thread = omp_get_thread_num();
+        const int threads = omp_get_num_threads();
+        const int begin = (long long)num_items * thread / threads;
+        const int end = (long long)num_items * (thread + 1) / threads;
+
+        for(int step = 0; step < num_steps; step++)
+        {
+            for(const Phase& phase : phases)
+            {
+                phase(begin, end);
+
+                #pragma omp barrier
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include "fft.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+Fft::Fft(int n) : n(n)
+{
+    if (n < 1 || (n & (n - 1)) != 0)
+    {
+        throw std::logic_error("The length of an FFT should be a power of 2.");
+    }
+
+    // exp(-2 pi i k / n) for the first half of the circle, every stage uses a stride through this table
+    twiddles.resize(n / 2);
+    for(int k = 0; k < n / 2; k++)
+    {
+        twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / n);
+    }
+
+    bit_reverse.resize(n);
+    int bits = 0;
+    while ((1 << bits) < n)
+    {
+        bits++;
+    }
+    for(int k = 0; k < n; k++)
+    {
+        int reversed = 0;
+        for(int bit = 0; bit < bits; bit++)
+        {
+            reversed |= ((k >> bit) & 1) << (bits - 1 - bit);
+        }
+        bit_reverse[k] = reversed;
+    }
+}
+
+int Fft::Size() const
+{
+    return n;
+}
+
+void Fft::Transform(std::complex<double>* data, bool inverse, int stride) const
+{
+    for(int k = 0; k < n; k++)
+    {
+        if (k < bit_reverse[k])
+        {
+            std::swap(data[k * stride], data[bit_reverse[k] * stride]);
+        }
+    }
+
+    // butterflies of length 2, 4, ..., n
+    for(int length = 2; length <= n; length *= 2)
+    {
+        const int half = length / 2;
+        const int step = n / length;
+        for(int start = 0; start < n; start += length)
+        {
+            for(int k = 0; k < half; k++)
+            {
+                std::complex<double> twiddle = inverse ? std::conj(twiddles[k * step]) : twiddles[k * step];
+                std::complex<double>& even = data[(start + k) * stride];
+                std::complex<double>& odd = data[(start + k + half) * stride];
+                std::complex<double> product = twiddle * odd;
+                odd = even - product;
+                even += product;
+            }
+        }
+    }
+}
+
+// the lines along x and y are strided, so they are copied into a contiguous buffer of the thread first
+void Fft3d(std::vector<std::complex<double>>& grid, const Fft& fft_x, const Fft& fft_y, const Fft& fft_z, bool inverse)
+{
+    const int size_x = fft_x.Size();
+    const int size_y = fft_y.Size();
+    const int size_z = fft_z.Size();
+    if (grid.size() != std::size_t(size_x) * size_y * size_z)
+    {
+        throw std::logic_error("The grid does not match the lengths of the FFTs.");
+    }
+    std::complex<double>* values = grid.data();
+
+    #pragma omp parallel
+    {
+        std::vector<std::complex<double>> line(std::max(size_x, size_y));
+
+        #pragma omp for schedule(static)
+        for(int row = 0; row < size_x * size_y; row++)
+        {
+            fft_z.Transform(values + std::size_t(row) * size_z, inverse);
+        }
+
+        #pragma omp for schedule(static)
+        for(int column = 0; column < size_x * size_z; column++)
+        {
+            const int i = column / size_z;
+            const int k = column % size_z;
+            std::complex<double>* start = values + std::size_t(i) * size_y * size_z + k;
+            for(int j = 0; j < size_y; j++)
+            {
+                line[j] = start[std::size_t(j) * size_z];
+            }
+            fft_y.Transform(line.data(), inverse);
+            for(int j = 0; j < size_y; j++)
+            {
+                start[std::size_t(j) * size_z] = line[j];
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for(int column = 0; column < size_y * size_z; column++)
+        {
+            std::complex<double>* start = values + column;
+            const std::size_t stride = std::size_t(size_y) * size_z;
+            for(int i = 0; i < size_x; i++)
+            {
+                line[i] = start[i * stride];
+            }
+            fft_x.Transform(line.data(), inverse);
+            for(int i = 0; i < size_x; i++)
+            {
+                start[i * stride] = line[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,501 @@
+#include "fmm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+FmmSolver::FmmSolver(int order, double theta, int leaf_size) : theta(theta), tree(leaf_size), eps_squared(0.0)
+{
+    if (theta < 0 || theta >= 1)
+    {
+        throw std::logic_error("Opening angle theta of the FMM solver should be in [0, 1).");
+    }
+    SetOrder(order);
+}
+
+int FmmSolver::GetOrder() const
+{
+    return order;
+}
+
+void FmmSolver::SetOrder(int new_order)
+{
+    if (new_order < 1 || new_order > max_order)
+    {
+        throw std::logic_error("Expansion order of the FMM solver should be between 1 and FmmSolver::max_order.");
+    }
+    order = new_order;
+    SetUpMultiIndices();
+}
+
+double FmmSolver::GetTheta() const
+{
+    return theta;
+}
+
+// raising the expansion order until the measured RMS relative error of the accelerations is below tolerance
+double FmmSolver::TuneOrder(const ParticleStore& particles, float epsilon, double tolerance, int sample_size)
+{
+    while (true)
+    {
+        double error = CompareWithDirectSum(*this, particles, epsilon, sample_size).rms_relative_error;
+        if (error < tolerance || order == max_order)
+        {
+            return error;
+        }
+        SetOrder(order + 1);
+    }
+}
+
+int FmmSolver::Index(int a, int b, int c) const
+{
+    return index_table[(a * (order + 1) + b) * (order + 1) + c];
+}
+
+// enumerating the multi-indices and precomputing the terms of the expansion translations
+void FmmSolver::SetUpMultiIndices()
+{
+    multi_a.clear();
+    multi_b.clear();
+    multi_c.clear();
+    index_table.assign((order + 1) * (order + 1) * (order + 1), -1);
+
+    for(int degree = 0; degree <= order; degree++)
+    {
+        for(int a = degree; a >= 0; a--)
+        {
+            for(int b = degree - a; b >= 0; b--)
+            {
+                int c = degree - a - b;
+                index_table[(a * (order + 1) + b) * (order + 1) + c] = multi_a.size();
+                multi_a.push_back(a);
+                multi_b.push_back(b);
+                multi_c.push_back(c);
+            }
+        }
+    }
+    num_coefficients = multi_a.size();
+
+    recurrence_direction.assign(num_coefficients, -1);
+    recurrence_minus_one.assign(num_coefficients, -1);
+    recurrence_minus_two.assign(num_coefficients, -1);
+    for(int k = 1; k < num_coefficients; k++)
+    {
+        int component[3] = {multi_a[k], multi_b[k], multi_c[k]};
+        int direction = component[0] > 0 ? 0 : (component[1] > 0 ? 1 : 2);
+
+        component[direction]--;
+        recurrence_direction[k] = direction;
+        recurrence_minus_one[k] = Index(component[0], component[1], component[2]);
+        if (component[direction] > 0)
+        {
+            component[direction]--;
+            recurrence_minus_two[k] = Index(component[0], component[1], component[2]);
+        }
+    }
+
+    // shifts: out[k] += in[l] * u^(k - l) / (k - l)! for every l <= k
+    shift_terms.clear();
+    // multipole to local: L[n] += (-1)^|k| M[k] d^(k + n) G for |k| + |n| <= order
+    m2l_terms.clear();
+    m2l_signs.clear();
+    for(int k = 0; k < num_coefficients; k++)
+    {
+        for(int l = 0; l < num_coefficients; l++)
+        {
+            if (multi_a[l] <= multi_a[k] && multi_b[l] <= multi_b[k] && multi_c[l] <= multi_c[k])
+            {
+                shift_terms.push_back(Term{k, l, Index(multi_a[k] - multi_a[l], multi_b[k] - multi_b[l], multi_c[k] - multi_c[l])});
+            }
+
+            int degree = multi_a[k] + multi_b[k] + multi_c[k] + multi_a[l] + multi_b[l] + multi_c[l];
+            if (degree <= order)
+            {
+                m2l_terms.push_back(Term{l, k, Index(multi_a[k] + multi_a[l], multi_b[k] + multi_b[l], multi_c[k] + multi_c[l])});
+                m2l_signs.push_back((multi_a[k] + multi_b[k] + multi_c[k]) % 2 == 0 ? 1.0 : -1.0);
+            }
+        }
+    }
+}
+
+// s^k / k! for every multi-index k
+void FmmSolver::Monomials(double s_x, double s_y, double s_z, double* out) const
+{
+    double power_x[max_order + 1], power_y[max_order + 1], power_z[max_order + 1];
+    power_x[0] = power_y[0] = power_z[0] = 1.0;
+    for(int n = 1; n <= order; n++)
+    {
+        power_x[n] = power_x[n - 1] * s_x / n;
+        power_y[n] = power_y[n - 1] * s_y / n;
+        power_z[n] = power_z[n - 1] * s_z / n;
+    }
+
+    for(int k = 0; k < num_coefficients; k++)
+    {
+        out[k] = power_x[multi_a[k]] * power_y[multi_b[k]] * power_z[multi_c[k]];
+    }
+}
+
+// derivatives d^k G of the softened kernel G = 1 / sqrt(r^2 + epsilon^2) for every multi-index k
+// with h_m = (-1)^m (2m - 1)!! / R^(2m + 1) and R^2 = r^2 + epsilon^2, the radial functions satisfy
+// d_d h_m = r_d h_(m+1), so d^k h_m = r_d d^(k - e_d) h_(m+1) + (k_d - 1) d^(k - 2 e_d) h_(m+1)
+void FmmSolver::Derivatives(double dx, double dy, double dz, double* out, double* workspace) const
+{
+    const double r[3] = {dx, dy, dz};
+    const double inv_dist_squared = 1.0 / (dx*dx + dy*dy + dz*dz + eps_squared);
+
+    // workspace holds d^k h_m at [m * num_coefficients + k]
+    double h = std::sqrt(inv_dist_squared);
+    for(int m = 0; m <= order; m++)
+    {
+        workspace[m * num_coefficients] = h;
+        h *= -(2 * m + 1) * inv_dist_squared;
+    }
+
+    for(int k = 1; k < num_coefficients; k++)
+    {
+        const int degree = multi_a[k] + multi_b[k] + multi_c[k];
+        const int direction = recurrence_direction[k];
+        const int minus_one = recurrence_minus_one[k];
+        const int minus_two = recurrence_minus_two[k];
+        const int component[3] = {multi_a[k], multi_b[k], multi_c[k]};
+        const double count = component[direction] - 1;
+
+        for(int m = 0; m <= order - degree; m++)
+        {
+            const double* next = workspace + (m + 1) * num_coefficients;
+            double value = r[direction] * next[minus_one];
+            if (minus_two >= 0)
+            {
+                value += count * next[minus_two];
+            }
+            workspace[m * num_coefficients + k] = value;
+        }
+    }
+
+    std::copy(workspace, workspace + num_coefficients, out);
+}
+
+// expansion centres, radii and multipoles of every cell, from the leaves up
+void FmmSolver::Upward(const ParticleStore& particles)
+{
+    const auto& nodes = tree.GetNodes();
+    const auto& body_order = tree.GetOrder();
+    const int num_nodes = nodes.size();
+
+    centres.assign(3 * num_nodes, 0.0);
+    radii.assign(num_nodes, 0.0);
+    multipoles.assign(num_nodes * num_coefficients, 0.0);
+    parents.assign(num_nodes, -1);
+    levels.clear();
+
+    for(int node_index = 0; node_index < num_nodes; node_index++)
+    {
+        const Octree::Node& node = nodes[node_index];
+        if (int(levels.size()) <= node.depth)
+        {
+            levels.resize(node.depth + 1);
+        }
+        levels[node.depth].push_back(node_index);
+        for(int c = node.first_child; c < node.first_child + node.num_children; c++)
+        {
+            parents[c] = node_index;
+        }
+    }
+
+    // expanding about the centre of mass makes the dipole terms vanish
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int node_index = 0; node_index < num_nodes; node_index++)
+    {
+        const Octree::Node& node = nodes[node_index];
+        double mass = 0.0;
+        double weighted[3] = {0.0, 0.0, 0.0};
+        for(int n = node.begin; n < node.end; n++)
+        {
+            int i = body_order[n];
+            mass += particles.mass[i];
+            weighted[0] += particles.mass[i] * particles.x[i];
+            weighted[1] += particles.mass[i] * particles.y[i];
+            weighted[2] += particles.mass[i] * particles.z[i];
+        }
+
+        double* centre = centres.data() + 3 * node_index;
+        int first = body_order[node.begin];
+        centre[0] = mass > 0 ? weighted[0] / mass : particles.x[first];
+        centre[1] = mass > 0 ? weighted[1] / mass : particles.y[first];
+        centre[2] = mass > 0 ? weighted[2] / mass : particles.z[first];
+
+        double radius_squared = 0.0;
+        for(int n = node.begin; n < node.end; n++)
+        {
+            int i = body_order[n];
+            double dx = particles.x[i] - centre[0];
+            double dy = particles.y[i] - centre[1];
+            double dz = particles.z[i] - centre[2];
+            radius_squared = std::max(radius_squared, dx*dx + dy*dy + dz*dz);
+        }
+        radii[node_index] = std::sqrt(radius_squared);
+    }
+
+    // particle to multipole at the leaves
+    #pragma omp parallel
+    {
+        std::vector<double> monomials(num_coefficients);
+
+        #pragma omp for schedule(dynamic, 16)
+        for(int node_index = 0; node_index < num_nodes; node_index++)
+        {
+            const Octree::Node& node = nodes[node_index];
+            if (node.num_children > 0)
+            {
+                continue;
+            }
+
+            const double* centre = centres.data() + 3 * node_index;
+            double* multipole = multipoles.data() + node_index * num_coefficients;
+            for(int n = node.begin; n < node.end; n++)
+            {
+                int i = body_order[n];
+                Monomials(particles.x[i] - centre[0], particles.y[i] - centre[1], particles.z[i] - centre[2], monomials.data());
+                for(int k = 0; k < num_coefficients; k++)
+                {
+                    multipole[k] += particles.mass[i] * monomials[k];
+                }
+            }
+        }
+    }
+
+    // multipole to multipole, one level at a time from the bottom up
+    for(int level = int(levels.size()) - 2; level >= 0; level--)
+    {
+        #pragma omp parallel
+        {
+            std::vector<double> monomials(num_coefficients);
+
+            #pragma omp for schedule(dynamic, 4)
+            for(int n = 0; n < int(levels[level].size()); n++)
+            {
+                const int node_index = levels[level][n];
+                const Octree::Node& node = nodes[node_index];
+                double* multipole = multipoles.data() + node_index * num_coefficients;
+                const double* centre = centres.data() + 3 * node_index;
+
+                for(int c = node.first_child; c < node.first_child + node.num_children; c++)
+                {
+                    const double* child_centre = centres.data() + 3 * c;
+                    const double* child_multipole = multipoles.data() + c * num_coefficients;
+                    Monomials(child_centre[0] - centre[0], child_centre[1] - centre[1], child_centre[2] - centre[2], monomials.data());
+                    for(const Term& term : shift_terms)
+                    {
+                        multipole[term.target] += child_multipole[term.source] * monomials[term.factor_index];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// dual tree walk sorting every pair of cells into an expansion (M2L) or a direct (P2P) interaction
+// the field of source on the bodies of target is accounted for exactly once
+void FmmSolver::Interact(int target, int source)
+{
+    const auto& nodes = tree.GetNodes();
+    const Octree::Node& target_node = nodes[target];
+    const Octree::Node& source_node = nodes[source];
+
+    if (target == source)
+    {
+        if (target_node.num_children == 0)
+        {
+            p2p_lists[target].push_back(source);
+            return;
+        }
+        for(int a = target_node.first_child; a < target_node.first_child + target_node.num_children; a++)
+        {
+            for(int b = target_node.first_child; b < target_node.first_child + target_node.num_children; b++)
+            {
+                Interact(a, b);
+            }
+        }
+        return;
+    }
+
+    double dx = centres[3 * target] - centres[3 * source];
+    double dy = centres[3 * target + 1] - centres[3 * source + 1];
+    double dz = centres[3 * target + 2] - centres[3 * source + 2];
+    double distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+    if (radii[target] + radii[source] < theta * distance)
+    {
+        m2l_lists[target].push_back(source);
+        return;
+    }
+
+    bool target_leaf = target_node.num_children == 0;
+    bool source_leaf = source_node.num_children == 0;
+    if (target_leaf && source_leaf)
+    {
+        p2p_lists[target].push_back(source);
+    }
+    // splitting the larger of the two cells
+    else if (!target_leaf && (source_leaf || radii[target] >= radii[source]))
+    {
+        for(int a = target_node.first_child; a < target_node.first_child + target_node.num_children; a++)
+        {
+            Interact(a, source);
+        }
+    }
+    else
+    {
+        for(int b = source_node.first_child; b < source_node.first_child + source_node.num_children; b++)
+        {
+            Interact(target, b);
+        }
+    }
+}
+
+// multipole to local for every cell, then local to local from the top down
+void FmmSolver::Downward()
+{
+    const auto& nodes = tree.GetNodes();
+    const int num_nodes = nodes.size();
+    locals.assign(num_nodes * num_coefficients, 0.0);
+
+    #pragma omp parallel
+    {
+        std::vector<double> derivatives(num_coefficients);
+        std::vector<double> workspace((order + 1) * num_coefficients);
+
+        #pragma omp for schedule(dynamic, 4)
+        for(int target = 0; target < num_nodes; target++)
+        {
+            double* local = locals.data() + target * num_coefficients;
+            const double* centre = centres.data() + 3 * target;
+
+            for(int source : m2l_lists[target])
+            {
+                const double* source_centre = centres.data() + 3 * source;
+                const double* multipole = multipoles.data() + source * num_coefficients;
+                Derivatives(centre[0] - source_centre[0], centre[1] - source_centre[1], centre[2] - source_centre[2], derivatives.data(), workspace.data());
+
+                for(int t = 0; t < int(m2l_terms.size()); t++)
+                {
+                    const Term& term = m2l_terms[t];
+                    local[term.target] += m2l_signs[t] * multipole[term.source] * derivatives[term.factor_index];
+                }
+            }
+        }
+    }
+
+    for(int level = 1; level < int(levels.size()); level++)
+    {
+        #pragma omp parallel
+        {
+            std::vector<double> monomials(num_coefficients);
+
+            #pragma omp for schedule(static)
+            for(int n = 0; n < int(levels[level].size()); n++)
+            {
+                const int node_index = levels[level][n];
+                const int parent = parents[node_index];
+                const double* centre = centres.data() + 3 * node_index;
+                const double* parent_centre = centres.data() + 3 * parent;
+                const double* parent_local = locals.data() + parent * num_coefficients;
+                double* local = locals.data() + node_index * num_coefficients;
+
+                // L_child[l] += L_parent[k] t^(k - l) / (k - l)! for every k >= l
+                Monomials(centre[0] - parent_centre[0], centre[1] - parent_centre[1], centre[2] - parent_centre[2], monomials.data());
+                for(const Term& term : shift_terms)
+                {
+                    local[term.source] += parent_local[term.target] * monomials[term.factor_index];
+                }
+            }
+        }
+    }
+}
+
+void FmmSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    if (num_particles == 0)
+    {
+        return;
+    }
+    eps_squared = double(epsilon) * double(epsilon);
+
+    tree.Build(particles);
+    Upward(particles);
+
+    const int num_nodes = tree.NumNodes();
+    m2l_lists.assign(num_nodes, {});
+    p2p_lists.assign(num_nodes, {});
+    Interact(0, 0);
+
+    Downward();
+
+    const auto& nodes = tree.GetNodes();
+    const auto& body_order = tree.GetOrder();
+
+    // local to particle and direct summation over the neighbouring leaves
+    #pragma omp parallel
+    {
+        std::vector<double> monomials(num_coefficients);
+
+        #pragma omp for schedule(dynamic, 16)
+        for(int leaf = 0; leaf < num_nodes; leaf++)
+        {
+            const Octree::Node& node = nodes[leaf];
+            if (node.num_children > 0)
+            {
+                continue;
+            }
+
+            const double* centre = centres.data() + 3 * leaf;
+            const double* local = locals.data() + leaf * num_coefficients;
+
+            for(int n = node.begin; n < node.end; n++)
+            {
+                const int i = body_order[n];
+                double sum_x = 0.0;
+                double sum_y = 0.0;
+                double sum_z = 0.0;
+
+                // the acceleration is the gradient of the local expansion
+                Monomials(particles.x[i] - centre[0], particles.y[i] - centre[1], particles.z[i] - centre[2], monomials.data());
+                for(int k = 0; k < num_coefficients; k++)
+                {
+                    if (multi_a[k] + multi_b[k] + multi_c[k] < order)
+                    {
+                        sum_x += local[Index(multi_a[k] + 1, multi_b[k], multi_c[k])] * monomials[k];
+                        sum_y += local[Index(multi_a[k], multi_b[k] + 1, multi_c[k])] * monomials[k];
+                        sum_z += local[Index(multi_a[k], multi_b[k], multi_c[k] + 1)] * monomials[k];
+                    }
+                }
+
+                for(int source : p2p_lists[leaf])
+                {
+                    const Octree::Node& source_node = nodes[source];
+                    for(int m = source_node.begin; m < source_node.end; m++)
+                    {
+                        const int j = body_order[m];
+                        if (j != i)
+                        {
+                            double dx = particles.x[j] - particles.x[i];
+                            double dy = particles.y[j] - particles.y[i];
+                            double dz = particles.z[j] - particles.z[i];
+                            double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                            double factor = particles.mass[j] / (dist_squared * std::sqrt(dist_squared));
+                            sum_x += factor * dx;
+                            sum_y += factor * dy;
+                            sum_z += factor * dz;
+                        }
+                    }
+                }
+
+                acc_x[i] = sum_x;
+                acc_y[i] = sum_y;
+                acc_z[i] = sum_z;
+            }
+        }
+    }
+}
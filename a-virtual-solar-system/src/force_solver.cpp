@@ -0,0 +1,278 @@
+#include "force_solver.hpp"
+#include "particle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <omp.h>
+
+// comparing a solver against the direct summation on sample_size bodies spread evenly through the store
+ForceComparison ForceSolver::CompareWithDirectSum(ForceSolver& solver, const ParticleStore& particles, float epsilon, int sample_size)
+{
+    const int num_particles = particles.Size();
+    sample_size = std::max(1, std::min(sample_size, num_particles));
+
+    ForceComparison comparison;
+    comparison.sample_size = sample_size;
+
+    std::vector<double> acc_x(num_particles), acc_y(num_particles), acc_z(num_particles);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    solver.ComputeAccelerations(particles, epsilon, acc_x.data(), acc_y.data(), acc_z.data());
+    auto end_time = std::chrono::high_resolution_clock::now();
+    comparison.solver_seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+    // direct summation for the sampled bodies only
+    const double eps_squared = double(epsilon) * double(epsilon);
+    std::vector<double> relative_errors(sample_size);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for schedule(static)
+    for(int s = 0; s < sample_size; s++)
+    {
+        int i = int((long(s) * num_particles) / sample_size);
+
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        double sum_z = 0.0;
+        for(int j = 0; j < num_particles; j++)
+        {
+            if (j != i)
+            {
+                double dx = particles.x[j] - particles.x[i];
+                double dy = particles.y[j] - particles.y[i];
+                double dz = particles.z[j] - particles.z[i];
+                double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                double factor = particles.mass[j] / (dist_squared * std::sqrt(dist_squared));
+                sum_x += factor * dx;
+                sum_y += factor * dy;
+                sum_z += factor * dz;
+            }
+        }
+
+        Eigen::Vector3d expected_acc = {sum_x, sum_y, sum_z};
+        Eigen::Vector3d acc = {acc_x[i], acc_y[i], acc_z[i]};
+        double reference = expected_acc.norm();
+        relative_errors[s] = reference > 0 ? (acc - expected_acc).norm() / reference : acc.norm();
+    }
+    end_time = std::chrono::high_resolution_clock::now();
+    comparison.direct_seconds = std::chrono::duration<double>(end_time - start_time).count() * num_particles / sample_size;
+
+    comparison.max_relative_error = 0.0;
+    double sum_squared_error = 0.0;
+    for(double error : relative_errors)
+    {
+        comparison.max_relative_error = std::max(comparison.max_relative_error, error);
+        sum_squared_error += error * error;
+    }
+    comparison.rms_relative_error = std::sqrt(sum_squared_error / sample_size);
+
+    return comparison;
+}
+
+// accelerations followed by a separate pass for the potential energy
+double ForceSolver::ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    ComputeAccelerations(particles, epsilon, acc_x, acc_y, acc_z);
+    return SolarSystem::PotentialEnergy(particles, epsilon);
+}
+
+void DirectSumSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    SolarSystem::ComputeAccelerations(particles, epsilon, acc_x, acc_y, acc_z);
+}
+
+// potentials of the single bodies from the force loop, each pair counted from both of its ends
+double DirectSumSolver::ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    std::vector<double> potentials(particles.Size());
+    SolarSystem::ComputeAccelerationsAndPotentials(particles, epsilon, acc_x, acc_y, acc_z, potentials.data());
+
+    double total_pe = 0.0;
+    for(int i = 0; i < particles.Size(); i++)
+    {
+        total_pe += 0.5 * particles.mass[i] * potentials[i];
+    }
+    return total_pe;
+}
+
+// blocks of rows with about the same number of pairs: row i holds the num_particles - 1 - i pairs (i, j > i)
+void PairBuffers::Reset(int num_particles, int num_arrays)
+{
+    const int num_blocks = num_particles < ExecutionEngine::default_serial_threshold ? 1 : omp_get_max_threads();
+    this->num_particles = num_particles;
+    this->num_arrays = num_arrays;
+    buffers.assign(std::size_t(num_blocks) * num_arrays * num_particles, 0.0);
+
+    const long long total_pairs = (long long)num_particles * (num_particles - 1) / 2;
+    row_begin.assign(num_blocks + 1, num_particles);
+    row_begin[0] = 0;
+
+    long long pairs = 0;
+    int block = 1;
+    for(int i = 0; i < num_particles && block < num_blocks; i++)
+    {
+        while (block < num_blocks && pairs * num_blocks >= total_pairs * block)
+        {
+            row_begin[block++] = i;
+        }
+        pairs += num_particles - 1 - i;
+    }
+}
+
+int PairBuffers::NumBlocks() const
+{
+    return int(row_begin.size()) - 1;
+}
+
+int PairBuffers::RowBegin(int block) const
+{
+    return row_begin[block];
+}
+
+double* PairBuffers::Buffer(int block, int array)
+{
+    return buffers.data() + (std::size_t(block) * num_arrays + array) * num_particles;
+}
+
+void PairBuffers::Reduce(double* const* outputs)
+{
+    const int num_blocks = NumBlocks();
+
+    // a single block is only copied, by its one thread
+    if (num_blocks == 1)
+    {
+        for(int array = 0; array < num_arrays; array++)
+        {
+            std::copy(buffers.begin() + std::size_t(array) * num_particles, buffers.begin() + std::size_t(array + 1) * num_particles, outputs[array]);
+        }
+        return;
+    }
+
+    // the blocks are not handed out by a worksharing loop, so nothing has waited for them yet
+    #pragma omp barrier
+
+    #pragma omp for schedule(static)
+    for(int i = 0; i < num_particles; i++)
+    {
+        for(int array = 0; array < num_arrays; array++)
+        {
+            double total = 0.0;
+            for(int block = 0; block < num_blocks; block++)
+            {
+                total += buffers[(std::size_t(block) * num_arrays + array) * num_particles + i];
+            }
+            outputs[array][i] = total;
+        }
+    }
+}
+
+void PairwiseSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    Accumulate<false>(particles, epsilon, acc_x, acc_y, acc_z);
+}
+
+double PairwiseSolver::ComputeAccelerationsAndPotential(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    return Accumulate<true>(particles, epsilon, acc_x, acc_y, acc_z);
+}
+
+// symmetric direct summation using Newton's third law
+// 1 / r of a pair is dist_squared * inv_dist_cubed, so the potential costs one multiply-add per pair on top of the forces
+template<bool with_potential>
+double PairwiseSolver::Accumulate(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    buffers.Reset(num_particles, 3);
+    const int num_blocks = buffers.NumBlocks();
+    double* outputs[3] = {acc_x, acc_y, acc_z};
+
+    // potential energy of every block, summed in block order at the end
+    std::vector<double> block_pe(num_blocks, 0.0);
+
+    auto accumulate_block = [&](int block)
+    {
+        double* buffer_x = buffers.Buffer(block, 0);
+        double* buffer_y = buffers.Buffer(block, 1);
+        double* buffer_z = buffers.Buffer(block, 2);
+
+        for(int i = buffers.RowBegin(block); i < buffers.RowBegin(block + 1); i++)
+        {
+            double sum_x = 0.0;
+            double sum_y = 0.0;
+            double sum_z = 0.0;
+            double sum_pe = 0.0;
+
+            // kept in registers, as the stores into the buffers could alias the input arrays for the compiler
+            const double x_i = x[i];
+            const double y_i = y[i];
+            const double z_i = z[i];
+            const double mass_i = mass[i];
+
+            for(int j = i + 1; j < num_particles; j++)
+            {
+                double dx = x[j] - x_i;
+                double dy = y[j] - y_i;
+                double dz = z[j] - z_i;
+                double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                double inv_dist_cubed = 1.0 / (dist_squared * std::sqrt(dist_squared));
+                double factor_j = mass[j] * inv_dist_cubed;
+                double factor_i = mass_i * inv_dist_cubed;
+
+                // pull of j on i
+                sum_x += factor_j * dx;
+                sum_y += factor_j * dy;
+                sum_z += factor_j * dz;
+
+                // equal and opposite pull of i on j
+                buffer_x[j] -= factor_i * dx;
+                buffer_y[j] -= factor_i * dy;
+                buffer_z[j] -= factor_i * dz;
+
+                if (with_potential)
+                {
+                    sum_pe += factor_j * dist_squared;
+                }
+            }
+
+            block_pe[block] -= mass_i * sum_pe;
+
+            buffer_x[i] += sum_x;
+            buffer_y[i] += sum_y;
+            buffer_z[i] += sum_z;
+        }
+    };
+
+    // a single block, for systems below the serial threshold, is accumulated on the calling thread without any team
+    if (num_blocks == 1)
+    {
+        accumulate_block(0);
+        buffers.Reduce(outputs);
+    }
+    else
+    {
+        #pragma omp parallel num_threads(num_blocks)
+        {
+            // one block per thread, unless the runtime gave fewer threads than asked for
+            for(int block = omp_get_thread_num(); block < num_blocks; block += omp_get_num_threads())
+            {
+                accumulate_block(block);
+            }
+
+            buffers.Reduce(outputs);
+        }
+    }
+
+    double total_pe = 0.0;
+    for(double pe : block_pe)
+    {
+        total_pe += pe;
+    }
+    return total_pe;
+}
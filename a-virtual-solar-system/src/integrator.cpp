@@ -0,0 +1,1041 @@
+#include "integrator.hpp"
+#include "particle.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+
+std::vector<double> Integrator::GetState() const
+{
+    return {};
+}
+
+void Integrator::SetState(const std::vector<double>&, const ParticleStore&)
+{
+}
+
+void Integrator::Reset()
+{
+    state_version = 0;
+}
+
+void Integrator::SetStateVersion(unsigned long long version)
+{
+    state_version = version;
+}
+
+// first order explicit Euler
+// accelerations already evaluated at the current positions, e.g. by SolarSystem::GetDiagnostics, are reused
+void EulerIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    if (!system.AccelerationsAreCurrent())
+    {
+        system.UpdateAccelerations(epsilon);
+    }
+    system.Drift(dt);
+    system.Kick(dt);
+}
+
+std::string EulerIntegrator::GetName() const
+{
+    return "euler";
+}
+
+int EulerIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1;
+}
+
+// kick-drift-kick leapfrog
+void LeapfrogIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    if (!system.AccelerationsAreCurrent())
+    {
+        system.UpdateAccelerations(epsilon);
+    }
+    system.Kick(dt / 2);
+    system.Drift(dt);
+    system.UpdateAccelerations(epsilon);
+    system.Kick(dt / 2);
+}
+
+std::string LeapfrogIntegrator::GetName() const
+{
+    return "leapfrog";
+}
+
+int LeapfrogIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1;
+}
+
+// velocity Verlet in its textbook form
+void VelocityVerletIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    if (!system.AccelerationsAreCurrent())
+    {
+        system.UpdateAccelerations(epsilon);
+    }
+
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    old_ax = particles.ax;
+    old_ay = particles.ay;
+    old_az = particles.az;
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        particles.x[i] += dt * particles.vx[i] + 0.5 * dt * dt * particles.ax[i];
+        particles.y[i] += dt * particles.vy[i] + 0.5 * dt * dt * particles.ay[i];
+        particles.z[i] += dt * particles.vz[i] + 0.5 * dt * dt * particles.az[i];
+    });
+
+    system.UpdateAccelerations(epsilon);
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        particles.vx[i] += 0.5 * dt * (old_ax[i] + particles.ax[i]);
+        particles.vy[i] += 0.5 * dt * (old_ay[i] + particles.ay[i]);
+        particles.vz[i] += 0.5 * dt * (old_az[i] + particles.az[i]);
+    });
+}
+
+std::string VelocityVerletIntegrator::GetName() const
+{
+    return "verlet";
+}
+
+int VelocityVerletIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1;
+}
+
+// fourth order Forest-Ruth / Yoshida integrator
+void YoshidaIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    const double w1 = 1.0 / (2.0 - std::cbrt(2.0));
+    const double w0 = -std::cbrt(2.0) * w1;
+
+    // drift coefficients c1 = c4 = w1 / 2, c2 = c3 = (w0 + w1) / 2 and kick coefficients d1 = d3 = w1, d2 = w0
+    system.Drift(0.5 * w1 * dt);
+    system.UpdateAccelerations(epsilon);
+    system.Kick(w1 * dt);
+    system.Drift(0.5 * (w0 + w1) * dt);
+    system.UpdateAccelerations(epsilon);
+    system.Kick(w0 * dt);
+    system.Drift(0.5 * (w0 + w1) * dt);
+    system.UpdateAccelerations(epsilon);
+    system.Kick(w1 * dt);
+    system.Drift(0.5 * w1 * dt);
+}
+
+std::string YoshidaIntegrator::GetName() const
+{
+    return "yoshida";
+}
+
+int YoshidaIntegrator::ForceEvaluationsPerStep() const
+{
+    return 3;
+}
+
+// fourth order Hermite scheme with block timesteps
+BlockTimestepIntegrator::BlockTimestepIntegrator(double eta, int max_level) : eta(eta), max_level(max_level), last_dt(0.0), last_epsilon(0.0f), body_evaluations(0)
+{
+    if (eta <= 0)
+    {
+        throw std::logic_error("The timestep accuracy parameter eta should be greater than 0.");
+    }
+    if (max_level < 0 || max_level > 30)
+    {
+        throw std::logic_error("The maximum timestep level should be between 0 and 30.");
+    }
+}
+
+int BlockTimestepIntegrator::TimestepLevel(double acc, double jerk, double dt) const
+{
+    if (jerk == 0 || eta * acc >= dt * jerk)
+    {
+        return 0;
+    }
+    int level = std::ceil(std::log2(dt * jerk / (eta * acc)));
+    return std::min(level, max_level);
+}
+
+void BlockTimestepIntegrator::Initialise(SolarSystem& system, float epsilon)
+{
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+
+    // the central star is fixed, so it is predicted with zero velocity
+    predicted = particles;
+    predicted.vx[0] = predicted.vy[0] = predicted.vz[0] = 0.0;
+
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z, &new_ax, &new_ay, &new_az, &new_jx, &new_jy, &new_jz})
+    {
+        component->assign(num_particles, 0.0);
+    }
+    levels.assign(num_particles, 0);
+    times.assign(num_particles, 0);
+
+    active.clear();
+    for(int i = 1; i < num_particles; i++)
+    {
+        active.push_back(i);
+    }
+    SolarSystem::ComputeAccelerationsAndJerks(predicted, active, epsilon, particles.ax.data(), particles.ay.data(), particles.az.data(),
+                                              jerk_x.data(), jerk_y.data(), jerk_z.data());
+    body_evaluations += active.size();
+
+    for(int i = 1; i < num_particles; i++)
+    {
+        double acc = std::sqrt(particles.ax[i]*particles.ax[i] + particles.ay[i]*particles.ay[i] + particles.az[i]*particles.az[i]);
+        double jerk = std::sqrt(jerk_x[i]*jerk_x[i] + jerk_y[i]*jerk_y[i] + jerk_z[i]*jerk_z[i]);
+        levels[i] = TimestepLevel(acc, jerk, last_dt);
+    }
+}
+
+void BlockTimestepIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    // the forces, jerks and levels of the previous block can be reused if they were taken on this system and nobody
+    // touched it in between
+    bool reuse = system.AccelerationsAreCurrent() && system.GetVersion() == state_version && dt == last_dt && epsilon == last_epsilon;
+    last_dt = dt;
+    last_epsilon = epsilon;
+    if (!reuse)
+    {
+        Initialise(system, epsilon);
+    }
+
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    const long long block_ticks = 1LL << max_level;
+    const double tick = dt / block_ticks;
+    std::fill(times.begin(), times.end(), 0);
+
+    long long now = 0;
+    while (now < block_ticks)
+    {
+        // the bodies due next are the active ones
+        long long next = block_ticks;
+        for(int i = 1; i < num_particles; i++)
+        {
+            next = std::min(next, times[i] + (1LL << (max_level - levels[i])));
+        }
+        active.clear();
+        for(int i = 1; i < num_particles; i++)
+        {
+            if (times[i] + (1LL << (max_level - levels[i])) == next)
+            {
+                active.push_back(i);
+            }
+        }
+
+        // predicting every body to the next time with x + v t + a t^2 / 2 + j t^3 / 6
+        ParallelFor(num_particles, 1, num_particles, [&](int i)
+        {
+            double t = (next - times[i]) * tick;
+            predicted.x[i] = particles.x[i] + t * (particles.vx[i] + t / 2 * (particles.ax[i] + t / 3 * jerk_x[i]));
+            predicted.y[i] = particles.y[i] + t * (particles.vy[i] + t / 2 * (particles.ay[i] + t / 3 * jerk_y[i]));
+            predicted.z[i] = particles.z[i] + t * (particles.vz[i] + t / 2 * (particles.az[i] + t / 3 * jerk_z[i]));
+            predicted.vx[i] = particles.vx[i] + t * (particles.ax[i] + t / 2 * jerk_x[i]);
+            predicted.vy[i] = particles.vy[i] + t * (particles.ay[i] + t / 2 * jerk_y[i]);
+            predicted.vz[i] = particles.vz[i] + t * (particles.az[i] + t / 2 * jerk_z[i]);
+        });
+
+        SolarSystem::ComputeAccelerationsAndJerks(predicted, active, epsilon, new_ax.data(), new_ay.data(), new_az.data(),
+                                                  new_jx.data(), new_jy.data(), new_jz.data());
+        body_evaluations += active.size();
+
+        // Hermite corrector on the active bodies:
+        // v1 = v0 + (a0 + a1) h / 2 + (j0 - j1) h^2 / 12 and x1 = x0 + (v0 + v1) h / 2 + (a0 - a1) h^2 / 12
+        const int num_active = active.size();
+        ParallelFor(num_particles, 0, num_active, [&](int k)
+        {
+            const int i = active[k];
+            const double h = (next - times[i]) * tick;
+
+            double vx = particles.vx[i] + h / 2 * (particles.ax[i] + new_ax[i]) + h * h / 12 * (jerk_x[i] - new_jx[i]);
+            double vy = particles.vy[i] + h / 2 * (particles.ay[i] + new_ay[i]) + h * h / 12 * (jerk_y[i] - new_jy[i]);
+            double vz = particles.vz[i] + h / 2 * (particles.az[i] + new_az[i]) + h * h / 12 * (jerk_z[i] - new_jz[i]);
+            particles.x[i] += h / 2 * (particles.vx[i] + vx) + h * h / 12 * (particles.ax[i] - new_ax[i]);
+            particles.y[i] += h / 2 * (particles.vy[i] + vy) + h * h / 12 * (particles.ay[i] - new_ay[i]);
+            particles.z[i] += h / 2 * (particles.vz[i] + vz) + h * h / 12 * (particles.az[i] - new_az[i]);
+            particles.vx[i] = vx;
+            particles.vy[i] = vy;
+            particles.vz[i] = vz;
+
+            particles.ax[i] = new_ax[i];
+            particles.ay[i] = new_ay[i];
+            particles.az[i] = new_az[i];
+            jerk_x[i] = new_jx[i];
+            jerk_y[i] = new_jy[i];
+            jerk_z[i] = new_jz[i];
+            times[i] = next;
+
+            // a body can always move to a finer level, but only to the next coarser one when its time is a multiple of that step
+            double acc = std::sqrt(new_ax[i]*new_ax[i] + new_ay[i]*new_ay[i] + new_az[i]*new_az[i]);
+            double jerk = std::sqrt(new_jx[i]*new_jx[i] + new_jy[i]*new_jy[i] + new_jz[i]*new_jz[i]);
+            int level = TimestepLevel(acc, jerk, dt);
+            if (level > levels[i])
+            {
+                levels[i] = level;
+            }
+            else if (level < levels[i] && next % (1LL << (max_level - levels[i] + 1)) == 0)
+            {
+                levels[i]--;
+            }
+        });
+
+        now = next;
+    }
+
+    // every body ends the block at the same time, with its forces evaluated there
+    system.MarkAccelerationsCurrent();
+    state_version = system.GetVersion();
+}
+
+std::string BlockTimestepIntegrator::GetName() const
+{
+    return "block";
+}
+
+int BlockTimestepIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1 << max_level;
+}
+
+void BlockTimestepIntegrator::Reset()
+{
+    Integrator::Reset();
+    levels.clear();
+    times.clear();
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        component->clear();
+    }
+}
+
+double BlockTimestepIntegrator::GetEta() const
+{
+    return eta;
+}
+
+int BlockTimestepIntegrator::GetMaxLevel() const
+{
+    return max_level;
+}
+
+const std::vector<int>& BlockTimestepIntegrator::GetLevels() const
+{
+    return levels;
+}
+
+long long BlockTimestepIntegrator::GetBodyForceEvaluations() const
+{
+    return body_evaluations;
+}
+
+// laid out as last_dt, last_epsilon, body_evaluations, then the levels and the x, y and z jerks of all bodies
+std::vector<double> BlockTimestepIntegrator::GetState() const
+{
+    std::vector<double> state = {last_dt, last_epsilon, double(body_evaluations)};
+    state.insert(state.end(), levels.begin(), levels.end());
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        state.insert(state.end(), component->begin(), component->end());
+    }
+    return state;
+}
+
+void BlockTimestepIntegrator::SetState(const std::vector<double>& state, const ParticleStore& particles)
+{
+    const int num_particles = particles.Size();
+    if (state.size() != 3 + 4 * std::size_t(num_particles))
+    {
+        throw std::logic_error("The state does not belong to a BlockTimestepIntegrator with this number of bodies.");
+    }
+    last_dt = state[0];
+    last_epsilon = state[1];
+    body_evaluations = state[2];
+
+    auto values = state.begin() + 3;
+    levels.assign(values, values + num_particles);
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        values += num_particles;
+        component->assign(values, values + num_particles);
+    }
+
+    // the scratch arrays are rebuilt as in Initialise
+    predicted = particles;
+    predicted.vx[0] = predicted.vy[0] = predicted.vz[0] = 0.0;
+    for(auto component : {&new_ax, &new_ay, &new_az, &new_jx, &new_jy, &new_jz})
+    {
+        component->assign(num_particles, 0.0);
+    }
+    times.assign(num_particles, 0);
+}
+
+// fourth order Hermite scheme with a shared timestep
+HermiteIntegrator::HermiteIntegrator() : last_epsilon(0.0f)
+{
+}
+
+void HermiteIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    // the jerks of the previous step can be reused if they were taken on this system and nobody touched it in between
+    bool reuse = system.AccelerationsAreCurrent() && system.GetVersion() == state_version && epsilon == last_epsilon;
+    last_epsilon = epsilon;
+
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    if (!reuse)
+    {
+        for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+        {
+            component->assign(num_particles, 0.0);
+        }
+        SolarSystem::ComputeAccelerationsAndJerks(particles, epsilon, buffers, particles.ax.data(), particles.ay.data(), particles.az.data(),
+                                                  jerk_x.data(), jerk_y.data(), jerk_z.data());
+    }
+
+    old_x = particles.x;
+    old_y = particles.y;
+    old_z = particles.z;
+    old_vx = particles.vx;
+    old_vy = particles.vy;
+    old_vz = particles.vz;
+    old_ax = particles.ax;
+    old_ay = particles.ay;
+    old_az = particles.az;
+    old_jx = jerk_x;
+    old_jy = jerk_y;
+    old_jz = jerk_z;
+
+    // predicting every body except the central star with x + v h + a h^2 / 2 + j h^3 / 6
+    const double h = dt;
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        particles.x[i] += h * (particles.vx[i] + h / 2 * (particles.ax[i] + h / 3 * jerk_x[i]));
+        particles.y[i] += h * (particles.vy[i] + h / 2 * (particles.ay[i] + h / 3 * jerk_y[i]));
+        particles.z[i] += h * (particles.vz[i] + h / 2 * (particles.az[i] + h / 3 * jerk_z[i]));
+        particles.vx[i] += h * (particles.ax[i] + h / 2 * jerk_x[i]);
+        particles.vy[i] += h * (particles.ay[i] + h / 2 * jerk_y[i]);
+        particles.vz[i] += h * (particles.az[i] + h / 2 * jerk_z[i]);
+    });
+
+    SolarSystem::ComputeAccelerationsAndJerks(particles, epsilon, buffers, particles.ax.data(), particles.ay.data(), particles.az.data(),
+                                              jerk_x.data(), jerk_y.data(), jerk_z.data());
+
+    // corrector, the velocity first as the position needs it
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        particles.vx[i] = old_vx[i] + h / 2 * (old_ax[i] + particles.ax[i]) + h * h / 12 * (old_jx[i] - jerk_x[i]);
+        particles.vy[i] = old_vy[i] + h / 2 * (old_ay[i] + particles.ay[i]) + h * h / 12 * (old_jy[i] - jerk_y[i]);
+        particles.vz[i] = old_vz[i] + h / 2 * (old_az[i] + particles.az[i]) + h * h / 12 * (old_jz[i] - jerk_z[i]);
+        particles.x[i] = old_x[i] + h / 2 * (old_vx[i] + particles.vx[i]) + h * h / 12 * (old_ax[i] - particles.ax[i]);
+        particles.y[i] = old_y[i] + h / 2 * (old_vy[i] + particles.vy[i]) + h * h / 12 * (old_ay[i] - particles.ay[i]);
+        particles.z[i] = old_z[i] + h / 2 * (old_vz[i] + particles.vz[i]) + h * h / 12 * (old_az[i] - particles.az[i]);
+    });
+
+    // the forces at the predicted positions stand in for those at the corrected ones, as in the BlockTimestepIntegrator
+    system.MarkAccelerationsCurrent();
+    state_version = system.GetVersion();
+}
+
+std::string HermiteIntegrator::GetName() const
+{
+    return "hermite";
+}
+
+void HermiteIntegrator::Reset()
+{
+    Integrator::Reset();
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        component->clear();
+    }
+}
+
+int HermiteIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1;
+}
+
+// laid out as last_epsilon, then the x, y and z jerks of all bodies
+std::vector<double> HermiteIntegrator::GetState() const
+{
+    std::vector<double> state = {last_epsilon};
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        state.insert(state.end(), component->begin(), component->end());
+    }
+    return state;
+}
+
+void HermiteIntegrator::SetState(const std::vector<double>& state, const ParticleStore& particles)
+{
+    const int num_particles = particles.Size();
+    if (state.size() != 1 + 3 * std::size_t(num_particles))
+    {
+        throw std::logic_error("The state does not belong to a HermiteIntegrator with this number of bodies.");
+    }
+    last_epsilon = state[0];
+
+    auto values = state.begin() + 1;
+    for(auto component : {&jerk_x, &jerk_y, &jerk_z})
+    {
+        component->assign(values, values + num_particles);
+        values += num_particles;
+    }
+}
+
+// 1 / k! for the series of the Stumpff functions
+static const std::vector<double> inverse_factorials = []()
+{
+    std::vector<double> values = {1.0};
+    for(int k = 1; k <= 24; k++)
+    {
+        values.push_back(values.back() / k);
+    }
+    return values;
+}();
+
+// Stumpff functions c_k(x) = sum_n (-x)^n / (2n + k)!, which give the G functions of the universal anomaly as
+// G_k(beta, s) = s^k c_k(beta s^2); the series is used near 0, where the closed forms lose digits
+static void StumpffFunctions(double x, double& c0, double& c1, double& c2, double& c3)
+{
+    if (std::abs(x) < 1.0)
+    {
+        // terms up to x^10 / 23!, far below the rounding error for |x| < 1
+        c2 = inverse_factorials[22];
+        c3 = inverse_factorials[23];
+        for(int n = 9; n >= 0; n--)
+        {
+            c2 = inverse_factorials[2 * n + 2] - x * c2;
+            c3 = inverse_factorials[2 * n + 3] - x * c3;
+        }
+        c1 = 1.0 - x * c3;
+        c0 = 1.0 - x * c2;
+    }
+    else if (x > 0)
+    {
+        double root = std::sqrt(x);
+        c0 = std::cos(root);
+        c1 = std::sin(root) / root;
+        c2 = (1.0 - c0) / x;
+        c3 = (1.0 - c1) / x;
+    }
+    else
+    {
+        double root = std::sqrt(-x);
+        c0 = std::cosh(root);
+        c1 = std::sinh(root) / root;
+        c2 = (1.0 - c0) / x;
+        c3 = (1.0 - c1) / x;
+    }
+}
+
+void WisdomHolmanIntegrator::KeplerDrift(double mu, double dt, double& x, double& y, double& z, double& vx, double& vy, double& vz)
+{
+    const double r0 = std::sqrt(x*x + y*y + z*z);
+    if (r0 == 0.0 || dt == 0.0)
+    {
+        return;
+    }
+    const double v_squared = vx*vx + vy*vy + vz*vz;
+    const double eta0 = x*vx + y*vy + z*vz;
+
+    // beta = mu / a, positive for bound orbits, whose whole periods can be taken out of dt
+    const double beta = 2.0 * mu / r0 - v_squared;
+    const double zeta0 = mu - beta * r0;
+    double time = dt;
+    if (beta > 0.0)
+    {
+        double period = 2.0 * M_PI * mu / (beta * std::sqrt(beta));
+        time = std::remainder(dt, period);
+    }
+
+    // Laguerre-Conway iterations of order 5 on f(s) = r0 s + eta0 G2 + mu G3 - dt, with f'(s) = r and f''(s) = eta0 G0 + zeta0 G1
+    // f grows with s, so the root stays bracketed, and a step that leaves the bracket is replaced by a bisection, or by
+    // doubling s while one side is still open, as happens for long steps on hyperbolic orbits
+    // starting from s = integral of dt / r with r to first order in time, or from time / r0 if that is not positive
+    double s = time / r0 * (1.0 - 0.5 * eta0 * time / (r0 * r0));
+    if (!(s * time > 0))
+    {
+        s = time / r0;
+    }
+    double low = time > 0 ? 0.0 : -HUGE_VAL;
+    double high = time > 0 ? HUGE_VAL : 0.0;
+    for(int iteration = 0; iteration < 100; iteration++)
+    {
+        double c0, c1, c2, c3;
+        StumpffFunctions(beta * s * s, c0, c1, c2, c3);
+        double g0 = c0;
+        double g1 = s * c1;
+        double g2 = s * s * c2;
+        double g3 = s * s * s * c3;
+
+        double f = r0 * g1 + eta0 * g2 + mu * g3 - time;
+        double f_prime = r0 * g0 + eta0 * g1 + mu * g2;
+        double f_second = eta0 * g0 + zeta0 * g1;
+        if (f < 0)
+        {
+            low = s;
+        }
+        else
+        {
+            high = s;
+        }
+
+        const double n = 5.0;
+        double root = std::sqrt(std::abs((n - 1) * (n - 1) * f_prime * f_prime - n * (n - 1) * f * f_second));
+        double next = s - n * f / (f_prime + std::copysign(root, f_prime));
+        if (std::abs(next - s) <= 1e-15 * std::abs(s))
+        {
+            s = next;
+            break;
+        }
+        if (!(next > low && next < high))
+        {
+            next = std::isinf(low) || std::isinf(high) ? 2.0 * s : 0.5 * (low + high);
+        }
+        s = next;
+    }
+
+    // G functions at the solution
+    double c0, c1, c2, c3;
+    StumpffFunctions(beta * s * s, c0, c1, c2, c3);
+    const double g0 = c0;
+    const double g1 = s * c1;
+    const double g2 = s * s * c2;
+    const double r = r0 * g0 + eta0 * g1 + mu * g2;
+
+    const double f = 1.0 - mu * g2 / r0;
+    const double g = r0 * g1 + eta0 * g2;
+    const double f_dot = -mu * g1 / (r0 * r);
+    const double g_dot = 1.0 - mu * g2 / r;
+
+    double new_x = f * x + g * vx;
+    double new_y = f * y + g * vy;
+    double new_z = f * z + g * vz;
+    vx = f_dot * x + g_dot * vx;
+    vy = f_dot * y + g_dot * vy;
+    vz = f_dot * z + g_dot * vz;
+    x = new_x;
+    y = new_y;
+    z = new_z;
+}
+
+// the interaction is the full acceleration less the Kepler pull -mu r / |r|^3 of the star
+void WisdomHolmanIntegrator::InteractionKick(SolarSystem& system, double dt)
+{
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    const double mu = particles.mass[0];
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        double dx = particles.x[i] - particles.x[0];
+        double dy = particles.y[i] - particles.y[0];
+        double dz = particles.z[i] - particles.z[0];
+        double r_squared = dx*dx + dy*dy + dz*dz;
+        double kepler = r_squared > 0.0 ? mu / (r_squared * std::sqrt(r_squared)) : 0.0;
+        particles.vx[i] += dt * (particles.ax[i] + kepler * dx);
+        particles.vy[i] += dt * (particles.ay[i] + kepler * dy);
+        particles.vz[i] += dt * (particles.az[i] + kepler * dz);
+    });
+}
+
+// kick-Kepler drift-kick in coordinates relative to the star
+void WisdomHolmanIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    if (!system.AccelerationsAreCurrent())
+    {
+        system.UpdateAccelerations(epsilon);
+    }
+    InteractionKick(system, dt / 2);
+
+    // GetParticleStore marks the accelerations stale, as the drift moves the bodies
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    const double mu = particles.mass[0];
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        double x = particles.x[i] - particles.x[0];
+        double y = particles.y[i] - particles.y[0];
+        double z = particles.z[i] - particles.z[0];
+        KeplerDrift(mu, dt, x, y, z, particles.vx[i], particles.vy[i], particles.vz[i]);
+        particles.x[i] = particles.x[0] + x;
+        particles.y[i] = particles.y[0] + y;
+        particles.z[i] = particles.z[0] + z;
+    });
+
+    system.UpdateAccelerations(epsilon);
+    InteractionKick(system, dt / 2);
+
+    // the kick only changes the velocities, so the accelerations still belong to the positions
+    system.MarkAccelerationsCurrent();
+}
+
+std::string WisdomHolmanIntegrator::GetName() const
+{
+    return "wh";
+}
+
+int WisdomHolmanIntegrator::ForceEvaluationsPerStep() const
+{
+    return 1;
+}
+
+// adaptive Bulirsch-Stoer integrator
+// column k of the extrapolation uses 2 (k + 1) substeps
+
+static int Substeps(int column)
+{
+    return 2 * (column + 1);
+}
+
+// force evaluations up to and including column k, the one at the start of the step included
+static long long ColumnWork(int column)
+{
+    long long work = 1;
+    for(int k = 0; k <= column; k++)
+    {
+        work += Substeps(k);
+    }
+    return work;
+}
+
+BulirschStoerIntegrator::BulirschStoerIntegrator(double tolerance, int max_columns)
+    : tolerance(tolerance), max_columns(max_columns), next_step(0.0), target_column(0), steps_taken(0), steps_rejected(0), force_evaluations(0)
+{
+    if (!(tolerance > 0))
+    {
+        throw std::logic_error("The tolerance of the Bulirsch-Stoer integrator should be greater than 0.");
+    }
+    if (max_columns < 2 || max_columns > 16)
+    {
+        throw std::logic_error("The number of extrapolation columns should be between 2 and 16.");
+    }
+
+    // columns for the tolerance, as in ODEX of Hairer and Wanner; later steps adapt it
+    target_column = std::max(1, std::min(max_columns - 2, int(-std::log10(tolerance) * 0.6 + 0.5)));
+    table.resize(max_columns);
+}
+
+void BulirschStoerIntegrator::UpdateWorkAccelerations(float epsilon)
+{
+    SolarSystem::ComputeAccelerations(work, epsilon, work.ax.data(), work.ay.data(), work.az.data());
+    force_evaluations++;
+}
+
+// Gragg's modified midpoint rule: y_1 = y_0 + h f(y_0), y_(m+1) = y_(m-1) + 2 h f(y_m), and the smoothed
+// result (y_n + y_(n-1) + h f(y_n)) / 2, whose error has an expansion in even powers of h
+void BulirschStoerIntegrator::ModifiedMidpoint(double h, int num_substeps, float epsilon)
+{
+    const int num_particles = start.Size();
+    const double substep = h / num_substeps;
+    double* previous_x = previous.data();
+    double* previous_y = previous_x + num_particles;
+    double* previous_z = previous_y + num_particles;
+    double* previous_vx = previous_z + num_particles;
+    double* previous_vy = previous_vx + num_particles;
+    double* previous_vz = previous_vy + num_particles;
+
+    for(int i = 1; i < num_particles; i++)
+    {
+        previous_x[i] = start.x[i];
+        previous_y[i] = start.y[i];
+        previous_z[i] = start.z[i];
+        previous_vx[i] = start.vx[i];
+        previous_vy[i] = start.vy[i];
+        previous_vz[i] = start.vz[i];
+        work.x[i] = start.x[i] + substep * start.vx[i];
+        work.y[i] = start.y[i] + substep * start.vy[i];
+        work.z[i] = start.z[i] + substep * start.vz[i];
+        work.vx[i] = start.vx[i] + substep * start_ax[i];
+        work.vy[i] = start.vy[i] + substep * start_ay[i];
+        work.vz[i] = start.vz[i] + substep * start_az[i];
+    }
+
+    for(int m = 1; m < num_substeps; m++)
+    {
+        UpdateWorkAccelerations(epsilon);
+        for(int i = 1; i < num_particles; i++)
+        {
+            double next_x = previous_x[i] + 2 * substep * work.vx[i];
+            double next_y = previous_y[i] + 2 * substep * work.vy[i];
+            double next_z = previous_z[i] + 2 * substep * work.vz[i];
+            double next_vx = previous_vx[i] + 2 * substep * work.ax[i];
+            double next_vy = previous_vy[i] + 2 * substep * work.ay[i];
+            double next_vz = previous_vz[i] + 2 * substep * work.az[i];
+            previous_x[i] = work.x[i];
+            previous_y[i] = work.y[i];
+            previous_z[i] = work.z[i];
+            previous_vx[i] = work.vx[i];
+            previous_vy[i] = work.vy[i];
+            previous_vz[i] = work.vz[i];
+            work.x[i] = next_x;
+            work.y[i] = next_y;
+            work.z[i] = next_z;
+            work.vx[i] = next_vx;
+            work.vy[i] = next_vy;
+            work.vz[i] = next_vz;
+        }
+    }
+
+    UpdateWorkAccelerations(epsilon);
+    for(int i = 1; i < num_particles; i++)
+    {
+        work.x[i] = 0.5 * (work.x[i] + previous_x[i] + substep * work.vx[i]);
+        work.y[i] = 0.5 * (work.y[i] + previous_y[i] + substep * work.vy[i]);
+        work.z[i] = 0.5 * (work.z[i] + previous_z[i] + substep * work.vz[i]);
+        work.vx[i] = 0.5 * (work.vx[i] + previous_vx[i] + substep * work.ax[i]);
+        work.vy[i] = 0.5 * (work.vy[i] + previous_vy[i] + substep * work.ay[i]);
+        work.vz[i] = 0.5 * (work.vz[i] + previous_vz[i] + substep * work.az[i]);
+    }
+}
+
+double BulirschStoerIntegrator::ErrorNorm() const
+{
+    const int num_particles = start.Size();
+    const std::vector<double>& best = table[0];
+    const std::vector<double>& second = table[1];
+    const std::vector<double>* initial[6] = {&start.x, &start.y, &start.z, &start.vx, &start.vy, &start.vz};
+    double error = 0.0;
+    for(int i = 1; i < num_particles; i++)
+    {
+        // the position and then the velocity
+        for(int part = 0; part < 2; part++)
+        {
+            double difference = 0.0;
+            double size_start = 0.0;
+            double size_end = 0.0;
+            for(int component = 3 * part; component < 3 * part + 3; component++)
+            {
+                const std::size_t value = std::size_t(component) * num_particles + i;
+                const double initial_value = (*initial[component])[i];
+                difference += (best[value] - second[value]) * (best[value] - second[value]);
+                size_start += initial_value * initial_value;
+                size_end += best[value] * best[value];
+            }
+            // absolute below a size of 1 and relative above, so a body at rest at the origin still has a scale
+            double scale = tolerance * (1.0 + std::sqrt(std::max(size_start, size_end)));
+            error = std::max(error, std::sqrt(difference) / scale);
+        }
+    }
+    return error;
+}
+
+void BulirschStoerIntegrator::Step(SolarSystem& system, double dt, float epsilon)
+{
+    ParticleStore& particles = system.GetParticleStore();
+    const int num_particles = particles.Size();
+    if (dt <= 0 || num_particles < 2)
+    {
+        return;
+    }
+
+    start = particles;
+    work = particles;
+    start_ax.resize(num_particles);
+    start_ay.resize(num_particles);
+    start_az.resize(num_particles);
+    previous.resize(6 * std::size_t(num_particles));
+    for(auto& row : table)
+    {
+        row.resize(6 * std::size_t(num_particles));
+    }
+
+    // the first step is a small fraction of the shortest r / v of the bodies
+    if (next_step <= 0)
+    {
+        next_step = dt;
+        for(int i = 1; i < num_particles; i++)
+        {
+            double distance = particles.GetPosition(i).norm();
+            double speed = particles.GetVelocity(i).norm();
+            if (speed > 0)
+            {
+                next_step = std::min(next_step, 0.01 * distance / speed);
+            }
+        }
+    }
+
+    std::vector<double> optimal_steps(max_columns);
+    std::vector<double> work_per_time(max_columns);
+
+    double remaining = dt;
+    while (remaining > 0)
+    {
+        // the last step ends on dt exactly
+        bool shortened = next_step >= remaining;
+        double h = shortened ? remaining : next_step;
+
+        SolarSystem::ComputeAccelerations(start, epsilon, start_ax.data(), start_ay.data(), start_az.data());
+        force_evaluations++;
+
+        while (true)
+        {
+            const int last_column = std::min(target_column + 1, max_columns - 1);
+            int converged_column = -1;
+            int column = 0;
+            for(; column <= last_column; column++)
+            {
+                ModifiedMidpoint(h, Substeps(column), epsilon);
+                std::vector<double>& row = table[column];
+                for(int i = 0; i < num_particles; i++)
+                {
+                    row[i] = work.x[i];
+                    row[num_particles + i] = work.y[i];
+                    row[2 * num_particles + i] = work.z[i];
+                    row[3 * num_particles + i] = work.vx[i];
+                    row[4 * num_particles + i] = work.vy[i];
+                    row[5 * num_particles + i] = work.vz[i];
+                }
+                if (column == 0)
+                {
+                    continue;
+                }
+
+                // Aitken-Neville extrapolation to h = 0 in powers of h^2
+                for(int k = column - 1; k >= 0; k--)
+                {
+                    double ratio = double(Substeps(column)) / Substeps(k);
+                    double factor = 1.0 / (ratio * ratio - 1.0);
+                    std::vector<double>& lower = table[k];
+                    const std::vector<double>& higher = table[k + 1];
+                    for(std::size_t value = 0; value < lower.size(); value++)
+                    {
+                        lower[value] = higher[value] + (higher[value] - lower[value]) * factor;
+                    }
+                }
+
+                // the error of the extrapolation of order 2 column + 2 is estimated from the one of order 2 column, which
+                // shrinks with h^(2 column + 1)
+                double error = ErrorNorm();
+                double change = std::isfinite(error) ? 0.94 * std::pow(0.65 / std::max(error, 1e-30), 1.0 / (2 * column + 1)) : 0.0;
+                optimal_steps[column] = h * std::min(std::max(change, 0.02), 4.0);
+                work_per_time[column] = ColumnWork(column) / optimal_steps[column];
+                if (error <= 1.0)
+                {
+                    converged_column = column;
+                    break;
+                }
+            }
+
+            if (converged_column < 0)
+            {
+                // rejected: retrying with the step the last column asks for, which is shorter
+                steps_rejected++;
+                h = std::min(optimal_steps[last_column], 0.5 * h);
+                shortened = false;
+                if (!(h > 1e-14 * dt))
+                {
+                    throw std::runtime_error("The Bulirsch-Stoer integrator could not meet the tolerance with any step.");
+                }
+                continue;
+            }
+
+            // accepted: the next number of columns and step length have the least work per unit of time
+            const int k = converged_column;
+            int next_column = k;
+            if (k > 1 && work_per_time[k - 1] < 0.8 * work_per_time[k])
+            {
+                next_column = k - 1;
+            }
+            else if (k == 1 || work_per_time[k] < 0.9 * work_per_time[k - 1])
+            {
+                next_column = std::min(k + 1, max_columns - 2);
+            }
+            double new_step = next_column == k - 1 ? optimal_steps[k - 1]
+                            : next_column > k ? optimal_steps[k] * ColumnWork(next_column) / ColumnWork(k)
+                            : optimal_steps[k];
+            target_column = std::max(1, next_column);
+
+            // a step cut short at the end of dt does not hold back the next one
+            next_step = shortened ? std::max(next_step, new_step) : new_step;
+            break;
+        }
+
+        const std::vector<double>& result = table[0];
+        for(int i = 1; i < num_particles; i++)
+        {
+            start.x[i] = result[i];
+            start.y[i] = result[num_particles + i];
+            start.z[i] = result[2 * num_particles + i];
+            start.vx[i] = result[3 * num_particles + i];
+            start.vy[i] = result[4 * num_particles + i];
+            start.vz[i] = result[5 * num_particles + i];
+        }
+        steps_taken++;
+        remaining -= h;
+    }
+
+    for(int i = 1; i < num_particles; i++)
+    {
+        particles.x[i] = start.x[i];
+        particles.y[i] = start.y[i];
+        particles.z[i] = start.z[i];
+        particles.vx[i] = start.vx[i];
+        particles.vy[i] = start.vy[i];
+        particles.vz[i] = start.vz[i];
+    }
+}
+
+std::string BulirschStoerIntegrator::GetName() const
+{
+    return "bs";
+}
+
+int BulirschStoerIntegrator::ForceEvaluationsPerStep() const
+{
+    return ColumnWork(max_columns - 1);
+}
+
+double BulirschStoerIntegrator::GetTolerance() const
+{
+    return tolerance;
+}
+
+long long BulirschStoerIntegrator::GetStepsTaken() const
+{
+    return steps_taken;
+}
+
+long long BulirschStoerIntegrator::GetStepsRejected() const
+{
+    return steps_rejected;
+}
+
+long long BulirschStoerIntegrator::GetForceEvaluations() const
+{
+    return force_evaluations;
+}
+
+double BulirschStoerIntegrator::GetNextStep() const
+{
+    return next_step;
+}
+
+// laid out as next_step, target_column, steps_taken, steps_rejected, force_evaluations
+std::vector<double> BulirschStoerIntegrator::GetState() const
+{
+    return {next_step, double(target_column), double(steps_taken), double(steps_rejected), double(force_evaluations)};
+}
+
+void BulirschStoerIntegrator::SetState(const std::vector<double>& state, const ParticleStore&)
+{
+    if (state.size() != 5)
+    {
+        throw std::logic_error("The state does not belong to a BulirschStoerIntegrator.");
+    }
+    next_step = state[0];
+    target_column = state[1];
+    steps_taken = state[2];
+    steps_rejected = state[3];
+    force_evaluations = state[4];
+}
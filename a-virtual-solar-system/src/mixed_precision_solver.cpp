@@ -0,0 +1,77 @@
+#include "force_solver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+MixedPrecisionSolver::MixedPrecisionSolver(int block_size) : block_size(block_size)
+{
+    if (block_size < 1)
+    {
+        throw std::logic_error("Block size of the mixed precision solver should be at least 1.");
+    }
+}
+
+int MixedPrecisionSolver::GetBlockSize() const
+{
+    return block_size;
+}
+
+// separations in double, float pair forces summed per block, and double sums over the blocks
+void MixedPrecisionSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const float eps_squared = epsilon * epsilon;
+
+    float_mass.assign(particles.mass.begin(), particles.mass.end());
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const float* mass = float_mass.data();
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_particles; i++)
+    {
+        const double x_i = x[i];
+        const double y_i = y[i];
+        const double z_i = z[i];
+
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        double sum_z = 0.0;
+
+        for(int block_begin = 0; block_begin < num_particles; block_begin += block_size)
+        {
+            const int block_end = std::min(block_begin + block_size, num_particles);
+            float block_x = 0.0f;
+            float block_y = 0.0f;
+            float block_z = 0.0f;
+
+            // the body itself is not skipped, so that the loop has no branch: its distance is zero, and a distance of 1
+            // instead of 0 keeps its zero contribution finite even without softening
+            #pragma omp simd reduction(+:block_x, block_y, block_z)
+            for(int j = block_begin; j < block_end; j++)
+            {
+                // subtracted in double, as a float position far from the origin would be off by more than a close separation
+                float dx = float(x[j] - x_i);
+                float dy = float(y[j] - y_i);
+                float dz = float(z[j] - z_i);
+                float dist_squared = dx*dx + dy*dy + dz*dz + eps_squared + (j == i ? 1.0f : 0.0f);
+                float factor = mass[j] / (dist_squared * std::sqrt(dist_squared));
+
+                block_x += factor * dx;
+                block_y += factor * dy;
+                block_z += factor * dz;
+            }
+
+            sum_x += block_x;
+            sum_y += block_y;
+            sum_z += block_z;
+        }
+
+        acc_x[i] = sum_x;
+        acc_y[i] = sum_y;
+        acc_z[i] = sum_z;
+    }
+}
@@ -0,0 +1,146 @@
+#include "octree.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// cells with at most leaf_size bodies are not split any further
+Octree::Octree(int leaf_size) : leaf_size(leaf_size)
+{
+    if (leaf_size < 1)
+    {
+        throw std::logic_error("Leaf size of an octree should be at least 1.");
+    }
+}
+
+// building the tree from scratch around the bounding cube of all bodies
+void Octree::Build(const ParticleStore& particles)
+{
+    const int num_particles = particles.Size();
+    nodes.clear();
+    order.resize(num_particles);
+    scratch.resize(num_particles);
+
+    if (num_particles == 0)
+    {
+        return;
+    }
+
+    double min[3] = {particles.x[0], particles.y[0], particles.z[0]};
+    double max[3] = {particles.x[0], particles.y[0], particles.z[0]};
+    for(int i = 1; i < num_particles; i++)
+    {
+        double pos[3] = {particles.x[i], particles.y[i], particles.z[i]};
+        for(int k = 0; k < 3; k++)
+        {
+            min[k] = std::min(min[k], pos[k]);
+            max[k] = std::max(max[k], pos[k]);
+        }
+    }
+
+    double centre[3];
+    double half_width = 0.0;
+    for(int k = 0; k < 3; k++)
+    {
+        centre[k] = 0.5 * (min[k] + max[k]);
+        half_width = std::max(half_width, 0.5 * (max[k] - min[k]));
+    }
+
+    for(int i = 0; i < num_particles; i++)
+    {
+        order[i] = i;
+    }
+
+    nodes.push_back(Node{-1, 0, 0, num_particles, 0});
+    BuildNode(particles, 0, centre, half_width);
+}
+
+// splitting the bodies of a cell into its eight octants with a counting sort
+void Octree::BuildNode(const ParticleStore& particles, int node_index, const double centre[3], double half_width)
+{
+    const int begin = nodes[node_index].begin;
+    const int end = nodes[node_index].end;
+    const int depth = nodes[node_index].depth;
+
+    if (end - begin <= leaf_size || depth >= max_depth)
+    {
+        return;
+    }
+
+    auto octant = [&](int i)
+    {
+        return (particles.x[i] > centre[0]) + 2 * (particles.y[i] > centre[1]) + 4 * (particles.z[i] > centre[2]);
+    };
+
+    int counts[8] = {0};
+    for(int n = begin; n < end; n++)
+    {
+        counts[octant(order[n])]++;
+    }
+
+    int offsets[9] = {begin};
+    for(int k = 0; k < 8; k++)
+    {
+        offsets[k + 1] = offsets[k] + counts[k];
+    }
+
+    int positions[8];
+    std::copy(offsets, offsets + 8, positions);
+    for(int n = begin; n < end; n++)
+    {
+        scratch[positions[octant(order[n])]++] = order[n];
+    }
+    std::copy(scratch.begin() + begin, scratch.begin() + end, order.begin() + begin);
+
+    // children of a cell are appended contiguously, so they always come after their parent
+    const int first_child = nodes.size();
+    int num_children = 0;
+    for(int k = 0; k < 8; k++)
+    {
+        if (counts[k] > 0)
+        {
+            nodes.push_back(Node{-1, 0, offsets[k], offsets[k + 1], depth + 1});
+            num_children++;
+        }
+    }
+    nodes[node_index].first_child = first_child;
+    nodes[node_index].num_children = num_children;
+
+    int child_index = first_child;
+    for(int k = 0; k < 8; k++)
+    {
+        if (counts[k] > 0)
+        {
+            double child_centre[3];
+            child_centre[0] = centre[0] + ((k & 1) ? 0.5 : -0.5) * half_width;
+            child_centre[1] = centre[1] + ((k & 2) ? 0.5 : -0.5) * half_width;
+            child_centre[2] = centre[2] + ((k & 4) ? 0.5 : -0.5) * half_width;
+            BuildNode(particles, child_index, child_centre, 0.5 * half_width);
+            child_index++;
+        }
+    }
+}
+
+int Octree::NumNodes() const
+{
+    return nodes.size();
+}
+
+int Octree::NumParticles() const
+{
+    return order.size();
+}
+
+bool Octree::IsLeaf(int node_index) const
+{
+    return nodes[node_index].num_children == 0;
+}
+
+const std::vector<Octree::Node>& Octree::GetNodes() const
+{
+    return nodes;
+}
+
+// indices of the bodies sorted so that every cell holds a contiguous range
+const std::vector<int>& Octree::GetOrder() const
+{
+    return order;
+}
@@ -0,0 +1,197 @@
+#include "p3m.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+// short-range share 1 - S(r) of the pull, for x = r / 2r_s
+static inline double ShortRangeFraction(double x)
+{
+    return std::erfc(x) + 2.0 * x / std::sqrt(M_PI) * std::exp(-x * x);
+}
+
+// the short-range share is tabulated against x^2 up to the cutoff, so the pair loop needs no erfc, exp or extra sqrt
+static const int table_size = 4096;
+static const double table_end = (P3mSolver::cutoff_radii / 2.0) * (P3mSolver::cutoff_radii / 2.0);
+
+P3mSolver::P3mSolver(int grid_size, double split_cells) : PmSolver(grid_size), split_cells(split_cells), split_radius(0.0)
+{
+    if (!(split_cells > 0.0))
+    {
+        throw std::logic_error("The split radius of the P3M solver should be positive.");
+    }
+    std::fill(chain_origin, chain_origin + 3, 0.0);
+    std::fill(chain_cell_size, chain_cell_size + 3, 0.0);
+    std::fill(chain_cells, chain_cells + 3, 0);
+
+    short_range_table.resize(table_size + 2);
+    for(int k = 0; k < table_size + 2; k++)
+    {
+        short_range_table[k] = ShortRangeFraction(std::sqrt(k * table_end / table_size));
+    }
+}
+
+double P3mSolver::GetSplitCells() const
+{
+    return split_cells;
+}
+
+void P3mSolver::SetSplitCells(double split_cells)
+{
+    if (!(split_cells > 0.0))
+    {
+        throw std::logic_error("The split radius of the P3M solver should be positive.");
+    }
+    this->split_cells = split_cells;
+    InvalidateKernels();
+}
+
+double P3mSolver::GetSplitRadius() const
+{
+    return split_radius;
+}
+
+double P3mSolver::GetCutoff() const
+{
+    return cutoff_radii * split_radius;
+}
+
+// called while the kernels are built, after the cell size of the evaluation is known
+double P3mSolver::MeshFraction(double r) const
+{
+    const double r_s = split_cells * GetCellSize();
+    const double x = r / (2.0 * r_s);
+    return 1.0 - ShortRangeFraction(x);
+}
+
+void P3mSolver::BuildChainingMesh(const ParticleStore& particles)
+{
+    const int num_particles = particles.Size();
+    const std::vector<double>* coordinates[3] = {&particles.x, &particles.y, &particles.z};
+    const double cutoff = GetCutoff();
+
+    // cells at least as wide as the cutoff, and no more cells than a few per body
+    double extent[3];
+    for(int axis = 0; axis < 3; axis++)
+    {
+        auto bounds = std::minmax_element(coordinates[axis]->begin(), coordinates[axis]->end());
+        chain_origin[axis] = *bounds.first;
+        extent[axis] = *bounds.second - *bounds.first;
+        chain_cells[axis] = std::max(1, int(std::min(extent[axis] / cutoff, 1024.0)));
+    }
+    while (double(chain_cells[0]) * chain_cells[1] * chain_cells[2] > 4.0 * num_particles + 64)
+    {
+        int* largest = std::max_element(chain_cells, chain_cells + 3);
+        *largest = std::max(1, *largest / 2);
+    }
+    for(int axis = 0; axis < 3; axis++)
+    {
+        chain_cell_size[axis] = extent[axis] > 0.0 ? extent[axis] / chain_cells[axis] : 1.0;
+    }
+
+    // counting sort of the bodies by cell
+    const int num_cells = chain_cells[0] * chain_cells[1] * chain_cells[2];
+    body_cell.resize(num_particles);
+    cell_start.assign(num_cells + 1, 0);
+
+    for(int p = 0; p < num_particles; p++)
+    {
+        int cell[3];
+        for(int axis = 0; axis < 3; axis++)
+        {
+            int c = int(((*coordinates[axis])[p] - chain_origin[axis]) / chain_cell_size[axis]);
+            cell[axis] = std::min(std::max(c, 0), chain_cells[axis] - 1);
+        }
+        body_cell[p] = (cell[0] * chain_cells[1] + cell[1]) * chain_cells[2] + cell[2];
+        cell_start[body_cell[p] + 1]++;
+    }
+    for(int c = 0; c < num_cells; c++)
+    {
+        cell_start[c + 1] += cell_start[c];
+    }
+
+    sorted.resize(num_particles);
+    std::vector<int> next(cell_start.begin(), cell_start.end() - 1);
+    for(int p = 0; p < num_particles; p++)
+    {
+        sorted[next[body_cell[p]]++] = p;
+    }
+}
+
+// every body sums the pairs around it on its own, in the order of the chaining mesh, so no two threads write to the same
+// body; the bodies are visited cell by cell, so neighbouring bodies share the cells they read
+void P3mSolver::AddShortRange(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z) const
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+    const double cutoff = GetCutoff();
+    const double cutoff_squared = cutoff * cutoff;
+    const double to_table = table_size / (4.0 * split_radius * split_radius * table_end);
+    const double* table = short_range_table.data();
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int s = 0; s < num_particles; s++)
+    {
+        const int i = sorted[s];
+        const int cell = body_cell[i];
+        const int c_x = cell / (chain_cells[1] * chain_cells[2]);
+        const int c_y = (cell / chain_cells[2]) % chain_cells[1];
+        const int c_z = cell % chain_cells[2];
+
+        double sum_x = 0.0;
+        double sum_y = 0.0;
+        double sum_z = 0.0;
+        for(int n_x = std::max(c_x - 1, 0); n_x <= std::min(c_x + 1, chain_cells[0] - 1); n_x++)
+        {
+            for(int n_y = std::max(c_y - 1, 0); n_y <= std::min(c_y + 1, chain_cells[1] - 1); n_y++)
+            {
+                for(int n_z = std::max(c_z - 1, 0); n_z <= std::min(c_z + 1, chain_cells[2] - 1); n_z++)
+                {
+                    const int neighbour = (n_x * chain_cells[1] + n_y) * chain_cells[2] + n_z;
+                    for(int t = cell_start[neighbour]; t < cell_start[neighbour + 1]; t++)
+                    {
+                        const int j = sorted[t];
+                        double dx = x[j] - x[i];
+                        double dy = y[j] - y[i];
+                        double dz = z[j] - z[i];
+                        double r_squared = dx*dx + dy*dy + dz*dz;
+                        if (j == i || r_squared >= cutoff_squared)
+                        {
+                            continue;
+                        }
+                        double position = r_squared * to_table;
+                        int k = int(position);
+                        double share = table[k] + (position - k) * (table[k + 1] - table[k]);
+                        double dist_squared = r_squared + eps_squared;
+                        double factor = mass[j] * share / (dist_squared * std::sqrt(dist_squared));
+                        sum_x += factor * dx;
+                        sum_y += factor * dy;
+                        sum_z += factor * dz;
+                    }
+                }
+            }
+        }
+        acc_x[i] += sum_x;
+        acc_y[i] += sum_y;
+        acc_z[i] += sum_z;
+    }
+}
+
+void P3mSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    if (particles.Size() == 0)
+    {
+        return;
+    }
+
+    // the mesh sets the long-range share, which fixes the cell size and so the split radius
+    PmSolver::ComputeAccelerations(particles, epsilon, acc_x, acc_y, acc_z);
+    split_radius = split_cells * GetCellSize();
+
+    BuildChainingMesh(particles);
+    AddShortRange(particles, epsilon, acc_x, acc_y, acc_z);
+}
@@ -1,9 +1,14 @@
 #include "particle.hpp"
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <omp.h>
 #include <random>
+#include <sstream>
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 // constructor of the particle
 Particle::Particle(double mass):mass(mass)
@@ -91,12 +96,12 @@ bool Particle::IsAccelerating()
     return true;
 }
 
-Eigen::Vector3d Particle::CalcAcceleration(Particle particle_i, Particle particle_j, float epsilon = 0.0)
+Eigen::Vector3d Particle::CalcAcceleration(const Particle& particle_i, const Particle& particle_j, float epsilon = 0.0)
 {
     Eigen::Vector3d acc_ji;
     auto mass_j = particle_j.GetMass();
-    auto x_j = particle_j.GetPosition();
-    auto x_i = particle_i.GetPosition();
+    const auto& x_j = particle_j.position;
+    const auto& x_i = particle_i.position;
     auto distance_ji = (x_i - x_j).norm();
 
     acc_ji = (mass_j * (x_j - x_i))/(pow (pow(distance_ji, 2) + pow(epsilon, 2), 1.5 ));
@@ -110,32 +115,17 @@ Eigen::Vector3d Particle::CalcAcceleration(Particle particle_i, Particle particl
 // to use this function, do the following:
 // Particle target_particle{<mass of the target particle>}
 // target_particle.CalculateTotalAcceleration(<particle_list>, <index of target_particle>, <epsilon>)
-Eigen::Vector3d Particle::CalculateTotalAcceleration(std::vector<Particle> particles, int target_index, float epsilon) 
+// a thin wrapper over the system-level direct summation for the single body target_index, reading the list in place
+// on the calling thread, so that calling it from a parallel loop over the bodies opens no nested parallel region
+Eigen::Vector3d Particle::CalculateTotalAcceleration(const std::vector<Particle>& particles, int target_index, float epsilon) 
 {   
-    // looping over all pairs of particles    
-    Eigen::Vector3d final_acc = {0.0, 0.0, 0.0};
-    auto target_particle = particles[target_index];
-
-    // help from: https://stackoverflow.com/questions/40495250/openmp-reduction-with-eigenvectorxd
-    #pragma omp declare reduction(Vector3dSum: Eigen::Vector3d: \
-    omp_out += omp_in) \
-    initializer(omp_priv = Eigen::Vector3d::Zero())
-
-    #pragma omp parallel for reduction(Vector3dSum:final_acc)
-    for(auto j = 0; j < particles.size(); j++) 
-    {   
-        if( j != target_index )
-        {   
-            final_acc += CalcAcceleration(particles[target_index], particles[j], epsilon);
-        }
-    }
-
+    Eigen::Vector3d final_acc = SolarSystem::ComputeAcceleration(particles, epsilon, target_index);
     SetAcceleration(final_acc);
     
     return final_acc;
 }
 
-double Particle::KineticEnergy()
+double Particle::KineticEnergy() const
 {   
     double ke;  
 
@@ -146,54 +136,53 @@ double Particle::KineticEnergy()
     return ke;
 }
 
-double Particle::PotentialEnergy(std::vector<Particle> particles, int target_index)
+// potential energy of the target particle, with each pair shared equally between its two bodies
+// so that summing over every particle (including the central star) gives the total potential energy
+double Particle::PotentialEnergy(const std::vector<Particle>& particles, int target_index) const
 {   
-    double summation_term = 0.;
-
-    #pragma omp parallel for schedule(static)
-    for(int j = 1; j < particles.size(); j++)
-    {   
-        if (j != target_index)
-        {
-            auto d_ij =  (particles[target_index].GetPosition() - particles[j].GetPosition()).norm();
-            auto mass_i = particles[target_index].GetMass();
-            auto mass_j = particles[j].GetMass();
-            summation_term += mass_i * mass_j / d_ij;
-        }
-    }
-
-    double total_pe = (-1/2) * summation_term;
-    return total_pe;
+    return SolarSystem::PotentialEnergy(particles, target_index);
 }
 
-double Particle::TotalEnergy(std::vector<Particle> particles, int target_index)
+double Particle::TotalEnergy(const std::vector<Particle>& particles, int target_index) const
 {
     double total_energy = KineticEnergy() + PotentialEnergy(particles, target_index);
     return total_energy;
 }
 
 // constructor for Solar System
-SolarSystem::SolarSystem(std::vector<Particle> particles)
+SolarSystem::SolarSystem(const std::vector<Particle>& particles)
 {
-    system = particles;
+    system = ParticleStore(particles);
+    force_solver = std::make_shared<PairwiseSolver>();
+    integrator = std::make_shared<EulerIntegrator>();
+    accelerations_current = false;
+    NewVersion();
+    schedule_kind = omp_sched_static;
+    schedule_chunk = 0;
+    trajectory_interval = 1;
+    checkpoint_interval = 1;
+    diagnostics_interval = 0;
+    potential_current = false;
+    telemetry_interval = 1;
+    telemetry_reference_set = false;
+    telemetry_step_seconds = 0.0;
+    telemetry_force_seconds = 0.0;
 }
 
 // getting the masses
 std::vector<double> SolarSystem::GetMasses()
 {   
-    for(int i = 0; i < system.size(); i++)
-    {
-        mass_list.push_back(system[i].GetMass());
-    }
+    mass_list = system.mass;
     return mass_list;
 }
 
 // getting the distances
 std::vector<double> SolarSystem::GetDistances()
 {
-    for(int i = 0; i < system.size(); i++)
+    distance_list.clear();
+    for(int i = 0; i < system.Size(); i++)
     {
-        distance_list.push_back(system[i].GetPosition().norm());
+        distance_list.push_back(system.GetPosition(i).norm());
     }
     return distance_list;
 }
@@ -204,6 +193,55 @@ std::vector<std::string> SolarSystem::GetNames()
     return bodies_list;
 }
 
+// choosing the force calculation backend
+void SolarSystem::SetForceSolver(std::shared_ptr<ForceSolver> solver)
+{
+    if (!solver)
+    {
+        throw std::logic_error("A SolarSystem needs a force solver.");
+    }
+    force_solver = solver;
+    accelerations_current = false;
+    NewVersion();
+}
+
+// choosing the time integration scheme
+void SolarSystem::SetIntegrator(std::shared_ptr<Integrator> new_integrator)
+{
+    if (!new_integrator)
+    {
+        throw std::logic_error("A SolarSystem needs an integrator.");
+    }
+    integrator = new_integrator;
+    integrator->Reset();
+    accelerations_current = false;
+    NewVersion();
+}
+
+// versions are handed out from one counter for all systems
+static std::atomic<unsigned long long> last_version(0);
+
+void SolarSystem::NewVersion()
+{
+    version = ++last_version;
+}
+
+unsigned long long SolarSystem::GetVersion() const
+{
+    return version;
+}
+
+int SolarSystem::NumParticles() const
+{
+    return system.Size();
+}
+
+// getting a copy of the body at the given index
+Particle SolarSystem::GetParticle(int index) const
+{
+    return system.GetParticle(index);
+}
+
 
 // initial condition generator
 std::vector<Particle> SolarSystemGenerator::GenerateInitialConditions(int num_planets)
@@ -270,57 +308,788 @@ std::vector<Particle> SolarSystemGenerator::GenerateInitialConditions(int num_pl
     return system_vector;
 }
 
+// positions and masses read from the arrays of a ParticleStore
+struct StoreBodies
+{
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* mass;
+
+    void Load(int j, double& x_j, double& y_j, double& z_j, double& mass_j) const
+    {
+        x_j = x[j];
+        y_j = y[j];
+        z_j = z[j];
+        mass_j = mass[j];
+    }
+};
+
+// the same read in place from a list of particles, so the per-particle members need no copy of the list
+struct ParticleListBodies
+{
+    const std::vector<Particle>& particles;
+
+    void Load(int j, double& x_j, double& y_j, double& z_j, double& mass_j) const
+    {
+        const Eigen::Vector3d position = particles[j].GetPosition();
+        x_j = position(0);
+        y_j = position(1);
+        z_j = position(2);
+        mass_j = particles[j].GetMass();
+    }
+};
+
+// evaluating the accelerations of all bodies in one pass over the read-only positions and masses
+// nothing is copied: every thread reads the same contiguous arrays and writes only its own entries of the output
+// acceleration of body i from all other bodies, summed in index order, and with with_potential set also the
+// potential -sum m_j / sqrt(r^2 + eps^2) of body i, from 1 / r = dist_squared * 1 / r^3 at one multiply-add per pair
+// shared by every direct summation of SolarSystem and of Particle, so they all agree to the last bit
+template<bool with_potential, typename Bodies>
+static inline void DirectSumOver(int i, int num_particles, const Bodies& bodies, double eps_squared,
+                                 double& acc_x, double& acc_y, double& acc_z, double* potential)
+{
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    double sum_z = 0.0;
+    double sum_potential = 0.0;
+
+    double x_i, y_i, z_i, mass_i;
+    bodies.Load(i, x_i, y_i, z_i, mass_i);
+
+    for(int j = 0; j < num_particles; j++)
+    {
+        if (j != i)
+        {
+            double x_j, y_j, z_j, mass_j;
+            bodies.Load(j, x_j, y_j, z_j, mass_j);
+            double dx = x_j - x_i;
+            double dy = y_j - y_i;
+            double dz = z_j - z_i;
+            double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+            double factor = mass_j / (dist_squared * std::sqrt(dist_squared));
+
+            sum_x += factor * dx;
+            sum_y += factor * dy;
+            sum_z += factor * dz;
+
+            if (with_potential)
+            {
+                sum_potential -= factor * dist_squared;
+            }
+        }
+    }
+
+    acc_x = sum_x;
+    acc_y = sum_y;
+    acc_z = sum_z;
+
+    if (with_potential)
+    {
+        *potential = sum_potential;
+    }
+}
+
+template<bool with_potential>
+static inline void DirectSum(int i, int num_particles, const double* x, const double* y, const double* z, const double* mass,
+                             double eps_squared, double& acc_x, double& acc_y, double& acc_z, double* potential)
+{
+    DirectSumOver<with_potential>(i, num_particles, StoreBodies {x, y, z, mass}, eps_squared, acc_x, acc_y, acc_z, potential);
+}
+
+static inline void DirectAcceleration(int i, int num_particles, const double* x, const double* y, const double* z, const double* mass,
+                                      double eps_squared, double& acc_x, double& acc_y, double& acc_z)
+{
+    DirectSum<false>(i, num_particles, x, y, z, mass, eps_squared, acc_x, acc_y, acc_z, nullptr);
+}
+
+void SolarSystem::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    RuntimeScheduledFor(num_particles, 0, num_particles, [=](int i)
+    {
+        DirectAcceleration(i, num_particles, x, y, z, mass, eps_squared, acc_x[i], acc_y[i], acc_z[i]);
+    });
+}
+
+// serial direct summation for the bodies [begin, end)
+void SolarSystem::ComputeAccelerations(const ParticleStore& particles, float epsilon, int begin, int end, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    for(int i = begin; i < end; i++)
+    {
+        DirectAcceleration(i, num_particles, particles.x.data(), particles.y.data(), particles.z.data(), particles.mass.data(),
+                           eps_squared, acc_x[i], acc_y[i], acc_z[i]);
+    }
+}
+
+// serial direct summation for one body of a list of particles
+Eigen::Vector3d SolarSystem::ComputeAcceleration(const std::vector<Particle>& particles, float epsilon, int index)
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    Eigen::Vector3d acceleration;
+    DirectSumOver<false>(index, particles.size(), ParticleListBodies {particles}, eps_squared,
+                         acceleration(0), acceleration(1), acceleration(2), nullptr);
+    return acceleration;
+}
+
+// accelerations and potentials in the same pass
+void SolarSystem::ComputeAccelerationsAndPotentials(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z, double* potential)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    RuntimeScheduledFor(num_particles, 0, num_particles, [=](int i)
+    {
+        DirectSum<true>(i, num_particles, x, y, z, mass, eps_squared, acc_x[i], acc_y[i], acc_z[i], potential + i);
+    });
+}
+
+// accelerations and jerks of the active bodies in one pass
+// with r = x_j - x_i, v = v_j - v_i and s^2 = r^2 + eps^2:
+// a_i = sum m_j r / s^3 and j_i = sum m_j (v / s^3 - 3 (r.v) r / s^5)
+void SolarSystem::ComputeAccelerationsAndJerks(const ParticleStore& particles, const std::vector<int>& active, float epsilon,
+                                               double* acc_x, double* acc_y, double* acc_z, double* jerk_x, double* jerk_y, double* jerk_z)
+{
+    const int num_particles = particles.Size();
+    const int num_active = active.size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* vx = particles.vx.data();
+    const double* vy = particles.vy.data();
+    const double* vz = particles.vz.data();
+    const double* mass = particles.mass.data();
+
+    ParallelFor(num_particles, 0, num_active, [&](int k)
+    {
+        const int i = active[k];
+        double sum_ax = 0.0, sum_ay = 0.0, sum_az = 0.0;
+        double sum_jx = 0.0, sum_jy = 0.0, sum_jz = 0.0;
+
+        for(int j = 0; j < num_particles; j++)
+        {
+            if (j != i)
+            {
+                double dx = x[j] - x[i];
+                double dy = y[j] - y[i];
+                double dz = z[j] - z[i];
+                double dvx = vx[j] - vx[i];
+                double dvy = vy[j] - vy[i];
+                double dvz = vz[j] - vz[i];
+
+                double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                double inv_dist_squared = 1.0 / dist_squared;
+                double factor = mass[j] * inv_dist_squared / std::sqrt(dist_squared);
+                double rv = 3.0 * (dx*dvx + dy*dvy + dz*dvz) * inv_dist_squared;
+
+                sum_ax += factor * dx;
+                sum_ay += factor * dy;
+                sum_az += factor * dz;
+                sum_jx += factor * (dvx - rv * dx);
+                sum_jy += factor * (dvy - rv * dy);
+                sum_jz += factor * (dvz - rv * dz);
+            }
+        }
+
+        acc_x[i] = sum_ax;
+        acc_y[i] = sum_ay;
+        acc_z[i] = sum_az;
+        jerk_x[i] = sum_jx;
+        jerk_y[i] = sum_jy;
+        jerk_z[i] = sum_jz;
+    });
+}
+
+// accelerations and jerks of all bodies, every pair visited once
+// the pull of j on i and its time derivative are both odd in (r, v), so j gets the opposite of what i gets
+void SolarSystem::ComputeAccelerationsAndJerks(const ParticleStore& particles, float epsilon, PairBuffers& buffers,
+                                               double* acc_x, double* acc_y, double* acc_z, double* jerk_x, double* jerk_y, double* jerk_z)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* vx = particles.vx.data();
+    const double* vy = particles.vy.data();
+    const double* vz = particles.vz.data();
+    const double* mass = particles.mass.data();
+
+    buffers.Reset(num_particles, 6);
+    const int num_blocks = buffers.NumBlocks();
+    double* outputs[6] = {acc_x, acc_y, acc_z, jerk_x, jerk_y, jerk_z};
+
+    auto accumulate_block = [&](int block)
+    {
+        double* buffer_ax = buffers.Buffer(block, 0);
+        double* buffer_ay = buffers.Buffer(block, 1);
+        double* buffer_az = buffers.Buffer(block, 2);
+        double* buffer_jx = buffers.Buffer(block, 3);
+        double* buffer_jy = buffers.Buffer(block, 4);
+        double* buffer_jz = buffers.Buffer(block, 5);
+
+        for(int i = buffers.RowBegin(block); i < buffers.RowBegin(block + 1); i++)
+        {
+            double sum_ax = 0.0, sum_ay = 0.0, sum_az = 0.0;
+            double sum_jx = 0.0, sum_jy = 0.0, sum_jz = 0.0;
+
+            const double x_i = x[i];
+            const double y_i = y[i];
+            const double z_i = z[i];
+            const double vx_i = i == 0 ? 0.0 : vx[i];
+            const double vy_i = i == 0 ? 0.0 : vy[i];
+            const double vz_i = i == 0 ? 0.0 : vz[i];
+            const double mass_i = mass[i];
+
+            for(int j = i + 1; j < num_particles; j++)
+            {
+                double dx = x[j] - x_i;
+                double dy = y[j] - y_i;
+                double dz = z[j] - z_i;
+                double dvx = vx[j] - vx_i;
+                double dvy = vy[j] - vy_i;
+                double dvz = vz[j] - vz_i;
+
+                double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                double inv_dist_squared = 1.0 / dist_squared;
+                double inv_dist_cubed = inv_dist_squared / std::sqrt(dist_squared);
+                double rv = 3.0 * (dx*dvx + dy*dvy + dz*dvz) * inv_dist_squared;
+
+                double pull_x = inv_dist_cubed * dx;
+                double pull_y = inv_dist_cubed * dy;
+                double pull_z = inv_dist_cubed * dz;
+                double change_x = inv_dist_cubed * (dvx - rv * dx);
+                double change_y = inv_dist_cubed * (dvy - rv * dy);
+                double change_z = inv_dist_cubed * (dvz - rv * dz);
+
+                sum_ax += mass[j] * pull_x;
+                sum_ay += mass[j] * pull_y;
+                sum_az += mass[j] * pull_z;
+                sum_jx += mass[j] * change_x;
+                sum_jy += mass[j] * change_y;
+                sum_jz += mass[j] * change_z;
+
+                buffer_ax[j] -= mass_i * pull_x;
+                buffer_ay[j] -= mass_i * pull_y;
+                buffer_az[j] -= mass_i * pull_z;
+                buffer_jx[j] -= mass_i * change_x;
+                buffer_jy[j] -= mass_i * change_y;
+                buffer_jz[j] -= mass_i * change_z;
+            }
+
+            buffer_ax[i] += sum_ax;
+            buffer_ay[i] += sum_ay;
+            buffer_az[i] += sum_az;
+            buffer_jx[i] += sum_jx;
+            buffer_jy[i] += sum_jy;
+            buffer_jz[i] += sum_jz;
+        }
+    };
+
+    // a single block, for systems below the serial threshold, is accumulated on the calling thread without any team
+    if (num_blocks == 1)
+    {
+        accumulate_block(0);
+        buffers.Reduce(outputs);
+    }
+    else
+    {
+        #pragma omp parallel num_threads(num_blocks)
+        {
+            // one block per thread, unless the runtime gave fewer threads than asked for
+            for(int block = omp_get_thread_num(); block < num_blocks; block += omp_get_num_threads())
+            {
+                accumulate_block(block);
+            }
+
+            buffers.Reduce(outputs);
+        }
+    }
+}
+
+// total kinetic energy of all bodies
+double SolarSystem::KineticEnergy(const ParticleStore& particles)
+{
+    double total_ke = 0.;
+
+    #pragma omp parallel for schedule(static) reduction(+:total_ke)
+    for(int i = 0; i < particles.Size(); i++)
+    {
+        double v_squared = particles.vx[i]*particles.vx[i] + particles.vy[i]*particles.vy[i] + particles.vz[i]*particles.vz[i];
+        total_ke += particles.mass[i] * v_squared / 2;
+    }
+    return total_ke;
+}
+
+// total gravitational potential energy, summed once over every pair of bodies
+double SolarSystem::PotentialEnergy(const ParticleStore& particles, float epsilon)
+{
+    double total_pe = 0.;
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:total_pe)
+    for(int i = 0; i < num_particles; i++)
+    {
+        for(int j = i + 1; j < num_particles; j++)
+        {
+            double dx = particles.x[j] - particles.x[i];
+            double dy = particles.y[j] - particles.y[i];
+            double dz = particles.z[j] - particles.z[i];
+            total_pe -= particles.mass[i] * particles.mass[j] / std::sqrt(dx*dx + dy*dy + dz*dz + eps_squared);
+        }
+    }
+    return total_pe;
+}
+
+// share of the bodies [begin, end) in the potential energy, from the potentials of the direct summation
+double SolarSystem::PotentialEnergy(const ParticleStore& particles, int begin, int end, float epsilon)
+{
+    const int num_particles = particles.Size();
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    double total_pe = 0.;
+    for(int i = begin; i < end; i++)
+    {
+        double acc_x, acc_y, acc_z, potential;
+        DirectSum<true>(i, num_particles, particles.x.data(), particles.y.data(), particles.z.data(), particles.mass.data(),
+                        eps_squared, acc_x, acc_y, acc_z, &potential);
+        total_pe += 0.5 * particles.mass[i] * potential;
+    }
+    return total_pe;
+}
+
+// share of one body of a list of particles in the potential energy
+double SolarSystem::PotentialEnergy(const std::vector<Particle>& particles, int index, float epsilon)
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    double acc_x, acc_y, acc_z, potential;
+    DirectSumOver<true>(index, particles.size(), ParticleListBodies {particles}, eps_squared, acc_x, acc_y, acc_z, &potential);
+    return 0.5 * particles[index].GetMass() * potential;
+}
+
+// calculating the accelerations of the bodies into the store, and the potential energy while diagnostics are on
+void SolarSystem::UpdateAccelerations(float epsilon)
+{
+    auto start_time = telemetry_monitor ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    if (diagnostics_interval > 0 || telemetry_monitor)
+    {
+        potential_energy = force_solver->ComputeAccelerationsAndPotential(system, epsilon, system.ax.data(), system.ay.data(), system.az.data());
+        potential_epsilon = epsilon;
+        potential_current = true;
+    }
+    else
+    {
+        force_solver->ComputeAccelerations(system, epsilon, system.ax.data(), system.ay.data(), system.az.data());
+        potential_current = false;
+    }
+    accelerations_current = true;
+    NewVersion();
+
+    if (telemetry_monitor)
+    {
+        telemetry_force_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+}
+
+bool SolarSystem::AccelerationsAreCurrent() const
+{
+    return accelerations_current;
+}
+
+void SolarSystem::MarkAccelerationsCurrent()
+{
+    accelerations_current = true;
+    potential_current = false;
+    NewVersion();
+}
+
+// moving every body except the central star with its current velocity for a time dt
+void SolarSystem::Drift(double dt)
+{
+    const int num_particles = system.Size();
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        system.x[i] += dt * system.vx[i];
+        system.y[i] += dt * system.vy[i];
+        system.z[i] += dt * system.vz[i];
+    });
+    accelerations_current = false;
+    NewVersion();
+}
+
+// changing the velocity of every body except the central star with its current acceleration for a time dt
+void SolarSystem::Kick(double dt)
+{
+    const int num_particles = system.Size();
+
+    ParallelFor(num_particles, 1, num_particles, [&](int i)
+    {
+        system.vx[i] += dt * system.ax[i];
+        system.vy[i] += dt * system.ay[i];
+        system.vz[i] += dt * system.az[i];
+    });
+    NewVersion();
+}
+
+// direct access to the bodies, the stored accelerations are assumed stale afterwards
+ParticleStore& SolarSystem::GetParticleStore()
+{
+    accelerations_current = false;
+    NewVersion();
+    return system;
+}
+
+const ParticleStore& SolarSystem::GetParticleStore() const
+{
+    return system;
+}
+
+// advancing the system by one timestep with the chosen integrator
+void SolarSystem::Step(double dt, float epsilon)
+{
+    // the direct summation loops use schedule(runtime), so the schedule of the system is set for the step
+    omp_sched_t previous_kind;
+    int previous_chunk;
+    omp_get_schedule(&previous_kind, &previous_chunk);
+    omp_set_schedule(schedule_kind, schedule_chunk);
+
+    integrator->Step(*this, dt, epsilon);
+
+    omp_set_schedule(previous_kind, previous_chunk);
+}
+
 // evolution of the solar system
-void SolarSystem::TimeEvolve(double final_time, double dt, float epsilon)
-{   
-    // outer while loop to loop over all timesteps
+void SolarSystem::SetTrajectoryWriter(std::shared_ptr<TrajectoryWriter> writer, int interval)
+{
+    if (interval < 1)
+    {
+        throw std::logic_error("Interval between trajectory frames should be at least 1 step.");
+    }
+    trajectory_writer = writer;
+    trajectory_interval = interval;
+}
 
-    for(double t = 0.0; t <= final_time; t+=dt)
-    {  
-        std::vector<Eigen::Vector3d> acceleration_list;
+void SolarSystem::RecordFrame(long long step, double time)
+{
+    if (trajectory_writer && step % trajectory_interval == 0)
+    {
+        trajectory_writer->Write(system, step, time);
+    }
+}
 
-        #pragma omp parallel for ordered
-        for(auto i = 1 ; i < system.size() ;i++)
-        #pragma omp ordered
-        {   
-            auto acc_planet = system[i].CalculateTotalAcceleration(system, i, epsilon);
-            acceleration_list.push_back(acc_planet);
+void SolarSystem::SetCheckpointWriter(std::shared_ptr<CheckpointWriter> writer, int interval)
+{
+    if (interval < 1)
+    {
+        throw std::logic_error("Interval between checkpoints should be at least 1 step.");
+    }
+    checkpoint_writer = writer;
+    checkpoint_interval = interval;
+}
+
+// sampling energy and momenta every interval steps of TimeEvolve and StepEvolve; 0 turns the diagnostics off
+void SolarSystem::SetDiagnosticsInterval(int interval)
+{
+    if (interval < 0)
+    {
+        throw std::logic_error("Interval between diagnostics should be equal or greater than 0 steps.");
+    }
+    diagnostics_interval = interval;
+    diagnostics_history.clear();
+}
+
+const std::vector<Diagnostics>& SolarSystem::GetDiagnosticsHistory() const
+{
+    return diagnostics_history;
+}
+
+void SolarSystem::RecordDiagnostics(long long step, float epsilon)
+{
+    if (diagnostics_interval > 0 && step % diagnostics_interval == 0)
+    {
+        diagnostics_history.push_back(GetDiagnostics(epsilon));
+    }
+}
+
+// the potential energy comes from the last force pass if it saw the current positions; otherwise a force pass is
+// made here, and integrators that reuse current accelerations take it over as the first force pass of their next step
+Diagnostics SolarSystem::GetDiagnostics(float epsilon)
+{
+    if (!(accelerations_current && potential_current && potential_epsilon == epsilon))
+    {
+        if (accelerations_current)
+        {
+            // leaving the accelerations of integrators that wrote their own alone
+            potential_energy = PotentialEnergy(system, epsilon);
+        }
+        else
+        {
+            // counted as force time of the step that will reuse these accelerations
+            auto start_time = std::chrono::steady_clock::now();
+            potential_energy = force_solver->ComputeAccelerationsAndPotential(system, epsilon, system.ax.data(), system.ay.data(), system.az.data());
+            accelerations_current = true;
+            NewVersion();
+            telemetry_force_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
         }
+        potential_epsilon = epsilon;
+        potential_current = true;
+    }
 
-        #pragma omp parallel for schedule(static)
-        for(auto i = 1 ; i < system.size();i++) 
-        {   
-            system[i].SetAcceleration(acceleration_list[i-1]);
-            system[i].Update(dt);
+    Diagnostics diagnostics;
+    diagnostics.kinetic_energy = 0.0;
+    diagnostics.momentum = Eigen::Vector3d::Zero();
+    diagnostics.angular_momentum = Eigen::Vector3d::Zero();
+    for(int i = 0; i < system.Size(); i++)
+    {
+        Eigen::Vector3d velocity = system.GetVelocity(i);
+        Eigen::Vector3d momentum = system.mass[i] * velocity;
+        diagnostics.kinetic_energy += 0.5 * momentum.dot(velocity);
+        diagnostics.momentum += momentum;
+        diagnostics.angular_momentum += system.GetPosition(i).cross(momentum);
+    }
+    diagnostics.potential_energy = potential_energy;
+    diagnostics.total_energy = diagnostics.kinetic_energy + potential_energy;
+    return diagnostics;
+}
+
+void SolarSystem::SetTelemetry(std::shared_ptr<TelemetryMonitor> monitor, int interval)
+{
+    if (interval < 1)
+    {
+        throw std::logic_error("Interval between telemetry records should be at least 1 step.");
+    }
+    telemetry_monitor = monitor;
+    telemetry_interval = interval;
+    telemetry_reference_set = false;
+    telemetry_step_seconds = 0.0;
+    telemetry_force_seconds = 0.0;
+}
+
+void SolarSystem::TimedStep(double dt, float epsilon)
+{
+    if (!telemetry_monitor)
+    {
+        Step(dt, epsilon);
+        return;
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    Step(dt, epsilon);
+    telemetry_step_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// the record is built on the simulation thread in O(N), everything else happens on the consumer thread of the monitor
+void SolarSystem::RecordTelemetry(long long step, double time, double dt, float epsilon)
+{
+    if (!telemetry_monitor || step % telemetry_interval != 0)
+    {
+        return;
+    }
+
+    // a force pass made by GetDiagnostics is reused by the next step, so its time goes into the next record
+    double force_seconds = telemetry_force_seconds;
+    Diagnostics diagnostics = GetDiagnostics(epsilon);
+    double carried_seconds = telemetry_force_seconds - force_seconds;
+    telemetry_force_seconds = force_seconds;
+
+    if (!telemetry_reference_set)
+    {
+        telemetry_reference = diagnostics;
+        telemetry_reference_set = true;
+    }
+
+    double max_acc_squared = 0.0;
+    for(int i = 1; i < system.Size(); i++)
+    {
+        max_acc_squared = std::max(max_acc_squared, system.ax[i]*system.ax[i] + system.ay[i]*system.ay[i] + system.az[i]*system.az[i]);
+    }
+
+    TelemetryRecord record;
+    record.step = step;
+    record.time = time;
+    record.dt = dt;
+    record.total_energy = diagnostics.total_energy;
+    record.energy_drift = (diagnostics.total_energy - telemetry_reference.total_energy) / std::abs(telemetry_reference.total_energy);
+    record.momentum_drift = (diagnostics.momentum - telemetry_reference.momentum).norm();
+    record.angular_momentum_drift = (diagnostics.angular_momentum - telemetry_reference.angular_momentum).norm();
+    record.max_acceleration = std::sqrt(max_acc_squared);
+    record.step_seconds = telemetry_step_seconds;
+    record.force_seconds = std::min(telemetry_force_seconds, telemetry_step_seconds);
+    record.update_seconds = telemetry_step_seconds - record.force_seconds;
+    telemetry_monitor->Push(record);
+
+    telemetry_step_seconds = carried_seconds;
+    telemetry_force_seconds = carried_seconds;
+}
+
+Checkpoint SolarSystem::GetCheckpoint(long long step, double time, double final_time, double dt, float epsilon) const
+{
+    Checkpoint checkpoint;
+    checkpoint.particles = system;
+    checkpoint.step = step;
+    checkpoint.time = time;
+    checkpoint.final_time = final_time;
+    checkpoint.dt = dt;
+    checkpoint.epsilon = epsilon;
+    checkpoint.num_threads = omp_get_max_threads();
+    checkpoint.integrator = integrator->GetName();
+    checkpoint.integrator_state = integrator->GetState();
+    checkpoint.accelerations_current = accelerations_current;
+    return checkpoint;
+}
+
+void SolarSystem::ResumeTimeEvolve(const Checkpoint& checkpoint)
+{
+    if (checkpoint.integrator != integrator->GetName())
+    {
+        throw std::logic_error("The checkpoint was taken with the " + checkpoint.integrator + " integrator, not " + integrator->GetName() + ".");
+    }
+    if (checkpoint.particles.Size() != system.Size())
+    {
+        throw std::logic_error("The checkpoint has a different number of bodies.");
+    }
+    system = checkpoint.particles;
+    accelerations_current = checkpoint.accelerations_current;
+    potential_current = false;
+    NewVersion();
+    integrator->SetState(checkpoint.integrator_state, system);
+    integrator->SetStateVersion(version);
+
+    EvolveFrom(checkpoint.step, checkpoint.time, checkpoint.final_time, checkpoint.dt, checkpoint.epsilon);
+}
+
+void SolarSystem::TimeEvolve(double final_time, double dt, float epsilon)
+{   
+    RecordFrame(0, 0.0);
+    RecordDiagnostics(0, epsilon);
+    RecordTelemetry(0, 0.0, dt, epsilon);
+    EvolveFrom(0, 0.0, final_time, dt, epsilon);
+}
+
+void SolarSystem::EvolveFrom(long long step, double time, double final_time, double dt, float epsilon)
+{
+    long long steps = step;
+
+    // outer loop to loop over all timesteps
+    for(double t = time; t <= final_time; t+=dt)
+    {  
+        TimedStep(dt, epsilon);
+        steps++;
+        RecordFrame(steps, t + dt);
+        RecordDiagnostics(steps, epsilon);
+        RecordTelemetry(steps, t + dt, dt, epsilon);
+        if (checkpoint_writer && steps % checkpoint_interval == 0)
+        {
+            checkpoint_writer->Write(GetCheckpoint(steps, t + dt, final_time, dt, epsilon));
         }
     }
 }
 
 void SolarSystem::StepEvolve(int num_steps, double dt, float epsilon)
 {
-    double t = 0.0;
     int steps = 0;
+    RecordFrame(steps, 0.0);
+    RecordDiagnostics(steps, epsilon);
+    RecordTelemetry(steps, 0.0, dt, epsilon);
 
     while (steps <= num_steps)
     {   
-        std::vector<Eigen::Vector3d> acceleration_list;
+        TimedStep(dt, epsilon);
+        steps++;
+        RecordFrame(steps, steps * dt);
+        RecordDiagnostics(steps, epsilon);
+        RecordTelemetry(steps, steps * dt, dt, epsilon);
+    }
+}
 
-        for(auto i = 1 ; i < system.size() ;i++)
-        {   
-            auto acc_planet = system[i].CalculateTotalAcceleration(system, i, epsilon);
-            acceleration_list.push_back(acc_planet);
-            std::cout << "acceleration calculated: " << acc_planet << std::endl;
-        }
+void SolarSystem::SetSchedule(omp_sched_t kind, int chunk_size)
+{
+    if (kind != omp_sched_static && kind != omp_sched_dynamic && kind != omp_sched_guided)
+    {
+        throw std::logic_error("The schedule should be omp_sched_static, omp_sched_dynamic or omp_sched_guided.");
+    }
+    if (chunk_size < 0)
+    {
+        throw std::logic_error("The chunk size of the schedule should be equal or greater than 0.");
+    }
+    schedule_kind = kind;
+    schedule_chunk = chunk_size;
+}
 
-        for(auto i = 1 ; i < system.size();i++) 
-        {   
-            std::cout << "From acc_list: " << acceleration_list[i-1] << std::endl;
+// kick-drift-kick leapfrog with the direct summation on the team of an ExecutionEngine
+void SolarSystem::EngineEvolve(const ExecutionEngine& engine, int num_steps, double dt, float epsilon)
+{
+    const int num_particles = system.Size();
+    const double half_dt = dt / 2;
+
+    double* x = system.x.data();
+    double* y = system.y.data();
+    double* z = system.z.data();
+    double* vx = system.vx.data();
+    double* vy = system.vy.data();
+    double* vz = system.vz.data();
+    double* acc_x = system.ax.data();
+    double* acc_y = system.ay.data();
+    double* acc_z = system.az.data();
+
+    if (!accelerations_current)
+    {
+        ComputeAccelerations(system, epsilon, acc_x, acc_y, acc_z);
+    }
 
-            system[i].SetAcceleration(acceleration_list[i]);
-            system[i].Update(dt);
+    // the central star stays fixed, so body 0 is skipped by the kicks and drifts
+    ExecutionEngine::Phase kick_drift = [=](int begin, int end)
+    {
+        for(int i = std::max(begin, 1); i < end; i++)
+        {
+            vx[i] += half_dt * acc_x[i];
+            vy[i] += half_dt * acc_y[i];
+            vz[i] += half_dt * acc_z[i];
+            x[i] += dt * vx[i];
+            y[i] += dt * vy[i];
+            z[i] += dt * vz[i];
         }
-        steps++;
-    }
+    };
+
+    // the forces need every position, so they only start after all drifts are done
+    const ParticleStore& particles = system;
+    ExecutionEngine::Phase force_kick = [=, &particles](int begin, int end)
+    {
+        ComputeAccelerations(particles, epsilon, begin, end, acc_x, acc_y, acc_z);
+        for(int i = std::max(begin, 1); i < end; i++)
+        {
+            vx[i] += half_dt * acc_x[i];
+            vy[i] += half_dt * acc_y[i];
+            vz[i] += half_dt * acc_z[i];
+        }
+    };
+
+    engine.Run(num_steps, num_particles, {kick_drift, force_kick});
+    accelerations_current = true;
+    potential_current = false;
+    NewVersion();
 }
 
 // used during debugging, not used in main.cpp
@@ -336,14 +1105,8 @@ void SolarSystem::EarthSunEvol(double final_time, double dt, float epsilon)
     Particle earth{GetMasses()[3]};
 
 
-    auto merc_pos = system[1].GetPosition();
-    auto merc_vel = system[1].GetVelocity();
-
-    auto venus_pos = system[2].GetPosition();
-    auto venus_vel = system[2].GetVelocity();
-
-    auto earth_pos = system[3].GetPosition();
-    auto earth_vel = system[3].GetVelocity();
+    auto earth_pos = system.GetPosition(3);
+    auto earth_vel = system.GetVelocity(3);
 
     std::cout << "Earth Initial position: " << earth_pos << std::endl;
 
@@ -353,11 +1116,11 @@ void SolarSystem::EarthSunEvol(double final_time, double dt, float epsilon)
     // setting velocity
     earth.SetVelocity( earth_vel );
 
-    mercury.SetPosition(system[1].GetPosition());
-    mercury.SetVelocity(system[1].GetVelocity());
+    mercury.SetPosition(system.GetPosition(1));
+    mercury.SetVelocity(system.GetVelocity(1));
 
-    venus.SetPosition(system[2].GetPosition());
-    venus.SetVelocity(system[2].GetVelocity());
+    venus.SetPosition(system.GetPosition(2));
+    venus.SetVelocity(system.GetVelocity(2));
 
     std::vector<Particle> se_system = {sun, mercury, venus, earth};
 
@@ -375,7 +1138,7 @@ void SolarSystem::EarthSunEvol(double final_time, double dt, float epsilon)
             acceleration_list.push_back(acc_planet);
         }
 
-        for(auto i = 1 ; i < system.size();i++) //system.size()
+        for(auto i = 1 ; i < se_system.size();i++)
         {   
             se_system[i].SetAcceleration(acceleration_list[i-1]);
             se_system[i].Update(dt);
@@ -394,11 +1157,10 @@ void SolarSystem::EarthSunEvol(double final_time, double dt, float epsilon)
 void SolarSystem::PrintPositions()
 {   
     std::cout << "Printing positions of the Solar System bodies: \n" << std::endl;
-    for (int i = 0; i <system.size(); i++) 
+    for (int i = 0; i <system.Size(); i++) 
     {
         auto name = GetNames()[i];
-        auto body = system[i];
-        auto euclidean_distance = body.GetPosition();
+        auto euclidean_distance = system.GetPosition(i);
 
         std::cout << name << ":\n"
                   << euclidean_distance << "\n" 
@@ -409,7 +1171,7 @@ void SolarSystem::PrintPositions()
 
 void SolarSystem::PrintEarthDetails()
 {
-    auto earth = system[3];
+    auto earth = system.GetParticle(3);
     auto euclidean_distance = earth.GetPosition();
     auto vel = earth.GetVelocity();
     std::cout << "Details for Earth:\n\n"
@@ -422,29 +1184,56 @@ void SolarSystem::PrintEarthDetails()
 
 double SolarSystem::TotalSystemEnergy()
 {
-    double total_system_energy = 0.;
-    for(int i = 1; i < system.size(); i++)
-    {
-        total_system_energy += system[i].TotalEnergy(system, i);
-    }
-    return total_system_energy;
+    return KineticEnergy(system) + PotentialEnergy(system);
 }
 
+// the potentials of all bodies come from one pass over the pairs, and the total is summed from the printed energies
 void SolarSystem::ShowEnergies()
 {
     std::cout << "Printing energies of the Solar System bodies: \n" << std::endl;
-    for (int i = 0; i <system.size(); i++) 
+    const int num_particles = system.Size();
+    std::vector<double> acc_x(num_particles), acc_y(num_particles), acc_z(num_particles), potentials(num_particles);
+    ComputeAccelerationsAndPotentials(system, 0.0, acc_x.data(), acc_y.data(), acc_z.data(), potentials.data());
+
+    double total_energy = 0.0;
+    for (int i = 0; i < num_particles; i++) 
     {
-        auto name = GetNames()[i];
-        auto body = system[i];
-        auto body_energy = body.TotalEnergy(system, i);
+        auto name = bodies_list[i];
+        double v_squared = system.vx[i]*system.vx[i] + system.vy[i]*system.vy[i] + system.vz[i]*system.vz[i];
+        double body_energy = system.mass[i] * v_squared / 2 + 0.5 * system.mass[i] * potentials[i];
+        total_energy += body_energy;
 
         std::cout << " Energy of " << name << ": " << body_energy << "\n" << std::endl;
     }
-    std::cout << "Total energy of the bodies in the solar system: " << TotalSystemEnergy() << std::endl;
+    std::cout << "Total energy of the bodies in the solar system: " << total_energy << std::endl;
 }
 
 // random initial generator described in 2.3 
+RandomInitialGenerator::RandomInitialGenerator() : engine(std::random_device{}())
+{
+}
+
+RandomInitialGenerator::RandomInitialGenerator(unsigned int seed) : engine(seed)
+{
+}
+
+std::string RandomInitialGenerator::GetState() const
+{
+    std::ostringstream state;
+    state << engine;
+    return state.str();
+}
+
+void RandomInitialGenerator::SetState(const std::string& state)
+{
+    std::istringstream input(state);
+    input >> engine;
+    if (input.fail())
+    {
+        throw std::logic_error("Invalid state of the random engine.");
+    }
+}
+
 std::vector<Particle> RandomInitialGenerator::GenerateInitialConditions(int num_planets)
 {   
     std::vector<Particle> final_system;
@@ -463,11 +1252,9 @@ std::vector<Particle> RandomInitialGenerator::GenerateInitialConditions(int num_
         // adding the mass of the planet
         double mass;
         
-        std::random_device rd_mass;
-        std::mt19937 gen_mass(rd_mass());
         std::uniform_real_distribution<> dis_mass(1./6000000, 1./1000);
     
-        mass = dis_mass(gen_mass);
+        mass = dis_mass(engine);
 
         Particle planet{mass};
 
@@ -477,18 +1264,14 @@ std::vector<Particle> RandomInitialGenerator::GenerateInitialConditions(int num_
         double theta;
 
         // angles \theta are random
-        std::random_device rd_angle;
-        std::mt19937 gen_angle(rd_angle());
         std::uniform_real_distribution<> dist_angle(0, 2 * M_PI);
-        theta = dist_angle(gen_angle);
+        theta = dist_angle(engine);
         
         // distance from sun r
         double r;
 
-        std::random_device rd_distance;
-        std::mt19937 gen_distance(rd_distance());
         std::uniform_real_distribution<> dist_distance(0.4, 30.);
-        r = dist_distance(gen_distance);
+        r = dist_distance(engine);
         
 
         // individual components of positions 
@@ -0,0 +1,107 @@
+#include "particle_store.hpp"
+#include "particle.hpp"
+#include <stdexcept>
+
+// building the store from a list of particles
+ParticleStore::ParticleStore(const std::vector<Particle>& particles)
+{
+    Resize(particles.size());
+    for(std::size_t i = 0; i < particles.size(); i++)
+    {
+        SetParticle(i, particles[i]);
+    }
+}
+
+int ParticleStore::Size() const
+{
+    return mass.size();
+}
+
+void ParticleStore::Resize(int num_particles)
+{
+    if (num_particles < 0)
+    {
+        throw std::logic_error("Number of particles in a ParticleStore should be equal or greater than 0.");
+    }
+
+    for(auto component : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass})
+    {
+        component->resize(num_particles, 0.0);
+    }
+}
+
+void ParticleStore::PushBack(const Particle& particle)
+{
+    Resize(Size() + 1);
+    SetParticle(Size() - 1, particle);
+}
+
+// materialising a Particle from the arrays at the given index
+Particle ParticleStore::GetParticle(int index) const
+{
+    Particle particle{mass[index]};
+    particle.SetPosition(GetPosition(index));
+    particle.SetVelocity(GetVelocity(index));
+    particle.SetAcceleration(GetAcceleration(index));
+    return particle;
+}
+
+void ParticleStore::SetParticle(int index, const Particle& particle)
+{
+    mass[index] = particle.GetMass();
+    SetPosition(index, particle.GetPosition());
+    SetVelocity(index, particle.GetVelocity());
+    SetAcceleration(index, particle.GetAcceleration());
+}
+
+std::vector<Particle> ParticleStore::ToParticles() const
+{
+    std::vector<Particle> particles;
+    particles.reserve(Size());
+    for(int i = 0; i < Size(); i++)
+    {
+        particles.push_back(GetParticle(i));
+    }
+    return particles;
+}
+
+double ParticleStore::GetMass(int index) const
+{
+    return mass[index];
+}
+
+Eigen::Vector3d ParticleStore::GetPosition(int index) const
+{
+    return Eigen::Vector3d {x[index], y[index], z[index]};
+}
+
+Eigen::Vector3d ParticleStore::GetVelocity(int index) const
+{
+    return Eigen::Vector3d {vx[index], vy[index], vz[index]};
+}
+
+Eigen::Vector3d ParticleStore::GetAcceleration(int index) const
+{
+    return Eigen::Vector3d {ax[index], ay[index], az[index]};
+}
+
+void ParticleStore::SetPosition(int index, const Eigen::Vector3d& pos)
+{
+    x[index] = pos[0];
+    y[index] = pos[1];
+    z[index] = pos[2];
+}
+
+void ParticleStore::SetVelocity(int index, const Eigen::Vector3d& vel)
+{
+    vx[index] = vel[0];
+    vy[index] = vel[1];
+    vz[index] = vel[2];
+}
+
+void ParticleStore::SetAcceleration(int index, const Eigen::Vector3d& acc)
+{
+    ax[index] = acc[0];
+    ay[index] = acc[1];
+    az[index] = acc[2];
+}
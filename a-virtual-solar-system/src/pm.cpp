@@ -0,0 +1,225 @@
+#include "pm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+// cloud-in-cell cell and weights of one coordinate: the value is shared between cell and cell + 1
+static inline void CloudInCell(double position, double origin, double cell_size, int num_cells, int& cell, double& weight_next)
+{
+    double f = (position - origin) / cell_size;
+    cell = std::min(std::max(int(std::floor(f)), 0), num_cells - 2);
+    weight_next = f - cell;
+}
+
+PmSolver::PmSolver(int grid_size) : grid_size(grid_size), cell_size(0.0), kernels_valid(false), kernel_cell_size(0.0), kernel_epsilon(0.0)
+{
+    if (grid_size < 4 || (grid_size & (grid_size - 1)) != 0)
+    {
+        throw std::logic_error("Grid size of the PM solver should be a power of 2 and at least 4.");
+    }
+    std::fill(padded, padded + 3, 0);
+    std::fill(kernel_padded, kernel_padded + 3, 0);
+}
+
+int PmSolver::GetGridSize() const
+{
+    return grid_size;
+}
+
+double PmSolver::GetCellSize() const
+{
+    return cell_size;
+}
+
+double PmSolver::MeshFraction(double) const
+{
+    return 1.0;
+}
+
+void PmSolver::InvalidateKernels()
+{
+    kernels_valid = false;
+}
+
+std::size_t PmSolver::Cell(int i, int j, int k) const
+{
+    return (std::size_t(i) * padded[1] + j) * padded[2] + k;
+}
+
+void PmSolver::SetUpGrid(const ParticleStore& particles)
+{
+    const std::vector<double>* coordinates[3] = {&particles.x, &particles.y, &particles.z};
+    double low[3];
+    double high[3];
+    double longest = 0.0;
+    for(int axis = 0; axis < 3; axis++)
+    {
+        auto bounds = std::minmax_element(coordinates[axis]->begin(), coordinates[axis]->end());
+        low[axis] = *bounds.first;
+        high[axis] = *bounds.second;
+        longest = std::max(longest, high[axis] - low[axis]);
+    }
+    if (longest == 0.0)
+    {
+        longest = 1.0;
+    }
+
+    // the bodies span at most grid_size - 1 cells along the longest side
+    cell_size = std::exp2(std::ceil(16.0 * std::log2(longest / (grid_size - 1))) / 16.0);
+
+    for(int axis = 0; axis < 3; axis++)
+    {
+        int needed = int(std::ceil((high[axis] - low[axis]) / cell_size)) + 1;
+        cells[axis] = 2;
+        while (cells[axis] < needed)
+        {
+            cells[axis] *= 2;
+        }
+        origin[axis] = 0.5 * (low[axis] + high[axis]) - 0.5 * cell_size * (cells[axis] - 1);
+
+        if (padded[axis] != 2 * cells[axis] || !ffts[axis])
+        {
+            padded[axis] = 2 * cells[axis];
+            ffts[axis] = std::make_unique<Fft>(padded[axis]);
+        }
+    }
+}
+
+// the kernel at the offsets between cells, wrapped around the padded grid, so that offsets of up to the size of
+// the occupied grid in either direction are all present
+void PmSolver::BuildKernels(float epsilon)
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+    const std::size_t num_cells = std::size_t(padded[0]) * padded[1] * padded[2];
+
+    for(int component = 0; component < 3; component++)
+    {
+        kernels[component].assign(num_cells, 0.0);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < padded[0]; i++)
+    {
+        const double u_x = cell_size * (i < cells[0] ? i : i - padded[0]);
+        for(int j = 0; j < padded[1]; j++)
+        {
+            const double u_y = cell_size * (j < cells[1] ? j : j - padded[1]);
+            for(int k = 0; k < padded[2]; k++)
+            {
+                const double u_z = cell_size * (k < cells[2] ? k : k - padded[2]);
+                const double r_squared = u_x*u_x + u_y*u_y + u_z*u_z;
+                if (r_squared == 0.0)
+                {
+                    continue;
+                }
+                const double dist_squared = r_squared + eps_squared;
+                const double factor = MeshFraction(std::sqrt(r_squared)) / (dist_squared * std::sqrt(dist_squared));
+
+                // pull towards a mass at offset -u
+                const std::size_t cell = Cell(i, j, k);
+                kernels[0][cell] = -factor * u_x;
+                kernels[1][cell] = -factor * u_y;
+                kernels[2][cell] = -factor * u_z;
+            }
+        }
+    }
+
+    for(int component = 0; component < 3; component++)
+    {
+        Fft3d(kernels[component], *ffts[0], *ffts[1], *ffts[2], false);
+    }
+
+    kernels_valid = true;
+    kernel_cell_size = cell_size;
+    kernel_epsilon = epsilon;
+    std::copy(padded, padded + 3, kernel_padded);
+}
+
+void PmSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    if (num_particles == 0)
+    {
+        return;
+    }
+
+    SetUpGrid(particles);
+    if (!kernels_valid || kernel_cell_size != cell_size || kernel_epsilon != epsilon || !std::equal(padded, padded + 3, kernel_padded))
+    {
+        BuildKernels(epsilon);
+    }
+
+    const std::size_t num_cells = std::size_t(padded[0]) * padded[1] * padded[2];
+    density.assign(num_cells, 0.0);
+    double* density_values = reinterpret_cast<double*>(density.data());
+
+    // mass assignment, the bodies of different threads may share cells
+    #pragma omp parallel for schedule(static)
+    for(int p = 0; p < num_particles; p++)
+    {
+        int i, j, k;
+        double w_x, w_y, w_z;
+        CloudInCell(particles.x[p], origin[0], cell_size, cells[0], i, w_x);
+        CloudInCell(particles.y[p], origin[1], cell_size, cells[1], j, w_y);
+        CloudInCell(particles.z[p], origin[2], cell_size, cells[2], k, w_z);
+
+        for(int a = 0; a < 2; a++)
+        {
+            for(int b = 0; b < 2; b++)
+            {
+                for(int c = 0; c < 2; c++)
+                {
+                    double weight = (a ? w_x : 1.0 - w_x) * (b ? w_y : 1.0 - w_y) * (c ? w_z : 1.0 - w_z);
+
+                    // the real part of the complex value
+                    #pragma omp atomic
+                    density_values[2 * Cell(i + a, j + b, k + c)] += particles.mass[p] * weight;
+                }
+            }
+        }
+    }
+
+    Fft3d(density, *ffts[0], *ffts[1], *ffts[2], false);
+
+    double* accelerations[3] = {acc_x, acc_y, acc_z};
+    const double normalisation = 1.0 / num_cells;
+
+    for(int component = 0; component < 3; component++)
+    {
+        field.resize(num_cells);
+
+        #pragma omp parallel for schedule(static)
+        for(std::size_t cell = 0; cell < num_cells; cell++)
+        {
+            field[cell] = density[cell] * kernels[component][cell];
+        }
+        Fft3d(field, *ffts[0], *ffts[1], *ffts[2], true);
+
+        double* acc = accelerations[component];
+
+        #pragma omp parallel for schedule(static)
+        for(int p = 0; p < num_particles; p++)
+        {
+            int i, j, k;
+            double w_x, w_y, w_z;
+            CloudInCell(particles.x[p], origin[0], cell_size, cells[0], i, w_x);
+            CloudInCell(particles.y[p], origin[1], cell_size, cells[1], j, w_y);
+            CloudInCell(particles.z[p], origin[2], cell_size, cells[2], k, w_z);
+
+            double sum = 0.0;
+            for(int a = 0; a < 2; a++)
+            {
+                for(int b = 0; b < 2; b++)
+                {
+                    for(int c = 0; c < 2; c++)
+                    {
+                        double weight = (a ? w_x : 1.0 - w_x) * (b ? w_y : 1.0 - w_y) * (c ? w_z : 1.0 - w_z);
+                        sum += weight * field[Cell(i + a, j + b, k + c)].real();
+                    }
+                }
+            }
+            acc[p] = sum * normalisation;
+        }
+    }
+}
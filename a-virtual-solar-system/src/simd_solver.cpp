@@ -0,0 +1,300 @@
+#include "force_solver.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <omp.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NBODY_X86_SIMD
+#endif
+
+// scalar reference for one body, also used for the tails left over by the vector loops
+static void AccumulateScalar(const ParticleStore& particles, int i, int j_begin, double eps_squared, double& sum_x, double& sum_y, double& sum_z)
+{
+    const int num_particles = particles.Size();
+    for(int j = j_begin; j < num_particles; j++)
+    {
+        if (j != i)
+        {
+            double dx = particles.x[j] - particles.x[i];
+            double dy = particles.y[j] - particles.y[i];
+            double dz = particles.z[j] - particles.z[i];
+            double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+            double factor = particles.mass[j] / (dist_squared * std::sqrt(dist_squared));
+
+            sum_x += factor * dx;
+            sum_y += factor * dy;
+            sum_z += factor * dz;
+        }
+    }
+}
+
+static void ScalarAccelerations(const ParticleStore& particles, double eps_squared, double* acc_x, double* acc_y, double* acc_z)
+{
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < particles.Size(); i++)
+    {
+        double sum_x = 0.0, sum_y = 0.0, sum_z = 0.0;
+        AccumulateScalar(particles, i, 0, eps_squared, sum_x, sum_y, sum_z);
+        acc_x[i] = sum_x;
+        acc_y[i] = sum_y;
+        acc_z[i] = sum_z;
+    }
+}
+
+#ifdef NBODY_X86_SIMD
+
+// in the vector loops the body i is not skipped: its own lane has dx = dy = dz = 0 and contributes nothing,
+// and when epsilon is zero the infinite 1/r^3 of that lane is masked out wherever r^2 = 0
+
+__attribute__((target("sse2")))
+static void Sse2Accelerations(const ParticleStore& particles, double eps_squared, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_particles; i++)
+    {
+        const __m128d x_i = _mm_set1_pd(x[i]);
+        const __m128d y_i = _mm_set1_pd(y[i]);
+        const __m128d z_i = _mm_set1_pd(z[i]);
+        const __m128d eps = _mm_set1_pd(eps_squared);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d three_halves = _mm_set1_pd(1.5);
+        __m128d sum_x = _mm_setzero_pd();
+        __m128d sum_y = _mm_setzero_pd();
+        __m128d sum_z = _mm_setzero_pd();
+
+        int j = 0;
+        for(; j + 2 <= num_particles; j += 2)
+        {
+            __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), x_i);
+            __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), y_i);
+            __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + j), z_i);
+            __m128d dist_squared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_add_pd(_mm_mul_pd(dz, dz), eps));
+
+            // 12-bit estimate of 1/r, then two Newton-Raphson steps y <- y (3/2 - r^2 y^2 / 2)
+            __m128d inv_dist = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(dist_squared)));
+            for(int iteration = 0; iteration < 2; iteration++)
+            {
+                __m128d half_r2_y2 = _mm_mul_pd(_mm_mul_pd(half, dist_squared), _mm_mul_pd(inv_dist, inv_dist));
+                inv_dist = _mm_mul_pd(inv_dist, _mm_sub_pd(three_halves, half_r2_y2));
+            }
+            inv_dist = _mm_and_pd(inv_dist, _mm_cmpgt_pd(dist_squared, _mm_setzero_pd()));
+
+            __m128d factor = _mm_mul_pd(_mm_loadu_pd(mass + j), _mm_mul_pd(inv_dist, _mm_mul_pd(inv_dist, inv_dist)));
+            sum_x = _mm_add_pd(sum_x, _mm_mul_pd(factor, dx));
+            sum_y = _mm_add_pd(sum_y, _mm_mul_pd(factor, dy));
+            sum_z = _mm_add_pd(sum_z, _mm_mul_pd(factor, dz));
+        }
+
+        double lanes_x[2], lanes_y[2], lanes_z[2];
+        _mm_storeu_pd(lanes_x, sum_x);
+        _mm_storeu_pd(lanes_y, sum_y);
+        _mm_storeu_pd(lanes_z, sum_z);
+        double total_x = lanes_x[0] + lanes_x[1];
+        double total_y = lanes_y[0] + lanes_y[1];
+        double total_z = lanes_z[0] + lanes_z[1];
+
+        AccumulateScalar(particles, i, j, eps_squared, total_x, total_y, total_z);
+        acc_x[i] = total_x;
+        acc_y[i] = total_y;
+        acc_z[i] = total_z;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void Avx2Accelerations(const ParticleStore& particles, double eps_squared, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_particles; i++)
+    {
+        const __m256d x_i = _mm256_set1_pd(x[i]);
+        const __m256d y_i = _mm256_set1_pd(y[i]);
+        const __m256d z_i = _mm256_set1_pd(z[i]);
+        const __m256d eps = _mm256_set1_pd(eps_squared);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d three_halves = _mm256_set1_pd(1.5);
+        __m256d sum_x = _mm256_setzero_pd();
+        __m256d sum_y = _mm256_setzero_pd();
+        __m256d sum_z = _mm256_setzero_pd();
+
+        int j = 0;
+        for(; j + 4 <= num_particles; j += 4)
+        {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), x_i);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), y_i);
+            __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + j), z_i);
+            __m256d dist_squared = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps)));
+
+            // 12-bit estimate of 1/r, then two Newton-Raphson steps y <- y (3/2 - r^2 y^2 / 2)
+            __m256d inv_dist = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(dist_squared)));
+            for(int iteration = 0; iteration < 2; iteration++)
+            {
+                __m256d half_r2_y2 = _mm256_mul_pd(_mm256_mul_pd(half, dist_squared), _mm256_mul_pd(inv_dist, inv_dist));
+                inv_dist = _mm256_mul_pd(inv_dist, _mm256_sub_pd(three_halves, half_r2_y2));
+            }
+            inv_dist = _mm256_and_pd(inv_dist, _mm256_cmp_pd(dist_squared, _mm256_setzero_pd(), _CMP_GT_OQ));
+
+            __m256d factor = _mm256_mul_pd(_mm256_loadu_pd(mass + j), _mm256_mul_pd(inv_dist, _mm256_mul_pd(inv_dist, inv_dist)));
+            sum_x = _mm256_fmadd_pd(factor, dx, sum_x);
+            sum_y = _mm256_fmadd_pd(factor, dy, sum_y);
+            sum_z = _mm256_fmadd_pd(factor, dz, sum_z);
+        }
+
+        double lanes_x[4], lanes_y[4], lanes_z[4];
+        _mm256_storeu_pd(lanes_x, sum_x);
+        _mm256_storeu_pd(lanes_y, sum_y);
+        _mm256_storeu_pd(lanes_z, sum_z);
+        double total_x = (lanes_x[0] + lanes_x[1]) + (lanes_x[2] + lanes_x[3]);
+        double total_y = (lanes_y[0] + lanes_y[1]) + (lanes_y[2] + lanes_y[3]);
+        double total_z = (lanes_z[0] + lanes_z[1]) + (lanes_z[2] + lanes_z[3]);
+
+        AccumulateScalar(particles, i, j, eps_squared, total_x, total_y, total_z);
+        acc_x[i] = total_x;
+        acc_y[i] = total_y;
+        acc_z[i] = total_z;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void Avx512Accelerations(const ParticleStore& particles, double eps_squared, double* acc_x, double* acc_y, double* acc_z)
+{
+    const int num_particles = particles.Size();
+    const double* x = particles.x.data();
+    const double* y = particles.y.data();
+    const double* z = particles.z.data();
+    const double* mass = particles.mass.data();
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_particles; i++)
+    {
+        const __m512d x_i = _mm512_set1_pd(x[i]);
+        const __m512d y_i = _mm512_set1_pd(y[i]);
+        const __m512d z_i = _mm512_set1_pd(z[i]);
+        const __m512d eps = _mm512_set1_pd(eps_squared);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512d three_halves = _mm512_set1_pd(1.5);
+        __m512d sum_x = _mm512_setzero_pd();
+        __m512d sum_y = _mm512_setzero_pd();
+        __m512d sum_z = _mm512_setzero_pd();
+
+        int j = 0;
+        for(; j + 8 <= num_particles; j += 8)
+        {
+            __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), x_i);
+            __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), y_i);
+            __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + j), z_i);
+            __m512d dist_squared = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps)));
+
+            // 14-bit estimate of 1/r, then two Newton-Raphson steps y <- y (3/2 - r^2 y^2 / 2)
+            __m512d inv_dist = _mm512_rsqrt14_pd(dist_squared);
+            for(int iteration = 0; iteration < 2; iteration++)
+            {
+                __m512d half_r2_y2 = _mm512_mul_pd(_mm512_mul_pd(half, dist_squared), _mm512_mul_pd(inv_dist, inv_dist));
+                inv_dist = _mm512_mul_pd(inv_dist, _mm512_sub_pd(three_halves, half_r2_y2));
+            }
+            __mmask8 nonzero = _mm512_cmp_pd_mask(dist_squared, _mm512_setzero_pd(), _CMP_GT_OQ);
+            inv_dist = _mm512_maskz_mov_pd(nonzero, inv_dist);
+
+            __m512d factor = _mm512_mul_pd(_mm512_loadu_pd(mass + j), _mm512_mul_pd(inv_dist, _mm512_mul_pd(inv_dist, inv_dist)));
+            sum_x = _mm512_fmadd_pd(factor, dx, sum_x);
+            sum_y = _mm512_fmadd_pd(factor, dy, sum_y);
+            sum_z = _mm512_fmadd_pd(factor, dz, sum_z);
+        }
+
+        double total_x = _mm512_reduce_add_pd(sum_x);
+        double total_y = _mm512_reduce_add_pd(sum_y);
+        double total_z = _mm512_reduce_add_pd(sum_z);
+
+        AccumulateScalar(particles, i, j, eps_squared, total_x, total_y, total_z);
+        acc_x[i] = total_x;
+        acc_y[i] = total_y;
+        acc_z[i] = total_z;
+    }
+}
+
+#endif
+
+// picking the widest instruction set supported by the CPU
+SimdSolver::SimdSolver() : instruction_set(BestInstructionSet())
+{
+}
+
+// forcing an instruction set, throws if the CPU does not support it
+SimdSolver::SimdSolver(InstructionSet instruction_set) : instruction_set(instruction_set)
+{
+    if (!IsSupported(instruction_set))
+    {
+        throw std::logic_error("The requested instruction set is not supported on this CPU.");
+    }
+}
+
+SimdSolver::InstructionSet SimdSolver::GetInstructionSet() const
+{
+    return instruction_set;
+}
+
+bool SimdSolver::IsSupported(InstructionSet instruction_set)
+{
+    switch (instruction_set)
+    {
+        case InstructionSet::Scalar:
+            return true;
+#ifdef NBODY_X86_SIMD
+        case InstructionSet::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case InstructionSet::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case InstructionSet::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+SimdSolver::InstructionSet SimdSolver::BestInstructionSet()
+{
+    for(auto instruction_set : {InstructionSet::AVX512, InstructionSet::AVX2, InstructionSet::SSE2})
+    {
+        if (IsSupported(instruction_set))
+        {
+            return instruction_set;
+        }
+    }
+    return InstructionSet::Scalar;
+}
+
+void SimdSolver::ComputeAccelerations(const ParticleStore& particles, float epsilon, double* acc_x, double* acc_y, double* acc_z)
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+
+    switch (instruction_set)
+    {
+#ifdef NBODY_X86_SIMD
+        case InstructionSet::AVX512:
+            Avx512Accelerations(particles, eps_squared, acc_x, acc_y, acc_z);
+            break;
+        case InstructionSet::AVX2:
+            Avx2Accelerations(particles, eps_squared, acc_x, acc_y, acc_z);
+            break;
+        case InstructionSet::SSE2:
+            Sse2Accelerations(particles, eps_squared, acc_x, acc_y, acc_z);
+            break;
+#endif
+        default:
+            ScalarAccelerations(particles, eps_squared, acc_x, acc_y, acc_z);
+            break;
+    }
+}
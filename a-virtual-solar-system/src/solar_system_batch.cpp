@@ -0,0 +1,221 @@
+#include "solar_system_batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// systems in one block of lanes; the positions, velocities, accelerations and masses of a block of 9 body systems take
+// about 45 KB, so a block stays in the cache while its forces are calculated
+static const int lanes_per_block = 64;
+
+SolarSystemBatch::SolarSystemBatch(const std::vector<std::vector<Particle>>& systems)
+{
+    if (systems.empty() || systems[0].empty())
+    {
+        throw std::logic_error("A SolarSystemBatch needs at least one system with at least one body.");
+    }
+    num_systems = systems.size();
+    num_bodies = systems[0].size();
+
+    for(const auto& system : systems)
+    {
+        if (system.size() != systems[0].size())
+        {
+            throw std::logic_error("Every system of a SolarSystemBatch should have the same number of bodies.");
+        }
+    }
+
+    for(auto values : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass})
+    {
+        values->resize(std::size_t(num_systems) * num_bodies);
+    }
+
+    for(int s = 0; s < num_systems; s++)
+    {
+        for(int i = 0; i < num_bodies; i++)
+        {
+            const Particle& particle = systems[s][i];
+            const int index = i * num_systems + s;
+            Eigen::Vector3d position = particle.GetPosition();
+            Eigen::Vector3d velocity = particle.GetVelocity();
+            Eigen::Vector3d acceleration = particle.GetAcceleration();
+            x[index] = position(0);
+            y[index] = position(1);
+            z[index] = position(2);
+            vx[index] = velocity(0);
+            vy[index] = velocity(1);
+            vz[index] = velocity(2);
+            ax[index] = acceleration(0);
+            ay[index] = acceleration(1);
+            az[index] = acceleration(2);
+            mass[index] = particle.GetMass();
+        }
+    }
+}
+
+int SolarSystemBatch::NumSystems() const
+{
+    return num_systems;
+}
+
+int SolarSystemBatch::NumBodies() const
+{
+    return num_bodies;
+}
+
+// the force loop of one block of lanes is compiled for SSE2, AVX2 and AVX-512, and the widest version the CPU supports
+// is picked when the program starts, so the pairs run over 2, 4 or 8 systems at once without any -march flag
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define NBODY_BATCH_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define NBODY_BATCH_CLONES
+#endif
+
+// every lane adds the pulls of the other bodies in the order of j, as the direct sum of SolarSystem does
+NBODY_BATCH_CLONES
+static void BlockAccelerations(int begin, int end, int num_systems, int num_bodies, const double* x, const double* y, const double* z,
+                               const double* mass, double eps_squared, double* ax, double* ay, double* az)
+{
+    // the central star does not move, so its acceleration is never needed
+    for(int i = 1; i < num_bodies; i++)
+    {
+        const double* x_i = x + i * num_systems;
+        const double* y_i = y + i * num_systems;
+        const double* z_i = z + i * num_systems;
+        double* acc_x = ax + i * num_systems;
+        double* acc_y = ay + i * num_systems;
+        double* acc_z = az + i * num_systems;
+
+        #pragma omp simd
+        for(int s = begin; s < end; s++)
+        {
+            acc_x[s] = 0.0;
+            acc_y[s] = 0.0;
+            acc_z[s] = 0.0;
+        }
+
+        for(int j = 0; j < num_bodies; j++)
+        {
+            if (j == i)
+            {
+                continue;
+            }
+            const double* x_j = x + j * num_systems;
+            const double* y_j = y + j * num_systems;
+            const double* z_j = z + j * num_systems;
+            const double* mass_j = mass + j * num_systems;
+
+            #pragma omp simd
+            for(int s = begin; s < end; s++)
+            {
+                double dx = x_j[s] - x_i[s];
+                double dy = y_j[s] - y_i[s];
+                double dz = z_j[s] - z_i[s];
+                double dist_squared = dx*dx + dy*dy + dz*dz + eps_squared;
+                double factor = mass_j[s] / (dist_squared * std::sqrt(dist_squared));
+
+                acc_x[s] += factor * dx;
+                acc_y[s] += factor * dy;
+                acc_z[s] += factor * dz;
+            }
+        }
+    }
+}
+
+void SolarSystemBatch::UpdateAccelerations(double eps_squared)
+{
+    const int num_blocks = (num_systems + lanes_per_block - 1) / lanes_per_block;
+
+    #pragma omp parallel for schedule(static) if(num_blocks > 1)
+    for(int block = 0; block < num_blocks; block++)
+    {
+        const int begin = block * lanes_per_block;
+        const int end = std::min(begin + lanes_per_block, num_systems);
+        BlockAccelerations(begin, end, num_systems, num_bodies, x.data(), y.data(), z.data(), mass.data(), eps_squared,
+                           ax.data(), ay.data(), az.data());
+    }
+}
+
+// acceleration at the old positions, then the drift and the kick of every body except the central star
+void SolarSystemBatch::Step(double dt, float epsilon)
+{
+    UpdateAccelerations(double(epsilon) * double(epsilon));
+
+    const int num_values = num_systems * num_bodies;
+
+    #pragma omp parallel for simd schedule(static) if(num_systems > lanes_per_block)
+    for(int index = num_systems; index < num_values; index++)
+    {
+        x[index] += dt * vx[index];
+        y[index] += dt * vy[index];
+        z[index] += dt * vz[index];
+        vx[index] += dt * ax[index];
+        vy[index] += dt * ay[index];
+        vz[index] += dt * az[index];
+    }
+}
+
+void SolarSystemBatch::TimeEvolve(double final_time, double dt, float epsilon)
+{
+    for(double t = 0.0; t <= final_time; t+=dt)
+    {
+        Step(dt, epsilon);
+    }
+}
+
+Particle SolarSystemBatch::GetParticle(int system, int index) const
+{
+    if (system < 0 || system >= num_systems || index < 0 || index >= num_bodies)
+    {
+        throw std::logic_error("There is no such system or body in the SolarSystemBatch.");
+    }
+    const int value = index * num_systems + system;
+    Particle particle{mass[value]};
+    particle.SetPosition(Eigen::Vector3d{x[value], y[value], z[value]});
+    particle.SetVelocity(Eigen::Vector3d{vx[value], vy[value], vz[value]});
+    particle.SetAcceleration(Eigen::Vector3d{ax[value], ay[value], az[value]});
+    return particle;
+}
+
+std::vector<Particle> SolarSystemBatch::GetSystem(int system) const
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i < num_bodies; i++)
+    {
+        particles.push_back(GetParticle(system, i));
+    }
+    return particles;
+}
+
+std::vector<double> SolarSystemBatch::TotalSystemEnergies(float epsilon) const
+{
+    const double eps_squared = double(epsilon) * double(epsilon);
+    std::vector<double> energies(num_systems);
+
+    #pragma omp parallel for schedule(static)
+    for(int s = 0; s < num_systems; s++)
+    {
+        double total_ke = 0.;
+        for(int i = 0; i < num_bodies; i++)
+        {
+            const int value = i * num_systems + s;
+            double v_squared = vx[value]*vx[value] + vy[value]*vy[value] + vz[value]*vz[value];
+            total_ke += mass[value] * v_squared / 2;
+        }
+
+        double total_pe = 0.;
+        for(int i = 0; i < num_bodies; i++)
+        {
+            for(int j = i + 1; j < num_bodies; j++)
+            {
+                const int value_i = i * num_systems + s;
+                const int value_j = j * num_systems + s;
+                double dx = x[value_j] - x[value_i];
+                double dy = y[value_j] - y[value_i];
+                double dz = z[value_j] - z[value_i];
+                total_pe -= mass[value_i] * mass[value_j] / std::sqrt(dx*dx + dy*dy + dz*dz + eps_squared);
+            }
+        }
+        energies[s] = total_ke + total_pe;
+    }
+    return energies;
+}
@@ -0,0 +1,220 @@
+#include "telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static const char telemetry_magic[8] = {'N', 'B', 'T', 'E', 'L', 'E', '0', '1'};
+
+// every value of a record after the step, in file order
+static const int values_per_record = 10;
+
+static void RecordValues(const TelemetryRecord& record, double* values)
+{
+    const double record_values[values_per_record] = {record.time, record.dt, record.total_energy, record.energy_drift, record.momentum_drift,
+                                                     record.angular_momentum_drift, record.max_acceleration, record.step_seconds,
+                                                     record.force_seconds, record.update_seconds};
+    std::copy(record_values, record_values + values_per_record, values);
+}
+
+TelemetryMonitor::TelemetryMonitor(const std::string& filename, Format format, std::size_t capacity)
+    : ring(capacity), file(nullptr), format(format), closing(false), num_dropped(0), closed(false), write_failed(false)
+{
+    if (capacity < 1)
+    {
+        throw std::logic_error("A telemetry ring buffer should hold at least 1 record.");
+    }
+
+    if (!filename.empty())
+    {
+        file = std::fopen(filename.c_str(), format == Format::Csv ? "w" : "wb");
+        if (!file)
+        {
+            throw std::runtime_error("Could not open the telemetry file " + filename);
+        }
+
+        bool header_written;
+        if (format == Format::Csv)
+        {
+            header_written = std::fputs("step,time,dt,total_energy,energy_drift,momentum_drift,angular_momentum_drift,"
+                                        "max_acceleration,step_seconds,force_seconds,update_seconds\n", file) >= 0;
+        }
+        else
+        {
+            header_written = std::fwrite(telemetry_magic, 1, 8, file) == 8;
+        }
+        if (!header_written)
+        {
+            std::fclose(file);
+            throw std::runtime_error("Could not write the header of the telemetry file " + filename);
+        }
+    }
+
+    summary = TelemetrySummary{0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    consumer = std::thread(&TelemetryMonitor::DrainLoop, this);
+}
+
+TelemetryMonitor::~TelemetryMonitor()
+{
+    try
+    {
+        Close();
+    }
+    catch(const std::exception&)
+    {
+    }
+}
+
+bool TelemetryMonitor::Push(const TelemetryRecord& record)
+{
+    if (closed)
+    {
+        throw std::logic_error("The telemetry monitor has already been closed.");
+    }
+    if (!ring.TryPush(record))
+    {
+        num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// polling the ring buffer, and sleeping briefly whenever it is empty
+void TelemetryMonitor::DrainLoop()
+{
+    TelemetryRecord record;
+    while (true)
+    {
+        // records pushed before Close are all in the buffer once closing is seen, so one more pass collects them
+        bool last_pass = closing.load(std::memory_order_acquire);
+
+        bool any = false;
+        while (ring.TryPop(record))
+        {
+            Consume(record);
+            any = true;
+        }
+
+        if (last_pass)
+        {
+            return;
+        }
+        if (!any)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void TelemetryMonitor::Consume(const TelemetryRecord& record)
+{
+    if (file && !write_failed)
+    {
+        double values[values_per_record];
+        RecordValues(record, values);
+
+        bool written;
+        if (format == Format::Csv)
+        {
+            written = std::fprintf(file, "%lld", static_cast<long long>(record.step)) > 0;
+            for(double value : values)
+            {
+                written = written && std::fprintf(file, ",%.17g", value) > 0;
+            }
+            written = written && std::fputc('\n', file) != EOF;
+        }
+        else
+        {
+            written = std::fwrite(&record.step, sizeof(std::int64_t), 1, file) == 1
+                      && std::fwrite(values, sizeof(double), values_per_record, file) == values_per_record;
+        }
+        write_failed = !written;
+    }
+
+    std::lock_guard<std::mutex> lock(summary_mutex);
+    summary.num_records++;
+    summary.max_energy_drift = std::max(summary.max_energy_drift, std::abs(record.energy_drift));
+    summary.final_energy_drift = record.energy_drift;
+    summary.max_acceleration = std::max(summary.max_acceleration, record.max_acceleration);
+    summary.step_seconds += record.step_seconds;
+    summary.force_seconds += record.force_seconds;
+    summary.update_seconds += record.update_seconds;
+}
+
+void TelemetryMonitor::Close()
+{
+    if (closed)
+    {
+        return;
+    }
+    closed = true;
+    closing.store(true, std::memory_order_release);
+    consumer.join();
+
+    bool failed = write_failed;
+    if (file)
+    {
+        failed = std::fclose(file) != 0 || failed;
+        file = nullptr;
+    }
+    if (failed)
+    {
+        throw std::runtime_error("Writing to the telemetry file failed.");
+    }
+}
+
+std::int64_t TelemetryMonitor::NumDropped() const
+{
+    return num_dropped.load(std::memory_order_relaxed);
+}
+
+TelemetrySummary TelemetryMonitor::GetSummary() const
+{
+    std::lock_guard<std::mutex> lock(summary_mutex);
+    return summary;
+}
+
+TelemetryMonitor::Format TelemetryMonitor::FormatFromFilename(const std::string& filename)
+{
+    const std::string extension = ".csv";
+    bool is_csv = filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+    return is_csv ? Format::Csv : Format::Binary;
+}
+
+std::vector<TelemetryRecord> TelemetryMonitor::ReadBinary(const std::string& filename)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file)
+    {
+        throw std::runtime_error("Could not open the telemetry file " + filename);
+    }
+
+    char magic[8];
+    if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, telemetry_magic, 8) != 0)
+    {
+        std::fclose(file);
+        throw std::runtime_error(filename + " is not a binary telemetry file.");
+    }
+
+    std::vector<TelemetryRecord> records;
+    TelemetryRecord record;
+    double values[values_per_record];
+    while (std::fread(&record.step, sizeof(std::int64_t), 1, file) == 1
+           && std::fread(values, sizeof(double), values_per_record, file) == values_per_record)
+    {
+        record.time = values[0];
+        record.dt = values[1];
+        record.total_energy = values[2];
+        record.energy_drift = values[3];
+        record.momentum_drift = values[4];
+        record.angular_momentum_drift = values[5];
+        record.max_acceleration = values[6];
+        record.step_seconds = values[7];
+        record.force_seconds = values[8];
+        record.update_seconds = values[9];
+        records.push_back(record);
+    }
+    std::fclose(file);
+    return records;
+}
@@ -0,0 +1,288 @@
+#include "trajectory.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char trajectory_magic[8] = {'N', 'B', 'T', 'R', 'A', 'J', '0', '1'};
+
+int TrajectoryWriter::BytesPerValue(Precision precision)
+{
+    return precision == Precision::Double ? 8 : 4;
+}
+
+// magic, bytes per value and number of bodies, then the masses
+std::size_t TrajectoryWriter::HeaderBytes(int num_particles)
+{
+    return 16 + 8 * std::size_t(num_particles);
+}
+
+// step and time, then x, y, z, vx, vy and vz
+std::size_t TrajectoryWriter::FrameBytes(int num_particles, Precision precision)
+{
+    return 16 + 6 * std::size_t(num_particles) * BytesPerValue(precision);
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& filename, const std::vector<double>& masses, Precision precision)
+    : num_particles(masses.size()), precision(precision), num_frames(0), back_pending(false), closing(false), write_failed(false)
+{
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error("Could not open the trajectory file " + filename);
+    }
+
+    std::int32_t header[2] = {BytesPerValue(precision), num_particles};
+    bool header_written = std::fwrite(trajectory_magic, 1, 8, file) == 8 && std::fwrite(header, sizeof(std::int32_t), 2, file) == 2
+                          && std::fwrite(masses.data(), sizeof(double), masses.size(), file) == masses.size();
+    if (!header_written)
+    {
+        std::fclose(file);
+        throw std::runtime_error("Could not write the header of the trajectory file " + filename);
+    }
+
+    front_buffer.resize(FrameBytes(num_particles, precision));
+    back_buffer.resize(FrameBytes(num_particles, precision));
+    io_thread = std::thread(&TrajectoryWriter::WriteLoop, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    try
+    {
+        Close();
+    }
+    catch(const std::exception&)
+    {
+    }
+}
+
+// copying the frame into the front buffer and handing it over to the I/O thread
+void TrajectoryWriter::Write(const ParticleStore& particles, std::int64_t step, double time)
+{
+    if (particles.Size() != num_particles)
+    {
+        throw std::logic_error("The number of bodies does not match the trajectory file.");
+    }
+    if (closing)
+    {
+        throw std::logic_error("The trajectory file has already been closed.");
+    }
+
+    char* frame = front_buffer.data();
+    std::memcpy(frame, &step, 8);
+    std::memcpy(frame + 8, &time, 8);
+    frame += 16;
+
+    for(const std::vector<double>* component : {&particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz})
+    {
+        if (precision == Precision::Double)
+        {
+            std::memcpy(frame, component->data(), 8 * std::size_t(num_particles));
+            frame += 8 * std::size_t(num_particles);
+        }
+        else
+        {
+            float* values = reinterpret_cast<float*>(frame);
+            for(int i = 0; i < num_particles; i++)
+            {
+                float value = (*component)[i];
+                std::memcpy(values + i, &value, 4);
+            }
+            frame += 4 * std::size_t(num_particles);
+        }
+    }
+
+    // waiting only if the I/O thread has not finished the previous frame yet
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]{ return !back_pending; });
+    if (write_failed)
+    {
+        throw std::runtime_error("Writing to the trajectory file failed.");
+    }
+    std::swap(front_buffer, back_buffer);
+    back_pending = true;
+    num_frames++;
+    condition.notify_all();
+}
+
+void TrajectoryWriter::WriteLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        condition.wait(lock, [this]{ return back_pending || closing; });
+        if (!back_pending)
+        {
+            return;
+        }
+
+        // the caller never touches the back buffer while it is pending, so it is written without holding the lock
+        lock.unlock();
+        bool written = std::fwrite(back_buffer.data(), 1, back_buffer.size(), file) == back_buffer.size();
+        lock.lock();
+
+        write_failed = write_failed || !written;
+        back_pending = false;
+        condition.notify_all();
+    }
+}
+
+void TrajectoryWriter::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing)
+        {
+            return;
+        }
+        closing = true;
+    }
+    condition.notify_all();
+    io_thread.join();
+
+    bool closed = std::fclose(file) == 0;
+    if (write_failed || !closed)
+    {
+        throw std::runtime_error("Writing to the trajectory file failed.");
+    }
+}
+
+std::int64_t TrajectoryWriter::NumFrames() const
+{
+    return num_frames;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open the trajectory file " + filename);
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 || file_status.st_size < 16)
+    {
+        close(fd);
+        throw std::runtime_error(filename + " is not a trajectory file");
+    }
+    size = file_status.st_size;
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map the trajectory file " + filename);
+    }
+    data = static_cast<const char*>(mapping);
+
+    std::int32_t header[2];
+    std::memcpy(header, data + 8, 8);
+    num_particles = header[1];
+    bool valid = std::memcmp(data, trajectory_magic, 8) == 0 && (header[0] == 4 || header[0] == 8) && num_particles >= 0
+                 && size >= TrajectoryWriter::HeaderBytes(num_particles);
+    if (!valid)
+    {
+        munmap(const_cast<char*>(data), size);
+        throw std::runtime_error(filename + " is not a trajectory file");
+    }
+    precision = header[0] == 8 ? TrajectoryWriter::Precision::Double : TrajectoryWriter::Precision::Float;
+
+    // a frame cut off by a crash while writing is not counted
+    num_frames = (size - TrajectoryWriter::HeaderBytes(num_particles)) / TrajectoryWriter::FrameBytes(num_particles, precision);
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    munmap(const_cast<char*>(data), size);
+}
+
+int TrajectoryReader::NumParticles() const
+{
+    return num_particles;
+}
+
+std::int64_t TrajectoryReader::NumFrames() const
+{
+    return num_frames;
+}
+
+TrajectoryWriter::Precision TrajectoryReader::GetPrecision() const
+{
+    return precision;
+}
+
+std::vector<double> TrajectoryReader::GetMasses() const
+{
+    std::vector<double> masses(num_particles);
+    std::memcpy(masses.data(), data + 16, 8 * std::size_t(num_particles));
+    return masses;
+}
+
+const char* TrajectoryReader::FrameData(std::int64_t frame) const
+{
+    if (frame < 0 || frame >= num_frames)
+    {
+        throw std::logic_error("Frame " + std::to_string(frame) + " is not in the trajectory file.");
+    }
+    return data + TrajectoryWriter::HeaderBytes(num_particles) + frame * TrajectoryWriter::FrameBytes(num_particles, precision);
+}
+
+std::int64_t TrajectoryReader::GetStep(std::int64_t frame) const
+{
+    std::int64_t step;
+    std::memcpy(&step, FrameData(frame), 8);
+    return step;
+}
+
+double TrajectoryReader::GetTime(std::int64_t frame) const
+{
+    double time;
+    std::memcpy(&time, FrameData(frame) + 8, 8);
+    return time;
+}
+
+double TrajectoryReader::Value(std::int64_t frame, int component, int index) const
+{
+    const int bytes = TrajectoryWriter::BytesPerValue(precision);
+    const char* value = FrameData(frame) + 16 + (std::size_t(component) * num_particles + index) * bytes;
+    if (precision == TrajectoryWriter::Precision::Double)
+    {
+        double result;
+        std::memcpy(&result, value, 8);
+        return result;
+    }
+    float result;
+    std::memcpy(&result, value, 4);
+    return result;
+}
+
+Eigen::Vector3d TrajectoryReader::GetPosition(std::int64_t frame, int index) const
+{
+    return Eigen::Vector3d {Value(frame, 0, index), Value(frame, 1, index), Value(frame, 2, index)};
+}
+
+Eigen::Vector3d TrajectoryReader::GetVelocity(std::int64_t frame, int index) const
+{
+    return Eigen::Vector3d {Value(frame, 3, index), Value(frame, 4, index), Value(frame, 5, index)};
+}
+
+ParticleStore TrajectoryReader::GetFrame(std::int64_t frame) const
+{
+    ParticleStore particles;
+    particles.Resize(num_particles);
+    particles.mass = GetMasses();
+
+    int component = 0;
+    for(std::vector<double>* values : {&particles.x, &particles.y, &particles.z, &particles.vx, &particles.vy, &particles.vz})
+    {
+        for(int i = 0; i < num_particles; i++)
+        {
+            (*values)[i] = Value(frame, component, i);
+        }
+        component++;
+    }
+    return particles;
+}
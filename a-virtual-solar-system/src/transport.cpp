@@ -0,0 +1,263 @@
+#include "transport.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void Transport::SendReceive(int dest, const void* send_data, std::size_t send_bytes, int source, void* receive_data, std::size_t receive_bytes)
+{
+    if (Rank() % 2 == 0)
+    {
+        Send(dest, send_data, send_bytes);
+        Receive(source, receive_data, receive_bytes);
+    }
+    else
+    {
+        Receive(source, receive_data, receive_bytes);
+        Send(dest, send_data, send_bytes);
+    }
+}
+
+// ring all-gather
+void Transport::AllGather(const std::vector<int>& offsets, const std::vector<double*>& components)
+{
+    const int num_ranks = Size();
+    const int rank = Rank();
+    const int right = (rank + 1) % num_ranks;
+    const int left = (rank + num_ranks - 1) % num_ranks;
+
+    std::vector<double> send_buffer;
+    std::vector<double> receive_buffer;
+
+    // in shift s, every rank passes on the block it received in the previous shift (its own block first)
+    for(int shift = 0; shift < num_ranks - 1; shift++)
+    {
+        const int send_block = (rank - shift + num_ranks) % num_ranks;
+        const int receive_block = (rank - shift - 1 + 2 * num_ranks) % num_ranks;
+        const int send_size = offsets[send_block + 1] - offsets[send_block];
+        const int receive_size = offsets[receive_block + 1] - offsets[receive_block];
+
+        send_buffer.resize(send_size * components.size());
+        receive_buffer.resize(receive_size * components.size());
+        for(std::size_t c = 0; c < components.size(); c++)
+        {
+            std::copy(components[c] + offsets[send_block], components[c] + offsets[send_block + 1], send_buffer.begin() + c * send_size);
+        }
+
+        SendReceive(right, send_buffer.data(), send_buffer.size() * sizeof(double), left, receive_buffer.data(), receive_buffer.size() * sizeof(double));
+
+        for(std::size_t c = 0; c < components.size(); c++)
+        {
+            std::copy(receive_buffer.begin() + c * receive_size, receive_buffer.begin() + (c + 1) * receive_size, components[c] + offsets[receive_block]);
+        }
+    }
+}
+
+std::vector<int> Transport::Partition(int num_items, int num_ranks)
+{
+    if (num_ranks < 1)
+    {
+        throw std::logic_error("Number of ranks should be at least 1.");
+    }
+    std::vector<int> offsets(num_ranks + 1);
+    for(int r = 0; r <= num_ranks; r++)
+    {
+        offsets[r] = (long long)num_items * r / num_ranks;
+    }
+    return offsets;
+}
+
+int SerialTransport::Rank() const
+{
+    return 0;
+}
+
+int SerialTransport::Size() const
+{
+    return 1;
+}
+
+void SerialTransport::Send(int, const void*, std::size_t)
+{
+    throw std::logic_error("A SerialTransport has no other ranks to send to.");
+}
+
+void SerialTransport::Receive(int, void*, std::size_t)
+{
+    throw std::logic_error("A SerialTransport has no other ranks to receive from.");
+}
+
+std::shared_ptr<SocketTransport> SocketTransport::Fork(int num_ranks)
+{
+    if (num_ranks < 1)
+    {
+        throw std::logic_error("Number of ranks should be at least 1.");
+    }
+
+    // one socket pair for every pair of ranks, sockets[r][s] is the end of rank r connected to rank s
+    std::vector<std::vector<int>> sockets(num_ranks, std::vector<int>(num_ranks, -1));
+    for(int r = 0; r < num_ranks; r++)
+    {
+        for(int s = r + 1; s < num_ranks; s++)
+        {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            {
+                throw std::runtime_error("Could not create a socket pair: " + std::string(std::strerror(errno)));
+            }
+            sockets[r][s] = pair[0];
+            sockets[s][r] = pair[1];
+        }
+    }
+
+    // buffered output would otherwise be printed again by every child
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    std::vector<pid_t> children;
+    int rank = 0;
+    for(int r = 1; r < num_ranks; r++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            throw std::runtime_error("Could not fork rank " + std::to_string(r) + ": " + std::string(std::strerror(errno)));
+        }
+        if (pid == 0)
+        {
+            rank = r;
+            children.clear();
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    // every process only keeps the sockets of its own rank
+    for(int r = 0; r < num_ranks; r++)
+    {
+        for(int s = 0; s < num_ranks; s++)
+        {
+            if (r != rank && sockets[r][s] >= 0)
+            {
+                close(sockets[r][s]);
+            }
+        }
+    }
+    return std::shared_ptr<SocketTransport>(new SocketTransport(rank, num_ranks, sockets[rank], children));
+}
+
+SocketTransport::SocketTransport(int rank, int num_ranks, const std::vector<int>& sockets, const std::vector<pid_t>& children)
+    : rank(rank), num_ranks(num_ranks), sockets(sockets), children(children), finished(false)
+{
+}
+
+SocketTransport::~SocketTransport()
+{
+    // a child process unwinding from an exception reports the failure to rank 0
+    if (rank != 0 && !finished && std::uncaught_exceptions() > 0)
+    {
+        _exit(1);
+    }
+
+    try
+    {
+        Finish();
+    }
+    catch(const std::exception& err)
+    {
+        std::cerr << err.what() << std::endl;
+    }
+}
+
+int SocketTransport::Rank() const
+{
+    return rank;
+}
+
+int SocketTransport::Size() const
+{
+    return num_ranks;
+}
+
+void SocketTransport::Send(int dest, const void* data, std::size_t bytes)
+{
+    const char* buffer = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t sent = send(sockets[dest], buffer, bytes, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("Rank " + std::to_string(rank) + " could not send to rank " + std::to_string(dest) + ": " + std::string(std::strerror(errno)));
+        }
+        buffer += sent;
+        bytes -= sent;
+    }
+}
+
+void SocketTransport::Receive(int source, void* data, std::size_t bytes)
+{
+    char* buffer = static_cast<char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t received = recv(sockets[source], buffer, bytes, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            throw std::runtime_error("Rank " + std::to_string(rank) + " could not receive from rank " + std::to_string(source));
+        }
+        buffer += received;
+        bytes -= received;
+    }
+}
+
+void SocketTransport::Finish()
+{
+    if (finished)
+    {
+        return;
+    }
+    finished = true;
+
+    for(int socket : sockets)
+    {
+        if (socket >= 0)
+        {
+            close(socket);
+        }
+    }
+
+    // child processes end here without running any destructors or exit handlers of the parent's state
+    if (rank != 0)
+    {
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(0);
+    }
+
+    bool all_succeeded = true;
+    for(pid_t child : children)
+    {
+        int status;
+        waitpid(child, &status, 0);
+        all_succeeded = all_succeeded && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    if (!all_succeeded)
+    {
+        throw std::runtime_error("A rank of the SocketTransport did not finish successfully.");
+    }
+}
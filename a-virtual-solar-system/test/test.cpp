@@ -1,8 +1,21 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include "particle.hpp"
+#include "fixed_solar_system.hpp"
+#include "ensemble.hpp"
+#include "solar_system_batch.hpp"
+#include "pm.hpp"
+#include "p3m.hpp"
+#include "barnes_hut.hpp"
+#include "fmm.hpp"
+#include "distributed.hpp"
 #include <algorithm>
+#include <fstream>
+#include <functional>
+#include <numeric>
 #include <math.h>
+#include <omp.h>
+#include <Eigen/Geometry>
 
 // documentation for floating point matchers: 
 // https://github.com/catchorg/Catch2/blob/devel/docs/matchers.md
@@ -501,4 +514,1456 @@ TEST_CASE( "SolarSystem class does not generate different polar angles in differ
     REQUIRE_THAT(mercury_position_3.norm(), WithinAbs(mercury_position_4.norm(), margin));
 }
 
-// 
\ No newline at end of file
+// 
+
+// testing the structure-of-arrays ParticleStore
+
+TEST_CASE( "ParticleStore does not store particles correctly", "[particle_store]" )
+{
+    Particle p1{2.5};
+    p1.SetPosition(Eigen::Vector3d {1.0, 2.0, 3.0});
+    p1.SetVelocity(Eigen::Vector3d {4.0, 5.0, 6.0});
+    p1.SetAcceleration(Eigen::Vector3d {7.0, 8.0, 9.0});
+
+    Particle p2{0.5};
+    p2.SetPosition(Eigen::Vector3d {-1.0, -2.0, -3.0});
+
+    ParticleStore store({p1, p2});
+    REQUIRE(store.Size() == 2);
+
+    // components are laid out contiguously per array
+    REQUIRE(store.x[0] == 1.0);
+    REQUIRE(store.x[1] == -1.0);
+    REQUIRE(store.vy[0] == 5.0);
+    REQUIRE(store.az[0] == 9.0);
+    REQUIRE(store.mass[1] == 0.5);
+
+    // particles materialised from the store are the same as the ones put in
+    auto p1_copy = store.GetParticle(0);
+    REQUIRE(p1_copy.GetMass() == p1.GetMass());
+    REQUIRE(p1_copy.GetPosition() == p1.GetPosition());
+    REQUIRE(p1_copy.GetVelocity() == p1.GetVelocity());
+    REQUIRE(p1_copy.GetAcceleration() == p1.GetAcceleration());
+
+    store.PushBack(p1);
+    REQUIRE(store.Size() == 3);
+    REQUIRE(store.GetPosition(2) == p1.GetPosition());
+
+    store.SetVelocity(1, Eigen::Vector3d {0.1, 0.2, 0.3});
+    REQUIRE(store.ToParticles()[1].GetVelocity() == Eigen::Vector3d {0.1, 0.2, 0.3});
+
+    REQUIRE_THROWS_AS( store.Resize(-1), std::logic_error);
+}
+
+// the SoA evolution of SolarSystem gives the same result as evolving Particle objects one by one
+TEST_CASE( "SolarSystem evolution does not match the evolution of individual particles", "[SS_store_evolution]" )
+{
+    double dt = 0.001;
+    float epsilon = 0.001;
+    int num_steps = 100;
+
+    SolarSystemGenerator ssgen;
+    auto particles = ssgen.GenerateInitialConditions();
+    SolarSystem solar_system(particles);
+
+    for(int step = 0; step <= num_steps; step++)
+    {
+        std::vector<Eigen::Vector3d> acceleration_list;
+        for(int i = 1; i < particles.size(); i++)
+        {
+            acceleration_list.push_back(particles[i].CalculateTotalAcceleration(particles, i, epsilon));
+        }
+        for(int i = 1; i < particles.size(); i++)
+        {
+            particles[i].SetAcceleration(acceleration_list[i-1]);
+            particles[i].Update(dt);
+        }
+    }
+    solar_system.StepEvolve(num_steps, dt, epsilon);
+
+    REQUIRE(solar_system.NumParticles() == particles.size());
+    for(int i = 0; i < particles.size(); i++)
+    {
+        REQUIRE(solar_system.GetParticle(i).GetPosition().isApprox(particles[i].GetPosition(), 1e-10));
+        REQUIRE(solar_system.GetParticle(i).GetVelocity().isApprox(particles[i].GetVelocity(), 1e-10));
+    }
+}
+
+// the system-level force API agrees with the per-particle CalculateTotalAcceleration and PotentialEnergy to the last bit,
+// as they share the same direct summation
+TEST_CASE( "SolarSystem::ComputeAccelerations does not agree with Particle::CalculateTotalAcceleration", "[SS_compute_accelerations]" )
+{
+    float epsilon = 0.01;
+
+    RandomInitialGenerator randgen;
+    auto particles = randgen.GenerateInitialConditions(32);
+    ParticleStore store(particles);
+
+    std::vector<double> acc_x(store.Size()), acc_y(store.Size()), acc_z(store.Size());
+    SolarSystem::ComputeAccelerations(store, epsilon, acc_x.data(), acc_y.data(), acc_z.data());
+
+    for(int i = 0; i < particles.size(); i++)
+    {
+        auto expected_acc = particles[i].CalculateTotalAcceleration(particles, i, epsilon);
+        REQUIRE(Eigen::Vector3d(acc_x[i], acc_y[i], acc_z[i]) == expected_acc);
+        REQUIRE(particles[i].PotentialEnergy(particles, i) == SolarSystem::PotentialEnergy(store, i, i + 1));
+    }
+}
+
+// energies calculated by hand for a planet on a circular orbit around a star
+TEST_CASE( "SolarSystem energies are calculated incorrectly", "[SS_energy]" )
+{
+    Particle star{1.};
+    Particle planet{0.001};
+    planet.SetPosition(Eigen::Vector3d {2., 0., 0.});
+    planet.SetVelocity(Eigen::Vector3d {0., 3., 0.});
+
+    std::vector<Particle> particles = {star, planet};
+    SolarSystem system(particles);
+
+    // kinetic energy m v^2 / 2 and potential energy -m_1 m_2 / r
+    double expected_ke = 0.001 * 9. / 2.;
+    double expected_pe = -0.001 / 2.;
+
+    REQUIRE_THAT( SolarSystem::KineticEnergy(ParticleStore(particles)), WithinRel(expected_ke, 1e-12) );
+    REQUIRE_THAT( SolarSystem::PotentialEnergy(ParticleStore(particles)), WithinRel(expected_pe, 1e-12) );
+    REQUIRE_THAT( system.TotalSystemEnergy(), WithinRel(expected_ke + expected_pe, 1e-12) );
+
+    // the pair potential is shared equally between the two bodies
+    REQUIRE_THAT( particles[0].PotentialEnergy(particles, 0), WithinRel(expected_pe / 2, 1e-12) );
+    REQUIRE_THAT( particles[1].TotalEnergy(particles, 1), WithinRel(expected_ke + expected_pe / 2, 1e-12) );
+}
+
+// the symmetric pairwise kernel gives the same accelerations as the direct sum, serial and in parallel
+TEST_CASE( "PairwiseSolver does not agree with the direct summation", "[pairwise_solver]" )
+{
+    float epsilon = 0.001;
+
+    RandomInitialGenerator randgen;
+    ParticleStore store(randgen.GenerateInitialConditions(200));
+    int n = store.Size();
+
+    std::vector<double> direct_x(n), direct_y(n), direct_z(n);
+    DirectSumSolver direct;
+    direct.ComputeAccelerations(store, epsilon, direct_x.data(), direct_y.data(), direct_z.data());
+
+    int default_threads = omp_get_max_threads();
+    for(int num_threads : {1, 4})
+    {
+        omp_set_num_threads(num_threads);
+
+        std::vector<double> pair_x(n), pair_y(n), pair_z(n);
+        PairwiseSolver pairwise;
+        pairwise.ComputeAccelerations(store, epsilon, pair_x.data(), pair_y.data(), pair_z.data());
+
+        for(int i = 0; i < n; i++)
+        {
+            Eigen::Vector3d expected_acc = {direct_x[i], direct_y[i], direct_z[i]};
+            REQUIRE(Eigen::Vector3d(pair_x[i], pair_y[i], pair_z[i]).isApprox(expected_acc, 1e-9));
+        }
+
+        // the same bits on every evaluation with the same number of threads
+        double pe = pairwise.ComputeAccelerationsAndPotential(store, epsilon, pair_x.data(), pair_y.data(), pair_z.data());
+        for(int repeat = 0; repeat < 10; repeat++)
+        {
+            std::vector<double> again_x(n), again_y(n), again_z(n);
+            REQUIRE( pairwise.ComputeAccelerationsAndPotential(store, epsilon, again_x.data(), again_y.data(), again_z.data()) == pe );
+            REQUIRE( again_x == pair_x );
+            REQUIRE( again_y == pair_y );
+            REQUIRE( again_z == pair_z );
+        }
+    }
+
+    // below the serial threshold a pass is a single block on the calling thread, the same bits on any number of threads
+    ParticleStore small_store(randgen.GenerateInitialConditions(100));
+    int small_n = small_store.Size();
+    REQUIRE( small_n < ExecutionEngine::default_serial_threshold );
+    std::vector<std::vector<double>> small_x;
+    std::vector<double> small_pe;
+    for(int num_threads : {1, 4})
+    {
+        omp_set_num_threads(num_threads);
+
+        std::vector<double> pair_x(small_n), pair_y(small_n), pair_z(small_n);
+        PairwiseSolver pairwise;
+        small_pe.push_back(pairwise.ComputeAccelerationsAndPotential(small_store, epsilon, pair_x.data(), pair_y.data(), pair_z.data()));
+        small_x.push_back(pair_x);
+    }
+    REQUIRE( small_x[0] == small_x[1] );
+    REQUIRE( small_pe[0] == small_pe[1] );
+    omp_set_num_threads(default_threads);
+
+    // a SolarSystem refuses to run without a solver
+    SolarSystem system(store.ToParticles());
+    REQUIRE_THROWS_AS( system.SetForceSolver(nullptr), std::logic_error);
+}
+
+// every instruction set available on this CPU gives the direct summation result
+TEST_CASE( "SimdSolver does not agree with the direct summation", "[simd_solver]" )
+{
+    RandomInitialGenerator randgen;
+    // an odd number of bodies so that the vector loops leave a scalar tail
+    ParticleStore store(randgen.GenerateInitialConditions(100));
+    int n = store.Size();
+
+    for(float epsilon : {0.0f, 0.01f})
+    {
+        std::vector<double> direct_x(n), direct_y(n), direct_z(n);
+        DirectSumSolver direct;
+        direct.ComputeAccelerations(store, epsilon, direct_x.data(), direct_y.data(), direct_z.data());
+
+        for(auto instruction_set : {SimdSolver::InstructionSet::Scalar, SimdSolver::InstructionSet::SSE2,
+                                    SimdSolver::InstructionSet::AVX2, SimdSolver::InstructionSet::AVX512})
+        {
+            if (!SimdSolver::IsSupported(instruction_set))
+            {
+                continue;
+            }
+
+            std::vector<double> simd_x(n), simd_y(n), simd_z(n);
+            SimdSolver simd(instruction_set);
+            simd.ComputeAccelerations(store, epsilon, simd_x.data(), simd_y.data(), simd_z.data());
+
+            for(int i = 0; i < n; i++)
+            {
+                Eigen::Vector3d expected_acc = {direct_x[i], direct_y[i], direct_z[i]};
+                REQUIRE(Eigen::Vector3d(simd_x[i], simd_y[i], simd_z[i]).isApprox(expected_acc, 1e-10));
+            }
+        }
+    }
+
+    REQUIRE(SimdSolver::IsSupported(SimdSolver().GetInstructionSet()));
+}
+
+// mixed precision solver
+
+// single precision pair forces summed in double stay within float accuracy of the direct summation, also without softening,
+// and a run with them conserves the energy as well as the double precision run
+TEST_CASE( "MixedPrecisionSolver does not approximate the direct summation", "[mixed_precision]" )
+{
+    RandomInitialGenerator randgen(3);
+    auto particles = randgen.GenerateInitialConditions(1000);
+    ParticleStore store(particles);
+
+    for(float epsilon : {0.0f, 0.01f})
+    {
+        for(int block_size : {1, 64, 256, 5000})
+        {
+            MixedPrecisionSolver mixed(block_size);
+            auto comparison = ForceSolver::CompareWithDirectSum(mixed, store, epsilon, store.Size());
+            REQUIRE(comparison.max_relative_error < 1e-4);
+            REQUIRE(comparison.rms_relative_error < 1e-5);
+        }
+    }
+
+    std::vector<double> energy_errors;
+    for(auto solver : std::vector<std::shared_ptr<ForceSolver>> {std::make_shared<DirectSumSolver>(), std::make_shared<MixedPrecisionSolver>()})
+    {
+        SolarSystem system(particles);
+        system.SetForceSolver(solver);
+        system.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+        double init_energy = system.GetDiagnostics(0.01).total_energy;
+        system.StepEvolve(100, 0.001, 0.01);
+        energy_errors.push_back(std::abs((system.GetDiagnostics(0.01).total_energy - init_energy) / init_energy));
+    }
+    REQUIRE(energy_errors[1] < 2 * energy_errors[0] + 1e-7);
+
+    // a close pair at 30 AU, whose pull on each other is far larger than the star's: separations from float positions
+    // would be off by 30 * 6e-8 against 0.01, a relative error of 2e-4
+    Particle sun{1.};
+    Particle planet{1e-3};
+    Particle moon{1e-3};
+    planet.SetPosition(Eigen::Vector3d {30.00002, 0., 0.});
+    moon.SetPosition(Eigen::Vector3d {30.01003, 0.003, -0.002});
+    ParticleStore close_pair({sun, planet, moon});
+    MixedPrecisionSolver mixed;
+    auto close_comparison = ForceSolver::CompareWithDirectSum(mixed, close_pair, 0.0, 3);
+    REQUIRE(close_comparison.max_relative_error < 1e-5);
+
+    REQUIRE(MixedPrecisionSolver().GetBlockSize() == 256);
+    REQUIRE_THROWS_AS( MixedPrecisionSolver(0), std::logic_error);
+}
+
+// Barnes-Hut octree solver
+TEST_CASE( "BarnesHutSolver does not approximate the direct summation", "[barnes_hut]" )
+{
+    float epsilon = 0.01;
+
+    // a fixed system, as the error bounds hold on average but not for every random draw
+    RandomInitialGenerator randgen(5);
+    ParticleStore store(randgen.GenerateInitialConditions(500));
+    int n = store.Size();
+
+    std::vector<double> direct_x(n), direct_y(n), direct_z(n);
+    DirectSumSolver direct;
+    direct.ComputeAccelerations(store, epsilon, direct_x.data(), direct_y.data(), direct_z.data());
+
+    // theta = 0 opens every cell and reduces to the direct summation
+    BarnesHutSolver exact(0.0);
+    std::vector<double> bh_x(n), bh_y(n), bh_z(n);
+    exact.ComputeAccelerations(store, epsilon, bh_x.data(), bh_y.data(), bh_z.data());
+    for(int i = 0; i < n; i++)
+    {
+        Eigen::Vector3d expected_acc = {direct_x[i], direct_y[i], direct_z[i]};
+        REQUIRE(Eigen::Vector3d(bh_x[i], bh_y[i], bh_z[i]).isApprox(expected_acc, 1e-10));
+    }
+
+    // a larger opening angle stays accurate to well under a percent on average
+    BarnesHutSolver approximate(0.5);
+    auto comparison = ForceSolver::CompareWithDirectSum(approximate, store, epsilon, n);
+    REQUIRE(comparison.sample_size == n);
+    REQUIRE(comparison.rms_relative_error < 1e-2);
+    REQUIRE(comparison.max_relative_error < 1e-1);
+    REQUIRE(approximate.NumNodes() > 1);
+
+    REQUIRE_THROWS_AS( BarnesHutSolver(-0.1), std::logic_error);
+    REQUIRE_THROWS_AS( BarnesHutSolver(1.5), std::logic_error);
+    REQUIRE_THROWS_AS( BarnesHutSolver(0.5, 0), std::logic_error);
+}
+
+TEST_CASE( "BarnesHutSolver does not refit its tree to moved bodies correctly", "[barnes_hut_refit]" )
+{
+    float epsilon = 0.01;
+
+    RandomInitialGenerator randgen;
+    auto particles = randgen.GenerateInitialConditions(300);
+    SolarSystem system(particles);
+
+    // rebuilt only every 100 evaluations, refitted in between
+    system.SetForceSolver(std::make_shared<BarnesHutSolver>(0.0, 100));
+    SolarSystem reference(particles);
+    reference.SetForceSolver(std::make_shared<DirectSumSolver>());
+
+    system.StepEvolve(20, 0.01, epsilon);
+    reference.StepEvolve(20, 0.01, epsilon);
+
+    for(int i = 0; i < system.NumParticles(); i++)
+    {
+        REQUIRE(system.GetParticle(i).GetPosition().isApprox(reference.GetParticle(i).GetPosition(), 1e-10));
+    }
+}
+
+// fast multipole method
+TEST_CASE( "FmmSolver does not approximate the direct summation", "[fmm]" )
+{
+    float epsilon = 0.01;
+
+    RandomInitialGenerator randgen(5);
+    ParticleStore store(randgen.GenerateInitialConditions(2000));
+    int n = store.Size();
+
+    // theta = 0 never uses the expansions and reduces to the direct summation
+    FmmSolver exact(4, 0.0);
+    REQUIRE(ForceSolver::CompareWithDirectSum(exact, store, epsilon, n).max_relative_error < 1e-10);
+
+    // the error falls as the expansion order increases
+    FmmSolver low_order(2, 0.5);
+    FmmSolver high_order(6, 0.5);
+    double low_order_error = ForceSolver::CompareWithDirectSum(low_order, store, epsilon, n).rms_relative_error;
+    double high_order_error = ForceSolver::CompareWithDirectSum(high_order, store, epsilon, n).rms_relative_error;
+    REQUIRE(high_order_error < low_order_error / 10);
+    REQUIRE(high_order_error < 1e-3);
+
+    // tuning the order until the requested error is reached
+    FmmSolver tuned(1, 0.5);
+    double tuned_error = tuned.TuneOrder(store, epsilon, 1e-4);
+    REQUIRE(tuned_error < 1e-4);
+    REQUIRE(tuned.GetOrder() > 1);
+
+    REQUIRE_THROWS_AS( FmmSolver(0), std::logic_error);
+    REQUIRE_THROWS_AS( FmmSolver(FmmSolver::max_order + 1), std::logic_error);
+    REQUIRE_THROWS_AS( FmmSolver(4, 1.0), std::logic_error);
+}
+
+// integrators
+
+// the symplectic integrators bring the Earth back close to its starting point after one year of a Sun-Earth system,
+// and the symplectic ones conserve energy far better than Euler at the same timestep
+TEST_CASE( "Integrators do not evolve a circular orbit correctly", "[integrators]" )
+{
+    Particle sun{1.};
+    Particle earth{1./332946.038};
+    earth.SetPosition(Eigen::Vector3d {1., 0., 0.});
+    earth.SetVelocity(Eigen::Vector3d {0., 1., 0.});
+    std::vector<Particle> particles = {sun, earth};
+
+    double dt = 0.01;
+    int num_steps = int(2 * M_PI / dt);
+
+    std::vector<std::shared_ptr<Integrator>> integrators = {std::make_shared<EulerIntegrator>(), std::make_shared<LeapfrogIntegrator>(),
+                                                            std::make_shared<VelocityVerletIntegrator>(), std::make_shared<YoshidaIntegrator>()};
+    std::vector<double> energy_errors;
+    std::vector<Eigen::Vector3d> final_positions;
+
+    for(auto integrator : integrators)
+    {
+        SolarSystem system(particles);
+        system.SetIntegrator(integrator);
+        double init_energy = system.TotalSystemEnergy();
+        for(int step = 0; step < num_steps; step++)
+        {
+            system.Step(dt, 0.0);
+        }
+        energy_errors.push_back(std::abs(system.TotalSystemEnergy() - init_energy) / std::abs(init_energy));
+        final_positions.push_back(system.GetParticle(1).GetPosition());
+
+    }
+
+    // a full orbit of radius 1 takes 2π, Euler spirals outwards so only the symplectic schemes are checked
+    for(int i = 1; i < final_positions.size(); i++)
+    {
+        REQUIRE_THAT(final_positions[i].norm(), WithinAbs(1.0, 1e-3));
+        REQUIRE_THAT(final_positions[i][0], WithinAbs(1.0, 1e-2));
+    }
+
+    // symplectic schemes beat Euler by orders of magnitude, and the fourth order scheme beats the second order ones
+    REQUIRE(energy_errors[1] < energy_errors[0] / 100);
+    REQUIRE(energy_errors[2] < energy_errors[0] / 100);
+    REQUIRE(energy_errors[3] < energy_errors[1]);
+
+    // leapfrog and velocity Verlet follow the same trajectory
+    REQUIRE(final_positions[1].isApprox(final_positions[2], 1e-10));
+
+    SolarSystem system(particles);
+    REQUIRE_THROWS_AS( system.SetIntegrator(nullptr), std::logic_error);
+}
+
+// block timesteps
+
+// bodies evenly spread over radii 0.4 to 30 around the star, as from the RandomInitialGenerator, get their own power-of-two timesteps, the outer ones far longer
+// than the inner ones, so far fewer forces are evaluated than with a shared timestep, at a similar energy error
+TEST_CASE( "Block timesteps do not evolve a system correctly", "[block_timesteps]" )
+{
+    std::vector<Particle> particles = {Particle{1.}};
+    for(int i = 0; i < 16; i++)
+    {
+        double r = 0.4 + 29.6 * i / 15.;
+        double angle = 2.4 * i;
+        Particle planet{1e-6};
+        planet.SetPosition(Eigen::Vector3d {r * std::cos(angle), r * std::sin(angle), 0.});
+        planet.SetVelocity(Eigen::Vector3d {-std::sin(angle) / std::sqrt(r), std::cos(angle) / std::sqrt(r), 0.});
+        particles.push_back(planet);
+    }
+
+    auto block = std::make_shared<BlockTimestepIntegrator>(0.01, 20);
+    SolarSystem system(particles);
+    system.SetIntegrator(block);
+    double init_energy = system.TotalSystemEnergy();
+
+    double dt = 1.0;
+    int num_steps = 20;
+    for(int step = 0; step < num_steps; step++)
+    {
+        system.Step(dt, 0.0);
+    }
+
+    auto levels = block->GetLevels();
+    REQUIRE(levels[1] > levels[16] + 5);
+
+    // a shared timestep would put every body on the finest level
+    int finest_level = *std::max_element(levels.begin(), levels.end());
+    long long shared_evaluations = 16LL * num_steps << finest_level;
+    REQUIRE(block->GetBodyForceEvaluations() * 10 < shared_evaluations);
+
+    REQUIRE(std::abs((system.TotalSystemEnergy() - init_energy) / init_energy) < 1e-6);
+
+    // the innermost planet goes around its circular orbit at the right radius
+    REQUIRE_THAT(system.GetParticle(1).GetPosition().norm(), WithinAbs(0.4, 1e-6));
+
+    // the levels and jerks are only reused on the system and state they were taken on: for the instance shared with
+    // another system, and after switching to another integrator and back, a step agrees to the last bit with one by a
+    // fresh integrator
+    auto same_bodies = [](const SolarSystem& a, const SolarSystem& b)
+    {
+        return a.GetParticleStore().x == b.GetParticleStore().x && a.GetParticleStore().vx == b.GetParticleStore().vx;
+    };
+    std::vector<Particle> rotated = particles;
+    Eigen::AngleAxisd rotation(1.0, Eigen::Vector3d::UnitZ());
+    for(auto& planet : rotated)
+    {
+        planet.SetPosition(rotation * planet.GetPosition());
+        planet.SetVelocity(rotation * planet.GetVelocity());
+    }
+    SolarSystem other(rotated);
+    other.SetIntegrator(block);
+    SolarSystem other_fresh = other;
+    other_fresh.SetIntegrator(std::make_shared<BlockTimestepIntegrator>(0.01, 20));
+    other.GetDiagnostics(0.0);
+    other.Step(dt, 0.0);
+    other_fresh.Step(dt, 0.0);
+    REQUIRE(same_bodies(other, other_fresh));
+
+    system.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    system.Step(0.01, 0.0);
+    SolarSystem system_fresh = system;
+    system.SetIntegrator(block);
+    system_fresh.SetIntegrator(std::make_shared<BlockTimestepIntegrator>(0.01, 20));
+    system.Step(dt, 0.0);
+    system_fresh.Step(dt, 0.0);
+    REQUIRE(same_bodies(system, system_fresh));
+
+    REQUIRE_THROWS_AS( BlockTimestepIntegrator(0.0), std::logic_error);
+    REQUIRE_THROWS_AS( BlockTimestepIntegrator(0.01, 31), std::logic_error);
+}
+
+// Hermite
+
+// the fused pass over the pairs gives the same accelerations and jerks as the pass over all j for every body, and the
+// Hermite steps converge with the fourth power of the timestep, far ahead of the leapfrog
+TEST_CASE( "The Hermite integrator does not evolve a system correctly", "[hermite]" )
+{
+    RandomInitialGenerator randgen(11);
+    SolarSystem general_system(randgen.GenerateInitialConditions(200));
+    const ParticleStore& store = general_system.GetParticleStore();
+    const int num_particles = store.Size();
+
+    std::vector<int> active(num_particles - 1);
+    std::iota(active.begin(), active.end(), 1);
+    std::vector<double> expected(6 * num_particles), fused(6 * num_particles);
+    SolarSystem::ComputeAccelerationsAndJerks(store, active, 0.01, &expected[0], &expected[num_particles], &expected[2 * num_particles],
+                                              &expected[3 * num_particles], &expected[4 * num_particles], &expected[5 * num_particles]);
+    PairBuffers buffers;
+    SolarSystem::ComputeAccelerationsAndJerks(store, 0.01, buffers, &fused[0], &fused[num_particles], &fused[2 * num_particles],
+                                              &fused[3 * num_particles], &fused[4 * num_particles], &fused[5 * num_particles]);
+    for(int component = 0; component < 6; component++)
+    {
+        for(int i = 1; i < num_particles; i++)
+        {
+            double value = expected[component * num_particles + i];
+            REQUIRE_THAT(fused[component * num_particles + i], WithinAbs(value, 1e-10 * std::abs(value) + 1e-14));
+        }
+    }
+
+    Particle sun{1.};
+    Particle earth{1./332946.038};
+    earth.SetPosition(Eigen::Vector3d {1., 0., 0.});
+    earth.SetVelocity(Eigen::Vector3d {0., 1.2, 0.});
+    std::vector<Particle> particles = {sun, earth};
+
+    std::vector<double> energy_errors;
+    for(double dt : {0.02, 0.01})
+    {
+        SolarSystem system(particles);
+        system.SetIntegrator(std::make_shared<HermiteIntegrator>());
+        double init_energy = system.TotalSystemEnergy();
+        for(int step = 0; step < int(2 * M_PI / dt); step++)
+        {
+            system.Step(dt, 0.0);
+        }
+        energy_errors.push_back(std::abs((system.TotalSystemEnergy() - init_energy) / init_energy));
+    }
+    REQUIRE(energy_errors[1] < energy_errors[0] / 12);
+
+    SolarSystem leapfrog_system(particles);
+    leapfrog_system.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    double init_energy = leapfrog_system.TotalSystemEnergy();
+    double max_leapfrog_error = 0.0;
+    for(int step = 0; step < int(2 * M_PI / 0.01); step++)
+    {
+        leapfrog_system.Step(0.01, 0.0);
+        max_leapfrog_error = std::max(max_leapfrog_error, std::abs((leapfrog_system.TotalSystemEnergy() - init_energy) / init_energy));
+    }
+    REQUIRE(energy_errors[1] < max_leapfrog_error / 100);
+
+    HermiteIntegrator hermite;
+    REQUIRE(hermite.GetName() == "hermite");
+    REQUIRE(hermite.ForceEvaluationsPerStep() == 1);
+    SolarSystem state_system(particles);
+    auto stepped = std::make_shared<HermiteIntegrator>();
+    state_system.SetIntegrator(stepped);
+    state_system.Step(0.01, 0.0);
+    REQUIRE(stepped->GetState().size() == 7);
+    REQUIRE_THROWS_AS( stepped->SetState({0.0}, state_system.GetParticleStore()), std::logic_error);
+
+    // the jerks are only reused on the system and state they were taken on: after switching to another integrator and
+    // back, and for an instance shared by two systems, a step agrees to the last bit with one by a fresh integrator
+    auto same_bodies = [](const SolarSystem& a, const SolarSystem& b)
+    {
+        return a.GetParticleStore().x == b.GetParticleStore().x && a.GetParticleStore().vx == b.GetParticleStore().vx;
+    };
+    auto shared = std::make_shared<HermiteIntegrator>();
+    SolarSystem switched(randgen.GenerateInitialConditions(20));
+    switched.SetIntegrator(shared);
+    switched.StepEvolve(5, 0.01, 0.01);
+    switched.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    switched.StepEvolve(5, 0.01, 0.01);
+    SolarSystem switched_fresh = switched;
+    switched.SetIntegrator(shared);
+    switched_fresh.SetIntegrator(std::make_shared<HermiteIntegrator>());
+    switched.Step(0.01, 0.01);
+    switched_fresh.Step(0.01, 0.01);
+    REQUIRE(same_bodies(switched, switched_fresh));
+
+    SolarSystem other(randgen.GenerateInitialConditions(20));
+    other.SetIntegrator(shared);
+    SolarSystem other_fresh = other;
+    other_fresh.SetIntegrator(std::make_shared<HermiteIntegrator>());
+    SolarSystem switched_again = switched;
+    switched_again.SetIntegrator(std::make_shared<HermiteIntegrator>());
+    other.GetDiagnostics(0.01);
+    other.Step(0.01, 0.01);
+    other_fresh.Step(0.01, 0.01);
+    switched.Step(0.01, 0.01);
+    switched_again.Step(0.01, 0.01);
+    REQUIRE(same_bodies(other, other_fresh));
+    REQUIRE(same_bodies(switched, switched_again));
+}
+
+// Wisdom-Holman
+
+// the Kepler drift of bound and unbound orbits agrees with itself when split into smaller drifts and conserves the energy
+// and angular momentum; the two-body problem is solved exactly at any timestep, and the planets of the solar system keep
+// their energy far better than with the leapfrog at the same timestep
+TEST_CASE( "The Wisdom-Holman integrator does not evolve a planetary system correctly", "[wisdom_holman]" )
+{
+    for(double speed : {1.3, std::sqrt(2.0), 2.0})
+    {
+        Eigen::Vector3d position{1.0, 0.2, 0.0};
+        Eigen::Vector3d velocity{0.1, speed, 0.05};
+        auto energy = [](const Eigen::Vector3d& x, const Eigen::Vector3d& v) { return v.squaredNorm() / 2 - 1.0 / x.norm(); };
+
+        Eigen::Vector3d once_x = position, once_v = velocity;
+        WisdomHolmanIntegrator::KeplerDrift(1.0, 20.0, once_x(0), once_x(1), once_x(2), once_v(0), once_v(1), once_v(2));
+        Eigen::Vector3d split_x = position, split_v = velocity;
+        for(int step = 0; step < 200; step++)
+        {
+            WisdomHolmanIntegrator::KeplerDrift(1.0, 0.1, split_x(0), split_x(1), split_x(2), split_v(0), split_v(1), split_v(2));
+        }
+        REQUIRE((once_x - split_x).norm() < 1e-9 * once_x.norm());
+        REQUIRE((once_v - split_v).norm() < 1e-9 * once_v.norm());
+        REQUIRE_THAT(energy(once_x, once_v), WithinAbs(energy(position, velocity), 1e-12));
+        REQUIRE((once_x.cross(once_v) - position.cross(velocity)).norm() < 1e-12);
+    }
+
+    Particle sun{1.};
+    Particle earth{1./332946.038};
+    earth.SetPosition(Eigen::Vector3d {1., 0., 0.});
+    earth.SetVelocity(Eigen::Vector3d {0., 1., 0.});
+    SolarSystem two_body({sun, earth});
+    two_body.SetIntegrator(std::make_shared<WisdomHolmanIntegrator>());
+    for(int step = 0; step < 8; step++)
+    {
+        two_body.Step(M_PI / 4, 0.0);
+    }
+    REQUIRE((two_body.GetParticle(1).GetPosition() - Eigen::Vector3d {1., 0., 0.}).norm() < 1e-12);
+
+    SolarSystemGenerator ssgen;
+    auto initial_conditions = ssgen.GenerateInitialConditions();
+    std::vector<double> energy_errors;
+    for(auto integrator : std::vector<std::shared_ptr<Integrator>>{std::make_shared<LeapfrogIntegrator>(), std::make_shared<WisdomHolmanIntegrator>()})
+    {
+        SolarSystem solar_system(initial_conditions);
+        solar_system.SetIntegrator(integrator);
+        double init_energy = solar_system.TotalSystemEnergy();
+        solar_system.TimeEvolve(20 * M_PI, 0.1, 0.0);
+        energy_errors.push_back(std::abs((solar_system.TotalSystemEnergy() - init_energy) / init_energy));
+    }
+    REQUIRE(energy_errors[1] < 1e-8);
+    REQUIRE(energy_errors[1] < energy_errors[0] / 10);
+
+    WisdomHolmanIntegrator wh;
+    REQUIRE(wh.GetName() == "wh");
+    REQUIRE(wh.ForceEvaluationsPerStep() == 1);
+}
+
+// Bulirsch-Stoer
+
+// the adaptive integrator keeps the energy error near its tolerance with steps it picks itself, tightening the tolerance
+// takes more steps for a smaller error, a step covers its dt exactly, and an eccentric orbit forces rejected steps
+TEST_CASE( "The Bulirsch-Stoer integrator does not control its error", "[bulirsch_stoer]" )
+{
+    SolarSystemGenerator ssgen;
+    auto initial_conditions = ssgen.GenerateInitialConditions();
+
+    std::vector<double> energy_errors;
+    std::vector<long long> steps;
+    for(double tolerance : {1e-8, 1e-11})
+    {
+        SolarSystem solar_system(initial_conditions);
+        auto integrator = std::make_shared<BulirschStoerIntegrator>(tolerance);
+        solar_system.SetIntegrator(integrator);
+        double init_energy = solar_system.TotalSystemEnergy();
+        solar_system.Step(20 * M_PI, 0.0);
+        energy_errors.push_back(std::abs((solar_system.TotalSystemEnergy() - init_energy) / init_energy));
+        steps.push_back(integrator->GetStepsTaken());
+        REQUIRE(integrator->GetForceEvaluations() > integrator->GetStepsTaken());
+        REQUIRE(integrator->GetNextStep() > 0);
+    }
+    REQUIRE(energy_errors[0] < 1e-8);
+    REQUIRE(energy_errors[1] < energy_errors[0] / 100);
+    REQUIRE(steps[1] > steps[0]);
+
+    SolarSystem one_step(initial_conditions);
+    SolarSystem two_steps(initial_conditions);
+    one_step.SetIntegrator(std::make_shared<BulirschStoerIntegrator>(1e-12));
+    two_steps.SetIntegrator(std::make_shared<BulirschStoerIntegrator>(1e-12));
+    one_step.Step(2 * M_PI, 0.0);
+    two_steps.Step(M_PI, 0.0);
+    two_steps.Step(M_PI, 0.0);
+    for(int i = 1; i < one_step.NumParticles(); i++)
+    {
+        REQUIRE((one_step.GetParticle(i).GetPosition() - two_steps.GetParticle(i).GetPosition()).norm() < 1e-9);
+    }
+
+    // eccentricity 0.9, a period of 2 pi 10^(3/2), starting at the pericentre
+    Particle sun{1.};
+    Particle comet{1e-6};
+    comet.SetPosition(Eigen::Vector3d {1., 0., 0.});
+    comet.SetVelocity(Eigen::Vector3d {0., std::sqrt(1.9), 0.});
+    SolarSystem eccentric({sun, comet});
+    auto integrator = std::make_shared<BulirschStoerIntegrator>(1e-10);
+    eccentric.SetIntegrator(integrator);
+    eccentric.Step(2 * M_PI * std::pow(10.0, 1.5), 0.0);
+    REQUIRE((eccentric.GetParticle(1).GetPosition() - Eigen::Vector3d {1., 0., 0.}).norm() < 1e-6);
+    REQUIRE(integrator->GetStepsRejected() > 0);
+    REQUIRE(integrator->GetState().size() == 5);
+
+    // a body at rest on top of the softened star, between three planets 120 degrees apart, only feels rounding
+    // errors, so its position and velocity stay near 0 and a purely relative error would never be met
+    std::vector<Particle> bodies {sun, Particle{1e-6}};
+    for(int k = 0; k < 3; k++)
+    {
+        double angle = 2 * M_PI * k / 3;
+        Particle planet{1e-3};
+        planet.SetPosition(Eigen::Vector3d {std::cos(angle), std::sin(angle), 0.});
+        planet.SetVelocity(Eigen::Vector3d {-std::sin(angle), std::cos(angle), 0.});
+        bodies.push_back(planet);
+    }
+    SolarSystem at_rest(bodies);
+    auto rest_integrator = std::make_shared<BulirschStoerIntegrator>(1e-10);
+    at_rest.SetIntegrator(rest_integrator);
+    REQUIRE_NOTHROW(at_rest.Step(M_PI, 0.1));
+    REQUIRE(rest_integrator->GetStepsTaken() < 1000);
+
+    REQUIRE_THROWS_AS( BulirschStoerIntegrator(0.0), std::logic_error);
+    REQUIRE_THROWS_AS( BulirschStoerIntegrator(1e-10, 1), std::logic_error);
+    REQUIRE_THROWS_AS( integrator->SetState({1.0}, eccentric.GetParticleStore()), std::logic_error);
+}
+
+// schedule of the force loop
+
+// the schedule only changes which thread sums which body, so Step gives the same bits for any schedule and number of threads
+TEST_CASE( "SolarSystem::SetSchedule does not keep the evolution with Step", "[SS_schedule]" )
+{
+    RandomInitialGenerator randgen;
+    auto particles = randgen.GenerateInitialConditions(200);
+
+    SolarSystem reference(particles);
+    reference.SetForceSolver(std::make_shared<DirectSumSolver>());
+    for(int step = 0; step < 50; step++)
+    {
+        reference.Step(0.001, 0.01);
+    }
+
+    const int default_threads = omp_get_max_threads();
+    omp_sched_t default_kind;
+    int default_chunk;
+    omp_get_schedule(&default_kind, &default_chunk);
+    std::vector<omp_sched_t> schedules = {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+    for(auto schedule : schedules)
+    {
+        for(int num_threads : {1, 3})
+        {
+            omp_set_num_threads(num_threads);
+            SolarSystem system(particles);
+            system.SetForceSolver(std::make_shared<DirectSumSolver>());
+            system.SetSchedule(schedule, 7);
+            for(int step = 0; step < 50; step++)
+            {
+                system.Step(0.001, 0.01);
+            }
+
+            // the schedule of the caller is left as it was
+            omp_sched_t kind;
+            int chunk;
+            omp_get_schedule(&kind, &chunk);
+            REQUIRE( kind == default_kind );
+            REQUIRE( chunk == default_chunk );
+
+            // every body is summed in the same order, so the results agree to the last bit
+            for(int i = 0; i < system.NumParticles(); i++)
+            {
+                REQUIRE(system.GetParticle(i).GetPosition() == reference.GetParticle(i).GetPosition());
+                REQUIRE(system.GetParticle(i).GetVelocity() == reference.GetParticle(i).GetVelocity());
+            }
+        }
+    }
+    omp_set_num_threads(default_threads);
+
+    SolarSystem system(particles);
+    REQUIRE_THROWS_AS( system.SetSchedule(omp_sched_dynamic, -1), std::logic_error);
+    REQUIRE_THROWS_AS( system.SetSchedule(omp_sched_auto), std::logic_error);
+}
+
+// execution engine
+
+// the engine runs every phase on every item once per step, on its thread team or serially below the threshold,
+// and EngineEvolve follows the LeapfrogIntegrator with the direct summation to the last bit either way
+TEST_CASE( "ExecutionEngine does not run the phases of a simulation correctly", "[execution_engine]" )
+{
+    std::vector<int> counts(1000, 0);
+    std::vector<int> checks(1000, 0);
+    ExecutionEngine::Phase count = [&](int begin, int end)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            counts[i]++;
+        }
+    };
+
+    // the second phase sees the counts of all items from the first one, whichever thread wrote them
+    ExecutionEngine::Phase check = [&](int begin, int end)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            checks[i] += (counts[999 - i] == counts[i]);
+        }
+    };
+    ExecutionEngine team(4, 100);
+    REQUIRE(team.NumThreads(1000) == 4);
+    REQUIRE(team.NumThreads(99) == 1);
+    team.Run(10, 1000, {count, check});
+    REQUIRE(std::all_of(counts.begin(), counts.end(), [](int c){ return c == 10; }));
+    REQUIRE(std::all_of(checks.begin(), checks.end(), [](int c){ return c == 10; }));
+
+    RandomInitialGenerator randgen;
+    auto particles = randgen.GenerateInitialConditions(200);
+
+    SolarSystem reference(particles);
+    reference.SetForceSolver(std::make_shared<DirectSumSolver>());
+    reference.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    for(int step = 0; step < 30; step++)
+    {
+        reference.Step(0.001, 0.01);
+    }
+
+    for(int serial_threshold : {0, 1000})
+    {
+        SolarSystem system(particles);
+        system.EngineEvolve(ExecutionEngine(3, serial_threshold), 10, 0.001, 0.01);
+        system.EngineEvolve(ExecutionEngine(3, serial_threshold), 20, 0.001, 0.01);
+        for(int i = 0; i < system.NumParticles(); i++)
+        {
+            REQUIRE(system.GetParticle(i).GetPosition() == reference.GetParticle(i).GetPosition());
+            REQUIRE(system.GetParticle(i).GetVelocity() == reference.GetParticle(i).GetVelocity());
+        }
+    }
+
+    REQUIRE_THROWS_AS( ExecutionEngine(-1), std::logic_error);
+    REQUIRE_THROWS_AS( ExecutionEngine(2, -1), std::logic_error);
+}
+
+// distributed runs
+
+// three local processes exchanging their blocks over socket pairs follow the single-process run to the last bit
+TEST_CASE( "DistributedSolarSystem does not match the single-process evolution", "[distributed]" )
+{
+    RandomInitialGenerator randgen;
+    auto particles = randgen.GenerateInitialConditions(100);
+
+    REQUIRE(Transport::Partition(101, 3) == std::vector<int> {0, 33, 67, 101});
+
+    SolarSystem reference(particles);
+    reference.SetForceSolver(std::make_shared<DirectSumSolver>());
+    for(int step = 0; step < 20; step++)
+    {
+        reference.Step(0.001, 0.01);
+    }
+
+    auto transport = SocketTransport::Fork(3);
+    DistributedSolarSystem system(particles, transport);
+    system.Evolve(20, 0.001, 0.01);
+    double energy = system.TotalSystemEnergy();
+    const ParticleStore& store = system.Gather();
+
+    // the child processes exit here
+    transport->Finish();
+
+    REQUIRE(transport->Rank() == 0);
+    REQUIRE(system.OwnedEnd() == 33);
+    for(int i = 0; i < store.Size(); i++)
+    {
+        REQUIRE(store.GetPosition(i) == reference.GetParticle(i).GetPosition());
+        REQUIRE(store.GetVelocity(i) == reference.GetParticle(i).GetVelocity());
+    }
+    REQUIRE_THAT(energy, WithinRel(reference.TotalSystemEnergy(), 1e-12));
+
+    // a single process needs no exchange at all
+    DistributedSolarSystem serial(particles, std::make_shared<SerialTransport>());
+    serial.Evolve(20, 0.001, 0.01);
+    REQUIRE(serial.Gather().x == store.x);
+}
+
+// trajectory files
+
+// frames written every few steps of TimeEvolve are read back from the mapped file exactly in double precision,
+// and to float precision when downcast
+TEST_CASE( "Trajectory files are not written or read correctly", "[trajectory]" )
+{
+    SolarSystemGenerator ssgen;
+    auto particles = ssgen.GenerateInitialConditions();
+
+    for(auto precision : {TrajectoryWriter::Precision::Double, TrajectoryWriter::Precision::Float})
+    {
+        const std::string filename = "test_trajectory.bin";
+        SolarSystem system(particles);
+        auto writer = std::make_shared<TrajectoryWriter>(filename, system.GetMasses(), precision);
+        system.SetTrajectoryWriter(writer, 10);
+
+        // frames at steps 0, 10, ..., 100
+        system.TimeEvolve(0.1, 0.001, 0.0);
+        writer->Close();
+        REQUIRE(writer->NumFrames() == 11);
+
+        TrajectoryReader reader(filename);
+        REQUIRE(reader.NumParticles() == 9);
+        REQUIRE(reader.NumFrames() == 11);
+        REQUIRE(reader.GetPrecision() == precision);
+        REQUIRE(reader.GetMasses() == system.GetMasses());
+        REQUIRE(reader.GetStep(10) == 100);
+        REQUIRE_THAT(reader.GetTime(10), WithinRel(0.1, 1e-12));
+
+        // the first frame holds the initial conditions and the last one the final state
+        double tolerance = precision == TrajectoryWriter::Precision::Double ? 0.0 : 1e-6;
+        ParticleStore first = reader.GetFrame(0);
+        for(int i = 0; i < 9; i++)
+        {
+            REQUIRE((first.GetPosition(i) - particles[i].GetPosition()).norm() <= tolerance * 30);
+            REQUIRE((reader.GetVelocity(0, i) - particles[i].GetVelocity()).norm() <= tolerance * 2);
+        }
+        REQUIRE((reader.GetPosition(10, 3) - system.GetParticle(3).GetPosition()).norm() <= tolerance);
+
+        REQUIRE_THROWS_AS( reader.GetFrame(11), std::logic_error);
+        std::remove(filename.c_str());
+    }
+
+    REQUIRE_THROWS_AS( TrajectoryReader("missing_trajectory.bin"), std::runtime_error);
+    SolarSystem system(particles);
+    REQUIRE_THROWS_AS( system.SetTrajectoryWriter(nullptr, 0), std::logic_error);
+}
+
+// checkpoints
+
+// a run resumed from a snapshot written half-way continues bit for bit, also for an integrator with internal state,
+// and the state of the random generator regenerates the same bodies
+TEST_CASE( "Checkpoints do not restart a run correctly", "[checkpoint]" )
+{
+    RandomInitialGenerator randgen(42);
+    const std::string generator_state = randgen.GetState();
+    auto particles = randgen.GenerateInitialConditions(50);
+
+    RandomInitialGenerator regenerated;
+    regenerated.SetState(generator_state);
+    auto regenerated_particles = regenerated.GenerateInitialConditions(50);
+    REQUIRE(regenerated_particles[50].GetPosition() == particles[50].GetPosition());
+    REQUIRE(RandomInitialGenerator(42).GenerateInitialConditions(50)[7].GetMass() == particles[7].GetMass());
+
+    std::vector<std::function<std::shared_ptr<Integrator>()>> make_integrators = {
+        []{ return std::make_shared<LeapfrogIntegrator>(); },
+        []{ return std::make_shared<BlockTimestepIntegrator>(0.01, 10); },
+        []{ return std::make_shared<HermiteIntegrator>(); }};
+
+    // the default solver explicitly, on a fixed number of threads, as its results depend on the number of threads
+    const int previous_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    for(auto make_integrator : make_integrators)
+    {
+        const std::string filename = "test_checkpoint.bin";
+
+        SolarSystem reference(particles);
+        reference.SetIntegrator(make_integrator());
+        reference.SetForceSolver(std::make_shared<PairwiseSolver>());
+        reference.TimeEvolve(0.1, 0.001, 0.01);
+
+        // a snapshot after 60 of the 100 steps
+        SolarSystem system(particles);
+        system.SetIntegrator(make_integrator());
+        system.SetForceSolver(std::make_shared<PairwiseSolver>());
+        auto writer = std::make_shared<CheckpointWriter>(filename, "test run", generator_state);
+        system.SetCheckpointWriter(writer, 60);
+        system.TimeEvolve(0.1, 0.001, 0.01);
+        writer->Close();
+        REQUIRE(writer->NumWritten() == 1);
+
+        Checkpoint checkpoint = CheckpointWriter::ReadFile(filename);
+        REQUIRE(checkpoint.step == 60);
+        REQUIRE(checkpoint.num_threads == 4);
+        REQUIRE(checkpoint.run_info == "test run");
+        REQUIRE(checkpoint.generator_state == generator_state);
+
+        SolarSystem resumed(regenerated_particles);
+        resumed.SetIntegrator(make_integrator());
+        resumed.SetForceSolver(std::make_shared<PairwiseSolver>());
+        resumed.ResumeTimeEvolve(checkpoint);
+        for(int i = 0; i < resumed.NumParticles(); i++)
+        {
+            REQUIRE(resumed.GetParticle(i).GetPosition() == reference.GetParticle(i).GetPosition());
+            REQUIRE(resumed.GetParticle(i).GetVelocity() == reference.GetParticle(i).GetVelocity());
+        }
+
+        // the integrator has to match
+        SolarSystem wrong_integrator(particles);
+        REQUIRE_THROWS_AS( wrong_integrator.ResumeTimeEvolve(checkpoint), std::logic_error);
+
+        // truncated and corrupt files are refused before any of their lengths is used
+        std::ifstream snapshot(filename, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(snapshot)), std::istreambuf_iterator<char>());
+        snapshot.close();
+        for(std::size_t length : {std::size_t(20), std::size_t(50), bytes.size() / 2, bytes.size() - 1})
+        {
+            std::ofstream(filename, std::ios::binary | std::ios::trunc) << bytes.substr(0, length);
+            REQUIRE_THROWS_AS( CheckpointWriter::ReadFile(filename), std::runtime_error);
+        }
+        // the length of the integrator name, after the magic, step, times, epsilon, number of threads and flag
+        std::string corrupt = bytes;
+        std::fill(corrupt.begin() + 49, corrupt.begin() + 57, char(0x7f));
+        std::ofstream(filename, std::ios::binary | std::ios::trunc) << corrupt;
+        REQUIRE_THROWS_AS( CheckpointWriter::ReadFile(filename), std::runtime_error);
+        std::remove(filename.c_str());
+    }
+    omp_set_num_threads(previous_threads);
+
+    REQUIRE_THROWS_AS( CheckpointWriter::ReadFile("missing_checkpoint.bin"), std::runtime_error);
+}
+
+// energy diagnostics
+
+// the potential energy accumulated inside the force loops matches the separate pair sum, the accelerations are untouched,
+// and sampling every step leaves the evolution bit for bit the same
+TEST_CASE( "Diagnostics from the force pass are calculated incorrectly", "[diagnostics]" )
+{
+    RandomInitialGenerator randgen(7);
+    auto particles = randgen.GenerateInitialConditions(200);
+    ParticleStore store(particles);
+    const int num_particles = store.Size();
+    const float eps = 0.01;
+    double expected_pe = SolarSystem::PotentialEnergy(store, eps);
+
+    std::vector<double> acc_x(num_particles), acc_y(num_particles), acc_z(num_particles);
+    std::vector<double> fused_x(num_particles), fused_y(num_particles), fused_z(num_particles);
+    SolarSystem::ComputeAccelerations(store, eps, acc_x.data(), acc_y.data(), acc_z.data());
+
+    DirectSumSolver direct;
+    REQUIRE_THAT( direct.ComputeAccelerationsAndPotential(store, eps, fused_x.data(), fused_y.data(), fused_z.data()), WithinRel(expected_pe, 1e-12) );
+    REQUIRE(fused_x == acc_x);
+    REQUIRE(fused_z == acc_z);
+
+    PairwiseSolver pairwise;
+    REQUIRE_THAT( pairwise.ComputeAccelerationsAndPotential(store, eps, fused_x.data(), fused_y.data(), fused_z.data()), WithinRel(expected_pe, 1e-12) );
+
+    // the separate pass of the default implementation
+    FmmSolver fmm;
+    REQUIRE_THAT( fmm.ComputeAccelerationsAndPotential(store, eps, fused_x.data(), fused_y.data(), fused_z.data()), WithinRel(expected_pe, 1e-12) );
+
+    std::vector<std::function<std::shared_ptr<Integrator>()>> make_integrators = {
+        [] { return std::make_shared<EulerIntegrator>(); },
+        [] { return std::make_shared<LeapfrogIntegrator>(); }
+    };
+
+    for(auto make_integrator : make_integrators)
+    {
+        SolarSystem reference(particles);
+        reference.SetForceSolver(std::make_shared<DirectSumSolver>());
+        reference.SetIntegrator(make_integrator());
+        reference.StepEvolve(20, 0.001, eps);
+
+        SolarSystem system(particles);
+        system.SetForceSolver(std::make_shared<DirectSumSolver>());
+        system.SetIntegrator(make_integrator());
+        system.SetDiagnosticsInterval(1);
+        system.StepEvolve(20, 0.001, eps);
+
+        // StepEvolve makes num_steps + 1 steps
+        const auto& history = system.GetDiagnosticsHistory();
+        REQUIRE(history.size() == 22);
+
+        const ParticleStore& final_store = system.GetParticleStore();
+        REQUIRE(final_store.x == reference.GetParticleStore().x);
+        REQUIRE(final_store.vz == reference.GetParticleStore().vz);
+
+        const Diagnostics& last = history.back();
+        Eigen::Vector3d momentum = Eigen::Vector3d::Zero();
+        Eigen::Vector3d angular_momentum = Eigen::Vector3d::Zero();
+        for(int i = 0; i < num_particles; i++)
+        {
+            momentum += final_store.GetMass(i) * final_store.GetVelocity(i);
+            angular_momentum += final_store.GetMass(i) * final_store.GetPosition(i).cross(final_store.GetVelocity(i));
+        }
+        REQUIRE_THAT( last.kinetic_energy, WithinRel(SolarSystem::KineticEnergy(final_store), 1e-12) );
+        REQUIRE_THAT( last.potential_energy, WithinRel(SolarSystem::PotentialEnergy(final_store, eps), 1e-12) );
+        REQUIRE(last.total_energy == last.kinetic_energy + last.potential_energy);
+        REQUIRE(last.momentum.isApprox(momentum, 1e-12));
+        REQUIRE(last.angular_momentum.isApprox(angular_momentum, 1e-12));
+    }
+
+    SolarSystem system(particles);
+    REQUIRE_THROWS_AS( system.SetDiagnosticsInterval(-1), std::logic_error);
+}
+
+// telemetry
+
+// records pushed from the simulation thread reach the file in order, the drifts start from zero, the timings add up,
+// and a full ring buffer drops records instead of blocking
+TEST_CASE( "TelemetryMonitor does not record the run correctly", "[telemetry]" )
+{
+    RingBuffer<int> ring(3);
+    REQUIRE(ring.Capacity() == 4);
+    for(int value = 0; value < 4; value++)
+    {
+        REQUIRE(ring.TryPush(value));
+    }
+    REQUIRE_FALSE(ring.TryPush(4));
+    int value;
+    REQUIRE(ring.TryPop(value));
+    REQUIRE(value == 0);
+    REQUIRE(ring.TryPush(4));
+
+    RandomInitialGenerator randgen(11);
+    auto particles = randgen.GenerateInitialConditions(50);
+    const std::string filename = "test_telemetry.bin";
+
+    // the default solver explicitly, on a fixed number of threads, as its results depend on the number of threads
+    const int previous_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    SolarSystem reference(particles);
+    reference.SetForceSolver(std::make_shared<PairwiseSolver>());
+    reference.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    reference.StepEvolve(30, 0.001, 0.01);
+
+    SolarSystem system(particles);
+    system.SetForceSolver(std::make_shared<PairwiseSolver>());
+    system.SetIntegrator(std::make_shared<LeapfrogIntegrator>());
+    auto monitor = std::make_shared<TelemetryMonitor>(filename, TelemetryMonitor::FormatFromFilename(filename));
+    system.SetTelemetry(monitor, 4);
+    system.StepEvolve(30, 0.001, 0.01);
+    monitor->Close();
+    omp_set_num_threads(previous_threads);
+
+    // steps 0, 4, ..., 28 of the 31 steps
+    auto records = TelemetryMonitor::ReadBinary(filename);
+    REQUIRE(monitor->NumDropped() == 0);
+    REQUIRE(records.size() == 8);
+    REQUIRE(records[0].energy_drift == 0.0);
+    REQUIRE(records[0].momentum_drift == 0.0);
+    for(int k = 0; k < records.size(); k++)
+    {
+        REQUIRE(records[k].step == 4 * k);
+        REQUIRE(records[k].dt == 0.001);
+        REQUIRE(std::abs(records[k].energy_drift) < 1e-6);
+        REQUIRE(records[k].max_acceleration > 0.0);
+        REQUIRE(records[k].force_seconds >= 0.0);
+        REQUIRE(records[k].update_seconds >= 0.0);
+        REQUIRE_THAT(records[k].force_seconds + records[k].update_seconds, WithinAbs(records[k].step_seconds, 1e-12));
+    }
+
+    TelemetrySummary summary = monitor->GetSummary();
+    REQUIRE(summary.num_records == 8);
+    REQUIRE(summary.final_energy_drift == records.back().energy_drift);
+
+    // telemetry does not change the evolution
+    REQUIRE(system.GetParticleStore().x == reference.GetParticleStore().x);
+    std::remove(filename.c_str());
+
+    // a monitor without a file still keeps the summary; pushing faster than the consumer drains can drop records
+    TelemetryMonitor summary_only("", TelemetryMonitor::Format::Csv, 1);
+    TelemetryRecord record = records.back();
+    int pushed = 0;
+    for(int k = 0; k < 1000; k++)
+    {
+        pushed += summary_only.Push(record);
+    }
+    summary_only.Close();
+    REQUIRE(pushed + summary_only.NumDropped() == 1000);
+    REQUIRE(summary_only.GetSummary().num_records == pushed);
+    REQUIRE_THROWS_AS( summary_only.Push(record), std::logic_error);
+
+    REQUIRE(TelemetryMonitor::FormatFromFilename("run.csv") == TelemetryMonitor::Format::Csv);
+    REQUIRE_THROWS_AS( system.SetTelemetry(monitor, 0), std::logic_error);
+    REQUIRE_THROWS_AS( TelemetryMonitor::ReadBinary("missing_telemetry.bin"), std::runtime_error);
+}
+
+// fixed size solar system
+
+// the unrolled Euler steps of FixedSolarSystem give the same trajectory and energy as SolarSystem with the direct summation,
+// bit for bit, and it only accepts the bodies of SolarSystemGenerator
+TEST_CASE( "FixedSolarSystem does not match the direct summation", "[fixed_solar_system]" )
+{
+    SolarSystemGenerator ssgen;
+    auto particles = ssgen.GenerateInitialConditions();
+
+    FixedSolarSystem<9> fixed_system(particles);
+    SolarSystem system(particles);
+    system.SetForceSolver(std::make_shared<DirectSumSolver>());
+
+    fixed_system.StepEvolve(2000, 0.001, 0.01);
+    system.StepEvolve(2000, 0.001, 0.01);
+
+    for(int i = 0; i < 9; i++)
+    {
+        REQUIRE(fixed_system.GetParticle(i).GetPosition() == system.GetParticle(i).GetPosition());
+        REQUIRE(fixed_system.GetParticle(i).GetVelocity() == system.GetParticle(i).GetVelocity());
+    }
+
+    // the central star does not move, so only the other bodies need an acceleration
+    for(int i = 1; i < 9; i++)
+    {
+        REQUIRE(fixed_system.GetParticle(i).GetAcceleration() == system.GetParticle(i).GetAcceleration());
+    }
+    REQUIRE(fixed_system.TotalSystemEnergy() == system.TotalSystemEnergy());
+    REQUIRE(fixed_system.ToParticles().size() == 9);
+
+    // fewer bodies use the first masses of the table
+    std::vector<Particle> sun_and_mercury(particles.begin(), particles.begin() + 2);
+    FixedSolarSystem<2> two_bodies(sun_and_mercury);
+    SolarSystem two_body_system(sun_and_mercury);
+    two_body_system.SetForceSolver(std::make_shared<DirectSumSolver>());
+    two_bodies.TimeEvolve(1.0, 0.001, 0.0);
+    two_body_system.TimeEvolve(1.0, 0.001, 0.0);
+    REQUIRE(two_bodies.GetParticle(1).GetPosition() == two_body_system.GetParticle(1).GetPosition());
+
+    REQUIRE_THROWS_AS( FixedSolarSystem<9>(sun_and_mercury), std::logic_error);
+    RandomInitialGenerator randgen(5);
+    REQUIRE_THROWS_AS( FixedSolarSystem<9>(randgen.GenerateInitialConditions(8)), std::logic_error);
+    REQUIRE_THROWS_AS( fixed_system.GetParticle(9), std::logic_error);
+}
+
+// ensemble runner
+
+// every system of an ensemble ends exactly as when it is run on its own on one thread, whichever thread ran it,
+// and the statistics are those of the single results
+TEST_CASE( "EnsembleRunner does not evolve the systems correctly", "[ensemble]" )
+{
+    std::vector<std::vector<Particle>> initial_conditions;
+    RandomInitialGenerator randgen(11);
+    for(int num_planets : {2, 40, 5, 1, 80, 12, 3, 25, 8, 60})
+    {
+        initial_conditions.push_back(randgen.GenerateInitialConditions(num_planets));
+    }
+
+    EnsembleRunner runner(3);
+    runner.SetSetup([](SolarSystem& system, int index)
+    {
+        if (index % 2 == 1)
+        {
+            system.SetForceSolver(std::make_shared<DirectSumSolver>());
+        }
+    });
+    EnsembleReport report = runner.Run(initial_conditions, 0.05, 0.001, 0.01);
+
+    REQUIRE(report.num_threads == 3);
+    REQUIRE(report.results.size() == initial_conditions.size());
+
+    const int previous_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    int num_stolen = 0;
+    std::vector<EnsembleResult> results;
+    for(int index = 0; index < initial_conditions.size(); index++)
+    {
+        SolarSystem system(initial_conditions[index]);
+        if (index % 2 == 1)
+        {
+            system.SetForceSolver(std::make_shared<DirectSumSolver>());
+        }
+        double initial_energy = system.GetDiagnostics(0.01).total_energy;
+        system.TimeEvolve(0.05, 0.001, 0.01);
+
+        const EnsembleResult& result = report.results[index];
+        REQUIRE(result.num_bodies == initial_conditions[index].size());
+        REQUIRE(result.initial_energy == initial_energy);
+        REQUIRE(result.final_energy == system.GetDiagnostics(0.01).total_energy);
+        REQUIRE(result.relative_energy_loss == (result.final_energy - initial_energy) / std::abs(initial_energy));
+        REQUIRE(result.thread >= 0);
+        REQUIRE(result.thread < 3);
+        num_stolen += result.stolen;
+        results.push_back(result);
+    }
+    omp_set_num_threads(previous_threads);
+    REQUIRE(report.num_stolen == num_stolen);
+
+    std::vector<double> losses;
+    for(const EnsembleResult& result : results)
+    {
+        losses.push_back(result.relative_energy_loss);
+    }
+    std::sort(losses.begin(), losses.end());
+    EnsembleStatistics statistics = report.statistics;
+    REQUIRE(statistics.num_systems == 10);
+    REQUIRE(statistics.min_energy_loss == losses.front());
+    REQUIRE(statistics.max_energy_loss == losses.back());
+    REQUIRE(statistics.median_energy_loss == 0.5 * (losses[4] + losses[5]));
+    REQUIRE_THAT(statistics.mean_energy_loss, WithinRel(std::accumulate(losses.begin(), losses.end(), 0.0) / 10, 1e-12));
+    REQUIRE(statistics.std_energy_loss > 0.0);
+
+    // an exception of one system reaches the caller after the run
+    runner.SetSetup([](SolarSystem& system, int index)
+    {
+        if (index == 4)
+        {
+            system.SetForceSolver(nullptr);
+        }
+    });
+    REQUIRE_THROWS_AS( runner.Run(initial_conditions, 0.01, 0.001, 0.01), std::logic_error);
+    REQUIRE(runner.Run({}, 0.01, 0.001, 0.01).results.empty());
+    REQUIRE_THROWS_AS( EnsembleRunner(-1), std::logic_error);
+}
+
+// batched systems
+
+// every lane of a SolarSystemBatch follows its system bit for bit as a SolarSystem with the direct summation, for the
+// solar system with random angles as well as for general systems with different masses, also in the last, partly filled
+// block of lanes
+TEST_CASE( "SolarSystemBatch does not match the single systems", "[batch]" )
+{
+    SolarSystemGenerator ssgen;
+    RandomInitialGenerator randgen(3);
+    std::vector<std::vector<Particle>> solar_systems;
+    std::vector<std::vector<Particle>> general_systems;
+    for(int s = 0; s < 70; s++)
+    {
+        solar_systems.push_back(ssgen.GenerateInitialConditions());
+        general_systems.push_back(randgen.GenerateInitialConditions(8));
+    }
+
+    const int previous_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    for(const auto& systems : {solar_systems, general_systems})
+    {
+        SolarSystemBatch batch(systems);
+        REQUIRE(batch.NumSystems() == 70);
+        REQUIRE(batch.NumBodies() == 9);
+        batch.TimeEvolve(0.5, 0.001, 0.01);
+        std::vector<double> energies = batch.TotalSystemEnergies();
+
+        for(int s : {0, 1, 33, 63, 64, 69})
+        {
+            SolarSystem system(systems[s]);
+            system.SetForceSolver(std::make_shared<DirectSumSolver>());
+            system.TimeEvolve(0.5, 0.001, 0.01);
+
+            for(int i = 0; i < 9; i++)
+            {
+                REQUIRE(batch.GetParticle(s, i).GetPosition() == system.GetParticle(i).GetPosition());
+                REQUIRE(batch.GetParticle(s, i).GetVelocity() == system.GetParticle(i).GetVelocity());
+                REQUIRE(batch.GetParticle(s, i).GetMass() == system.GetParticle(i).GetMass());
+            }
+            REQUIRE(energies[s] == system.TotalSystemEnergy());
+        }
+        REQUIRE(batch.GetSystem(5).size() == 9);
+    }
+    omp_set_num_threads(previous_threads);
+
+    general_systems.push_back(randgen.GenerateInitialConditions(3));
+    REQUIRE_THROWS_AS( SolarSystemBatch(general_systems), std::logic_error);
+    REQUIRE_THROWS_AS( SolarSystemBatch({}), std::logic_error);
+    REQUIRE_THROWS_AS( SolarSystemBatch(solar_systems).GetParticle(70, 0), std::logic_error);
+}
+
+// particle-mesh solver
+
+// the FFT matches the discrete Fourier transform; the mesh forces between bodies many cells apart converge to the
+// direct summation as the cells get smaller, and the forces of the bodies on each other cancel
+TEST_CASE( "PmSolver does not approximate the direct summation", "[pm]" )
+{
+    Fft fft(16);
+    std::vector<std::complex<double>> values(16);
+    for(int k = 0; k < 16; k++)
+    {
+        values[k] = std::complex<double>(std::cos(0.3 * k * k), k % 3);
+    }
+    std::vector<std::complex<double>> transformed = values;
+    fft.Transform(transformed.data(), false);
+    for(int k = 0; k < 16; k++)
+    {
+        std::complex<double> expected = 0.0;
+        for(int j = 0; j < 16; j++)
+        {
+            expected += values[j] * std::polar(1.0, -2.0 * M_PI * j * k / 16);
+        }
+        REQUIRE(std::abs(transformed[k] - expected) < 1e-12);
+    }
+    fft.Transform(transformed.data(), true);
+    for(int k = 0; k < 16; k++)
+    {
+        REQUIRE(std::abs(transformed[k] / 16.0 - values[k]) < 1e-14);
+    }
+
+    std::vector<Particle> particles = {Particle(1.0), Particle(0.5), Particle(0.2)};
+    particles[1].SetPosition(Eigen::Vector3d{10.3, 3.7, 1.1});
+    particles[2].SetPosition(Eigen::Vector3d{-5.2, 8.1, -2.0});
+    SolarSystem far_apart(particles);
+
+    PmSolver coarse(16);
+    PmSolver fine(64);
+    ForceComparison coarse_error = ForceSolver::CompareWithDirectSum(coarse, far_apart.GetParticleStore(), 0.0, 3);
+    ForceComparison fine_error = ForceSolver::CompareWithDirectSum(fine, far_apart.GetParticleStore(), 0.0, 3);
+    REQUIRE(fine.GetCellSize() < coarse.GetCellSize());
+    REQUIRE(coarse_error.max_relative_error < 1e-2);
+    REQUIRE(fine_error.max_relative_error < 1e-3);
+    REQUIRE(fine_error.max_relative_error < coarse_error.max_relative_error);
+
+    // a random disk: total momentum change of all bodies is zero, and softening over a few cells makes the mesh accurate
+    RandomInitialGenerator randgen(7);
+    SolarSystem disk(randgen.GenerateInitialConditions(2000));
+    const ParticleStore& store = disk.GetParticleStore();
+    std::vector<double> acc_x(store.Size()), acc_y(store.Size()), acc_z(store.Size());
+    PmSolver pm(128);
+    pm.ComputeAccelerations(store, 1.0, acc_x.data(), acc_y.data(), acc_z.data());
+    Eigen::Vector3d total_force = Eigen::Vector3d::Zero();
+    double total_magnitude = 0.0;
+    for(int i = 0; i < store.Size(); i++)
+    {
+        Eigen::Vector3d force = store.mass[i] * Eigen::Vector3d(acc_x[i], acc_y[i], acc_z[i]);
+        total_force += force;
+        total_magnitude += force.norm();
+    }
+    REQUIRE(total_force.norm() < 1e-10 * total_magnitude);
+    REQUIRE(ForceSolver::CompareWithDirectSum(pm, store, 1.0, 200).rms_relative_error < 0.05);
+
+    REQUIRE_THROWS_AS( PmSolver(48), std::logic_error);
+    REQUIRE_THROWS_AS( PmSolver(2), std::logic_error);
+    REQUIRE_THROWS_AS( Fft(12), std::logic_error);
+}
+
+// particle-particle particle-mesh solver
+
+// the close pairs that the mesh misses are summed directly, so with little softening the P3M forces are far closer to the
+// direct summation than the mesh alone, get closer as the split widens, and the forces of the bodies on each other cancel
+TEST_CASE( "P3mSolver does not resolve the close pairs", "[p3m]" )
+{
+    RandomInitialGenerator randgen(7);
+    SolarSystem disk(randgen.GenerateInitialConditions(2000));
+    const ParticleStore& store = disk.GetParticleStore();
+
+    PmSolver pm(64);
+    P3mSolver p3m(64);
+    ForceComparison pm_error = ForceSolver::CompareWithDirectSum(pm, store, 0.01, 200);
+    ForceComparison p3m_error = ForceSolver::CompareWithDirectSum(p3m, store, 0.01, 200);
+    REQUIRE(p3m.GetSplitRadius() == 1.25 * p3m.GetCellSize());
+    REQUIRE(p3m.GetCutoff() == P3mSolver::cutoff_radii * p3m.GetSplitRadius());
+    REQUIRE(p3m_error.rms_relative_error < 0.03);
+    REQUIRE(p3m_error.rms_relative_error < 0.1 * pm_error.rms_relative_error);
+
+    p3m.SetSplitCells(3.0);
+    ForceComparison wide_error = ForceSolver::CompareWithDirectSum(p3m, store, 0.01, 200);
+    REQUIRE(p3m.GetSplitRadius() == 3.0 * p3m.GetCellSize());
+    REQUIRE(wide_error.rms_relative_error < p3m_error.rms_relative_error);
+
+    std::vector<double> acc_x(store.Size()), acc_y(store.Size()), acc_z(store.Size());
+    p3m.ComputeAccelerations(store, 0.01, acc_x.data(), acc_y.data(), acc_z.data());
+    Eigen::Vector3d total_force = Eigen::Vector3d::Zero();
+    double total_magnitude = 0.0;
+    for(int i = 0; i < store.Size(); i++)
+    {
+        Eigen::Vector3d force = store.mass[i] * Eigen::Vector3d(acc_x[i], acc_y[i], acc_z[i]);
+        total_force += force;
+        total_magnitude += force.norm();
+    }
+    REQUIRE(total_force.norm() < 1e-10 * total_magnitude);
+
+    REQUIRE_THROWS_AS( P3mSolver(64, 0.0), std::logic_error);
+    REQUIRE_THROWS_AS( P3mSolver(48), std::logic_error);
+    REQUIRE_THROWS_AS( p3m.SetSplitCells(-1.0), std::logic_error);
+}